@@ -1,85 +1,289 @@
 #include "./include/bit_stream.h"
-#include "./include/file_access.h"
 #include "./include/macro.h"
 #include "./include/neac_error.h"
 #include <stdlib.h>
+#include <string.h>
 
-static const uint8_t buffer_read_position_table[8] = { 1, 2, 3, 4, 5, 6, 7, 0 };
-static const uint32_t bit_mask_table[32] = {
-    0x00000001, /* 0000 0000 0000 0000 0000 0000 0000 0001 */
-    0x00000002, /* 0000 0000 0000 0000 0000 0000 0000 0010 */
-    0x00000004, /* 0000 0000 0000 0000 0000 0000 0000 0100 */
-    0x00000008, /* 0000 0000 0000 0000 0000 0000 0000 1000 */
-    0x00000010, /* 0000 0000 0000 0000 0000 0000 0001 0000 */
-    0x00000020, /* 0000 0000 0000 0000 0000 0000 0010 0000 */
-    0x00000040, /* 0000 0000 0000 0000 0000 0000 0100 0000 */
-    0x00000080, /* 0000 0000 0000 0000 0000 0000 1000 0000 */
-    0x00000100, /* 0000 0000 0000 0000 0000 0001 0000 0000 */
-    0x00000200, /* 0000 0000 0000 0000 0000 0010 0000 0000 */
-    0x00000400, /* 0000 0000 0000 0000 0000 0100 0000 0000 */
-    0x00000800, /* 0000 0000 0000 0000 0000 1000 0000 0000 */
-    0x00001000, /* 0000 0000 0000 0000 0001 0000 0000 0000 */
-    0x00002000, /* 0000 0000 0000 0000 0010 0000 0000 0000 */
-    0x00004000, /* 0000 0000 0000 0000 0100 0000 0000 0000 */
-    0x00008000, /* 0000 0000 0000 0000 1000 0000 0000 0000 */
-    0x00010000, /* 0000 0000 0000 0001 0000 0000 0000 0000 */
-    0x00020000, /* 0000 0000 0000 0010 0000 0000 0000 0000 */
-    0x00040000, /* 0000 0000 0000 0100 0000 0000 0000 0000 */
-    0x00080000, /* 0000 0000 0000 1000 0000 0000 0000 0000 */
-    0x00100000, /* 0000 0000 0001 0000 0000 0000 0000 0000 */
-    0x00200000, /* 0000 0000 0010 0000 0000 0000 0000 0000 */
-    0x00400000, /* 0000 0000 0100 0000 0000 0000 0000 0000 */
-    0x00800000, /* 0000 0000 1000 0000 0000 0000 0000 0000 */
-    0x01000000, /* 0000 0001 0000 0000 0000 0000 0000 0000 */
-    0x02000000, /* 0000 0010 0000 0000 0000 0000 0000 0000 */
-    0x04000000, /* 0000 0100 0000 0000 0000 0000 0000 0000 */
-    0x08000000, /* 0000 1000 0000 0000 0000 0000 0000 0000 */
-    0x10000000, /* 0001 0000 0000 0000 0000 0000 0000 0000 */
-    0x20000000, /* 0010 0000 0000 0000 0000 0000 0000 0000 */
-    0x40000000, /* 0100 0000 0000 0000 0000 0000 0000 0000 */
-    0x80000000  /* 1000 0000 0000 0000 0000 0000 0000 0000 */
+#define BIT_STREAM_MEMORY_INITIAL_SIZE  65536   /* メモリ上に書き込む場合の、出力先領域の初期サイズ */
+
+/* 各バイトのビット順を反転するためのテーブル
+ * ファイル上では各バイトの最下位ビットから順にビットが格納されているため、ビット窓に
+ * 読み込む際にビット順を反転し、ビット窓の最上位ビットから順に消費できるようにする。*/
+static const uint8_t bit_reverse_table[256] = {
+    0x00, 0x80, 0x40, 0xc0, 0x20, 0xa0, 0x60, 0xe0, 0x10, 0x90, 0x50, 0xd0, 0x30, 0xb0, 0x70, 0xf0,
+    0x08, 0x88, 0x48, 0xc8, 0x28, 0xa8, 0x68, 0xe8, 0x18, 0x98, 0x58, 0xd8, 0x38, 0xb8, 0x78, 0xf8,
+    0x04, 0x84, 0x44, 0xc4, 0x24, 0xa4, 0x64, 0xe4, 0x14, 0x94, 0x54, 0xd4, 0x34, 0xb4, 0x74, 0xf4,
+    0x0c, 0x8c, 0x4c, 0xcc, 0x2c, 0xac, 0x6c, 0xec, 0x1c, 0x9c, 0x5c, 0xdc, 0x3c, 0xbc, 0x7c, 0xfc,
+    0x02, 0x82, 0x42, 0xc2, 0x22, 0xa2, 0x62, 0xe2, 0x12, 0x92, 0x52, 0xd2, 0x32, 0xb2, 0x72, 0xf2,
+    0x0a, 0x8a, 0x4a, 0xca, 0x2a, 0xaa, 0x6a, 0xea, 0x1a, 0x9a, 0x5a, 0xda, 0x3a, 0xba, 0x7a, 0xfa,
+    0x06, 0x86, 0x46, 0xc6, 0x26, 0xa6, 0x66, 0xe6, 0x16, 0x96, 0x56, 0xd6, 0x36, 0xb6, 0x76, 0xf6,
+    0x0e, 0x8e, 0x4e, 0xce, 0x2e, 0xae, 0x6e, 0xee, 0x1e, 0x9e, 0x5e, 0xde, 0x3e, 0xbe, 0x7e, 0xfe,
+    0x01, 0x81, 0x41, 0xc1, 0x21, 0xa1, 0x61, 0xe1, 0x11, 0x91, 0x51, 0xd1, 0x31, 0xb1, 0x71, 0xf1,
+    0x09, 0x89, 0x49, 0xc9, 0x29, 0xa9, 0x69, 0xe9, 0x19, 0x99, 0x59, 0xd9, 0x39, 0xb9, 0x79, 0xf9,
+    0x05, 0x85, 0x45, 0xc5, 0x25, 0xa5, 0x65, 0xe5, 0x15, 0x95, 0x55, 0xd5, 0x35, 0xb5, 0x75, 0xf5,
+    0x0d, 0x8d, 0x4d, 0xcd, 0x2d, 0xad, 0x6d, 0xed, 0x1d, 0x9d, 0x5d, 0xdd, 0x3d, 0xbd, 0x7d, 0xfd,
+    0x03, 0x83, 0x43, 0xc3, 0x23, 0xa3, 0x63, 0xe3, 0x13, 0x93, 0x53, 0xd3, 0x33, 0xb3, 0x73, 0xf3,
+    0x0b, 0x8b, 0x4b, 0xcb, 0x2b, 0xab, 0x6b, 0xeb, 0x1b, 0x9b, 0x5b, 0xdb, 0x3b, 0xbb, 0x7b, 0xfb,
+    0x07, 0x87, 0x47, 0xc7, 0x27, 0xa7, 0x67, 0xe7, 0x17, 0x97, 0x57, 0xd7, 0x37, 0xb7, 0x77, 0xf7,
+    0x0f, 0x8f, 0x4f, 0xcf, 0x2f, 0xaf, 0x6f, 0xef, 0x1f, 0x9f, 0x5f, 0xdf, 0x3f, 0xbf, 0x7f, 0xff
 };
 
-static inline void bit_stream_write_buffer(bit_stream* stream) {
-    if (stream->mode != BIT_STREAM_MODE_WRITE) {
-        report_error(NEAC_ERROR_BIT_STREAM_NOT_WRITE_MODE);
+/*!
+ * @brief           バイト列の領域に蓄積されたデータを、まとめてファイルに書き込みます。メモリ上に書き込む場合は何もしません。
+ * @param *stream   ビットストリームのハンドル
+ */
+static void bit_stream_flush_bytes(bit_stream* stream) {
+    size_t actual_write;
+
+    if (stream->file == NULL || stream->byte_position == 0) {
         return;
     }
 
-    write_uint8(stream->file, stream->buffer);
-    stream->buffer_position = 0;
-    stream->buffer = 0;
+    actual_write = fwrite(stream->byte_buffer, sizeof(uint8_t), stream->byte_position, stream->file);
+    if (actual_write < stream->byte_position) {
+        report_error(NEAC_ERROR_BIT_STREAM_FAILED_TO_WRITE);
+    }
+
+    stream->byte_position = 0;
 }
 
 /*!
- * @brief           ビットストリームの領域を確保し、そのハンドルを返します。
- * @param *file     ビットストリームで扱うファイルのファイルハンドル
- * @param mode      ビットストリームのモード
- * @return          ビットストリームのハンドル
+ * @brief           バイト列の領域に、少なくとも指定されたバイト数の空きを用意します。
+ * @param *stream   ビットストリームのハンドル
+ * @param size      必要なバイト数
+ * @return          空きを用意できた場合は true を、メモリアロケーションに失敗した場合は false を返します。
+ * @note            ファイルに書き込む場合は蓄積されたデータをファイルに書き込み、メモリ上に書き込む場合は領域を拡張します。
  */
-bit_stream* bit_stream_create(FILE* file, uint32_t mode) {
-    bit_stream* stream = (bit_stream*)malloc(sizeof(bit_stream));
-    
+static bool bit_stream_reserve(bit_stream* stream, size_t size) {
+    size_t new_size;
+    uint8_t* new_buffer;
+
+    if (stream->byte_position + size <= stream->byte_buffer_size) {
+        return true;
+    }
+
+    if (stream->file != NULL) {
+        bit_stream_flush_bytes(stream);
+        return size <= stream->byte_buffer_size;
+    }
+
+    /* 出力先の領域を、必要なサイズを満たすまで倍々に拡張する */
+    new_size = stream->byte_buffer_size;
+    while (stream->byte_position + size > new_size) {
+        new_size *= 2;
+    }
+
+    new_buffer = (uint8_t*)realloc(stream->byte_buffer, new_size);
+    if (new_buffer == NULL) {
+        report_error(NEAC_ERROR_BIT_STREAM_CANNOT_ALLOCATE_MEMORY);
+        return false;
+    }
+
+    stream->byte_buffer = new_buffer;
+    stream->byte_buffer_size = new_size;
+
+    return true;
+}
+
+/*!
+ * @brief           ビット窓の上位32ビットをバイト列の領域に書き出します。
+ * @param *stream   ビットストリームのハンドル
+ */
+static inline void bit_stream_spill_word(bit_stream* stream) {
+    register uint32_t word = (uint32_t)RSHIFT(stream->bit_buffer, 32);
+    register uint8_t* dst;
+
+    if (!bit_stream_reserve(stream, 4)) {
+        return;
+    }
+
+    dst = &stream->byte_buffer[stream->byte_position];
+    dst[0] = bit_reverse_table[RSHIFT(word, 24)];
+    dst[1] = bit_reverse_table[RSHIFT(word, 16) & 0xff];
+    dst[2] = bit_reverse_table[RSHIFT(word, 8) & 0xff];
+    dst[3] = bit_reverse_table[word & 0xff];
+
+    stream->bit_buffer = LSHIFT(stream->bit_buffer, 32);
+    stream->bit_count -= 32;
+    stream->byte_position += 4;
+}
+
+/*!
+ * @brief           ビット窓に残っている8ビット単位のデータを、バイト列の領域に書き出します。
+ * @param *stream   ビットストリームのハンドル
+ * @note            8ビットに満たない端数のビットは、ビット窓に残ります。
+ */
+static void bit_stream_spill_bytes(bit_stream* stream) {
+    while (stream->bit_count >= 8) {
+        if (!bit_stream_reserve(stream, 1)) {
+            return;
+        }
+
+        stream->byte_buffer[stream->byte_position++] = bit_reverse_table[RSHIFT(stream->bit_buffer, 56)];
+        stream->bit_buffer = LSHIFT(stream->bit_buffer, 8);
+        stream->bit_count -= 8;
+    }
+}
+
+/*!
+ * @brief           ファイルから次のデータをまとめて読み込み、バイト列の領域に格納します。
+ * @param *stream   ビットストリームのハンドル
+ * @return          1バイト以上読み込めた場合は true を、データの終端に達していた場合は false を返します。
+ */
+static bool bit_stream_fill_bytes(bit_stream* stream) {
+    /* メモリ上のデータを読み込む場合、すべてのデータが最初からバイト列の領域に存在する */
+    if (stream->file == NULL) {
+        return false;
+    }
+
+    stream->byte_position = 0;
+    stream->byte_length = fread(stream->byte_buffer, sizeof(uint8_t), stream->byte_buffer_size, stream->file);
+
+    return stream->byte_length > 0;
+}
+
+/*!
+ * @brief           ビット窓に、57ビット以上の有効なビットが格納された状態になるまで、バイト列からデータを補充します。
+ * @param *stream   ビットストリームのハンドル
+ * @note            データの終端に達した場合、有効なビット数が57ビットに満たない状態で終了します。
+ */
+static void bit_stream_refill(bit_stream* stream) {
+    register uint64_t window = stream->bit_buffer;
+    register uint32_t count = stream->bit_count;
+
+    while (count <= 56) {
+        if (stream->byte_position >= stream->byte_length && !bit_stream_fill_bytes(stream)) {
+            break;
+        }
+
+        window |= LSHIFT((uint64_t)bit_reverse_table[stream->byte_buffer[stream->byte_position++]], 56 - count);
+        count += 8;
+    }
+
+    stream->bit_buffer = window;
+    stream->bit_count = count;
+}
+
+/*!
+ * @brief                   ビットストリームの領域を確保し、共通のメンバを設定します。
+ * @param *file             ビットストリームで扱うファイルのファイルハンドル。メモリ上のデータを扱う場合はNULL
+ * @param mode              ビットストリームのモード
+ * @param *byte_buffer      バイト列の領域のポインタ
+ * @param byte_buffer_size  バイト列の領域のサイズ
+ * @param owns_byte_buffer  バイト列の領域をビットストリームが解放すべきかどうかを示すフラグ
+ * @return                  ビットストリームのハンドル
+ */
+static bit_stream* bit_stream_alloc(FILE* file, uint32_t mode, uint8_t* byte_buffer, size_t byte_buffer_size, bool owns_byte_buffer) {
+    bit_stream* stream;
+
+    if (byte_buffer == NULL && byte_buffer_size > 0) {
+        report_error(NEAC_ERROR_BIT_STREAM_CANNOT_ALLOCATE_MEMORY);
+        return NULL;
+    }
+
+    stream = (bit_stream*)malloc(sizeof(bit_stream));
+
     if (stream == NULL) {
+        if (owns_byte_buffer) {
+            free(byte_buffer);
+        }
+
         report_error(NEAC_ERROR_BIT_STREAM_CANNOT_ALLOCATE_MEMORY);
         return NULL;
     }
 
     stream->mode = mode;
     stream->file = file;
-    stream->buffer_position = 0;
-    stream->buffer = 0;
+    stream->byte_buffer = byte_buffer;
+    stream->byte_buffer_size = byte_buffer_size;
+    stream->owns_byte_buffer = owns_byte_buffer;
+
+    bit_stream_init(stream);
 
     return stream;
 }
 
 /*!
- * @brief           ビットストリームを初期化します。
+ * @brief           ビットストリームの領域を確保し、そのハンドルを返します。
+ * @param *file     ビットストリームで扱うファイルのファイルハンドル
+ * @param mode      ビットストリームのモード
+ * @return          ビットストリームのハンドル
+ */
+bit_stream* bit_stream_create(FILE* file, uint32_t mode) {
+    return bit_stream_alloc(file, mode, (uint8_t*)malloc(BIT_STREAM_BYTE_BUFFER_SIZE), BIT_STREAM_BYTE_BUFFER_SIZE, true);
+}
+
+/*!
+ * @brief           メモリ上のデータを読み込む、読み込みモードのビットストリームを生成します。データはコピーされません。
+ * @param *data     読み込むデータのポインタ。ビットストリームを解放するまで有効である必要があります。
+ * @param size      読み込むデータのバイト数
+ * @return          ビットストリームのハンドル
+ */
+bit_stream* bit_stream_create_memory_reader(const uint8_t* data, size_t size) {
+    return bit_stream_alloc(NULL, BIT_STREAM_MODE_READ, (uint8_t*)data, size, false);
+}
+
+/*!
+ * @brief           メモリ上の領域に書き込む、書き込みモードのビットストリームを生成します。領域は必要に応じて自動的に拡張されます。
+ * @return          ビットストリームのハンドル
+ */
+bit_stream* bit_stream_create_memory_writer() {
+    return bit_stream_alloc(NULL, BIT_STREAM_MODE_WRITE, (uint8_t*)malloc(BIT_STREAM_MEMORY_INITIAL_SIZE), BIT_STREAM_MEMORY_INITIAL_SIZE, true);
+}
+
+/*!
+ * @brief           ビットストリームが内部で確保した領域を解放します。
+ * @param *stream   ビットストリームのハンドル
+ */
+void bit_stream_free(bit_stream* stream) {
+    if (stream->owns_byte_buffer) {
+        free(stream->byte_buffer);
+    }
+
+    stream->byte_buffer = NULL;
+    stream->byte_buffer_size = 0;
+}
+
+/*!
+ * @brief           ビットストリームを初期化します。読み込みモードの場合、先読み済みのデータはすべて破棄されます。
  * @param *stream   ビットストリームのハンドル
  */
 void bit_stream_init(bit_stream* stream) {
-    stream->buffer = 0;
-    stream->buffer_position = 0;
+    stream->bit_buffer = 0;
+    stream->bit_count = 0;
+    stream->byte_position = 0;
+
+    /* メモリ上のデータを読み込む場合、領域全体が有効なデータである */
+    stream->byte_length = (stream->file == NULL && stream->mode == BIT_STREAM_MODE_READ) ? stream->byte_buffer_size : 0;
+}
+
+/*!
+ * @brief           読み込みモードのビットストリームを、データの先頭に巻き戻します。
+ * @param *stream   ビットストリームのハンドル
+ */
+void bit_stream_rewind(bit_stream* stream) {
+    if (stream->file != NULL) {
+        rewind(stream->file);
+    }
+
+    bit_stream_init(stream);
+}
+
+/*!
+ * @brief           メモリ上に書き込むビットストリームで、書き込まれたデータを取得します。
+ * @param *stream   ビットストリームのハンドル
+ * @param *size     [出力]書き込まれたデータのバイト数
+ * @return          書き込まれたデータのポインタ。ビットストリームを解放するまで有効です。ファイルに書き込むビットストリームの場合はNULLを返します。
+ * @note            bit_stream_close を呼び出すまでは、ビット窓に残っているデータは含まれません。
+ */
+const uint8_t* bit_stream_get_memory(bit_stream* stream, size_t* size) {
+    if (stream->file != NULL || stream->mode != BIT_STREAM_MODE_WRITE) {
+        *(size) = 0;
+        return NULL;
+    }
+
+    *(size) = stream->byte_position;
+    return stream->byte_buffer;
 }
 
 /*!
@@ -95,12 +299,18 @@ bool bit_stream_read_bit(bit_stream* stream) {
         return false;
     }
 
-    if (stream->buffer_position == 0) {
-        stream->buffer = read_uint8(stream->file);
+    if (stream->bit_count == 0) {
+        bit_stream_refill(stream);
+
+        if (stream->bit_count == 0) {
+            report_error(NEAC_ERROR_BIT_STREAM_END_OF_STREAM);
+            return false;
+        }
     }
 
-    bit = stream->buffer & bit_mask_table[stream->buffer_position];                 /* bit = stream->buffer & LSHIFT(1, stream->buffer_position); */
-    stream->buffer_position = buffer_read_position_table[stream->buffer_position];
+    bit = (bool)RSHIFT(stream->bit_buffer, 63);
+    stream->bit_buffer = LSHIFT(stream->bit_buffer, 1);
+    stream->bit_count--;
 
     return bit;
 }
@@ -112,47 +322,260 @@ bool bit_stream_read_bit(bit_stream* stream) {
  * @return          読み込まれた整数
  */
 uint32_t bit_stream_read_uint(bit_stream* stream, uint32_t bits) {
-    register uint32_t value = 0;
-    register uint32_t i;
+    register uint32_t value;
+
+    if (stream->mode != BIT_STREAM_MODE_READ) {
+        report_error(NEAC_ERROR_BIT_STREAM_NOT_READ_MODE);
+        return 0;
+    }
+
+    if (bits == 0) {
+        return 0;
+    }
+
+    if (stream->bit_count < bits) {
+        bit_stream_refill(stream);
 
-    for (i = 0; i < bits; ++i) {
-        value |= LSHIFT(bit_stream_read_bit(stream), bits - 1 - i);
+        if (stream->bit_count < bits) {
+            report_error(NEAC_ERROR_BIT_STREAM_END_OF_STREAM);
+            stream->bit_count = bits;       /* 不足分はゼロとして扱う */
+        }
     }
 
+    /* ビット窓の上位から、指定されたビット数の整数を取り出す */
+    value = (uint32_t)RSHIFT(stream->bit_buffer, 64 - bits);
+    stream->bit_buffer = LSHIFT(stream->bit_buffer, bits);
+    stream->bit_count -= bits;
+
     return value;
 }
 
+/*!
+ * @brief           ビットストリームの次の任意ビット数を、読み込み位置を進めずに取得します。
+ * @param *stream   ビットストリームのハンドル
+ * @param bits      取得するビット数（32以下）
+ * @return          取得されたビット列を整数として解釈した値
+ * @note            データの終端を越える部分はゼロとして扱われます。
+ */
+uint32_t bit_stream_peek_uint(bit_stream* stream, uint32_t bits) {
+    if (stream->bit_count < bits) {
+        bit_stream_refill(stream);
+    }
+
+    return (uint32_t)RSHIFT(stream->bit_buffer, 64 - bits);
+}
+
+/*!
+ * @brief           ビットストリームの読み込み位置を、指定されたビット数だけ進めます。
+ * @param *stream   ビットストリームのハンドル
+ * @param bits      読み飛ばすビット数（bit_stream_peek_uintで直前に取得したビット数以下）
+ */
+void bit_stream_skip_bits(bit_stream* stream, uint32_t bits) {
+    if (stream->bit_count < bits) {
+        report_error(NEAC_ERROR_BIT_STREAM_END_OF_STREAM);
+        bits = stream->bit_count;
+    }
+
+    stream->bit_buffer = LSHIFT(stream->bit_buffer, bits);
+    stream->bit_count -= bits;
+}
+
+/*!
+ * @brief           ビットストリームから、unary符号化された値（終端の0までに連続する1の数）を読み込みます。
+ * @param *stream   ビットストリームのハンドル
+ * @param limit     読み込む1の数の上限
+ * @return          読み込まれた値。1がlimit個連続した場合は、終端の0を読み込まずにlimitを返します。
+ * @note            ビット窓の先頭から連続する1の数を一度に数えるため、値の大きさに関わらずほぼ一定の時間で読み込めます。
+ */
+uint32_t bit_stream_read_unary(bit_stream* stream, uint32_t limit) {
+    register uint32_t result = 0;
+    register uint32_t ones;
+    register uint32_t needed;
+
+    if (stream->mode != BIT_STREAM_MODE_READ) {
+        report_error(NEAC_ERROR_BIT_STREAM_NOT_READ_MODE);
+        return 0;
+    }
+
+    if (limit == 0) {
+        return 0;
+    }
+
+    for (;;) {
+        /* ビット窓の先頭から連続する1の数を数える。有効なビットの後ろはゼロで埋められている。*/
+        ones = (~stream->bit_buffer == 0) ? 64 : COUNT_LEADING_ZEROS64(~stream->bit_buffer);
+        if (ones > stream->bit_count) {
+            ones = stream->bit_count;
+        }
+
+        /* 上限に達した場合は、上限までの1だけを消費する（64ビットのシフトを避けるため2回に分ける） */
+        needed = limit - result;
+        if (ones >= needed) {
+            stream->bit_buffer = LSHIFT(LSHIFT(stream->bit_buffer, needed - 1), 1);
+            stream->bit_count -= needed;
+            return limit;
+        }
+
+        if (ones < stream->bit_count) {
+            /* 終端の0がビット窓の中にあれば、終端の0まで含めて消費する */
+            stream->bit_buffer = LSHIFT(LSHIFT(stream->bit_buffer, ones), 1);
+            stream->bit_count -= ones + 1;
+            return result + ones;
+        }
+
+        /* ビット窓の有効なビットがすべて1であれば、すべて消費して補充する */
+        result += stream->bit_count;
+        stream->bit_buffer = 0;
+        stream->bit_count = 0;
+        bit_stream_refill(stream);
+
+        if (stream->bit_count == 0) {
+            report_error(NEAC_ERROR_BIT_STREAM_END_OF_STREAM);
+            return result;
+        }
+    }
+}
+
+/*!
+ * @brief           ビットストリームから任意バイト数のデータを読み込みます。
+ * @param *stream   ビットストリームのハンドル
+ * @param *data     読み込んだデータを格納する領域のポインタ
+ * @param size      読み込むバイト数
+ * @return          実際に読み込まれたバイト数
+ * @note            各バイトは最下位ビットから順に読み込まれます。バイト境界に位置している場合、データはそのまま転送されます。
+ */
+size_t bit_stream_read_bytes(bit_stream* stream, void* data, size_t size) {
+    uint8_t* dst = (uint8_t*)data;
+    size_t offset = 0;
+    size_t n;
+
+    if (stream->mode != BIT_STREAM_MODE_READ) {
+        report_error(NEAC_ERROR_BIT_STREAM_NOT_READ_MODE);
+        return 0;
+    }
+
+    /* ビット窓に先読みされている分を取り出す */
+    while (offset < size && stream->bit_count >= 8) {
+        dst[offset++] = bit_reverse_table[RSHIFT(stream->bit_buffer, 56)];
+        stream->bit_buffer = LSHIFT(stream->bit_buffer, 8);
+        stream->bit_count -= 8;
+    }
+
+    /* バイト境界に位置していなければ、1バイトずつビットを読み込む */
+    if (stream->bit_count != 0) {
+        for (; offset < size; ++offset) {
+            dst[offset] = bit_reverse_table[bit_stream_read_uint(stream, 8)];
+        }
+
+        return offset;
+    }
+
+    /* バイト列の領域からそのままコピーする */
+    while (offset < size) {
+        if (stream->byte_position >= stream->byte_length && !bit_stream_fill_bytes(stream)) {
+            break;
+        }
+
+        n = stream->byte_length - stream->byte_position;
+        if (n > size - offset) {
+            n = size - offset;
+        }
+
+        memcpy(&dst[offset], &stream->byte_buffer[stream->byte_position], n);
+        stream->byte_position += n;
+        offset += n;
+    }
+
+    return offset;
+}
+
 /*!
  * @brief           ビットストリームに1ビット書き込みます。
  * @param *stream   ビットストリームのハンドル
  * @param bit       書き込むビット
  */
 void bit_stream_write_bit(bit_stream* stream, bool bit) {
-    if (stream->buffer_position == 8) {
-        bit_stream_write_buffer(stream);
+    if (stream->bit_count == 64) {
+        bit_stream_spill_word(stream);
     }
 
-    stream->buffer |= LSHIFT(bit, stream->buffer_position);
-    stream->buffer_position++;
+    stream->bit_buffer |= LSHIFT((uint64_t)bit, 63 - stream->bit_count);
+    stream->bit_count++;
 }
 
 /*!
  * @brief           ビットストリームに任意ビット数の整数を書き込みます。
  * @param *stream   ビットストリームのハンドル
  * @param value     書き込む整数
- * @param num_bits  書き込む整数のビット数
+ * @param num_bits  書き込む整数のビット数（32以下）
  */
 void bit_stream_write_uint(bit_stream* stream, uint32_t value, uint32_t num_bits) {
-    register int32_t i;     /* uint32_t型だと、i>=0が永遠に成り立つため、無限ループとなる。*/
-
     if (stream->mode != BIT_STREAM_MODE_WRITE) {
         report_error(NEAC_ERROR_BIT_STREAM_NOT_WRITE_MODE);
         return;
     }
 
-    for (i = num_bits - 1; i >= 0; --i) {
-        bit_stream_write_bit(stream, value & bit_mask_table[i]);    /* bit_stream_write_bit(stream, RSHIFT(value, i) & 1); */
+    if (num_bits == 0) {
+        return;
+    }
+
+    /* ビット窓に収まらなければ、先に上位32ビットを書き出す */
+    if (stream->bit_count + num_bits > 64) {
+        bit_stream_spill_word(stream);
+    }
+
+    /* valueの下位num_bitsビットを、ビット窓の有効なビットの直後に連結する。
+     * 64 - num_bits ビット左シフトすることで、num_bitsビットより上位のビットは捨てられる。*/
+    stream->bit_buffer |= RSHIFT(LSHIFT((uint64_t)value, 64 - num_bits), stream->bit_count);
+    stream->bit_count += num_bits;
+}
+
+/*!
+ * @brief           ビットストリームに任意バイト数のデータを書き込みます。
+ * @param *stream   ビットストリームのハンドル
+ * @param *data     書き込むデータのポインタ
+ * @param size      書き込むバイト数
+ * @return          実際に書き込まれたバイト数
+ * @note            各バイトは最下位ビットから順に書き込まれます。バイト境界に位置している場合、データはそのまま転送されます。
+ */
+size_t bit_stream_write_bytes(bit_stream* stream, const void* data, size_t size) {
+    const uint8_t* src = (const uint8_t*)data;
+    size_t offset = 0;
+    size_t n;
+
+    if (stream->mode != BIT_STREAM_MODE_WRITE) {
+        report_error(NEAC_ERROR_BIT_STREAM_NOT_WRITE_MODE);
+        return 0;
+    }
+
+    /* バイト境界に位置していなければ、1バイトずつビットを書き込む */
+    if (stream->bit_count % 8 != 0) {
+        for (offset = 0; offset < size; ++offset) {
+            bit_stream_write_uint(stream, bit_reverse_table[src[offset]], 8);
+        }
+
+        return size;
+    }
+
+    /* ビット窓に蓄積されている分を書き出してから、バイト列の領域にそのままコピーする */
+    bit_stream_spill_bytes(stream);
+
+    while (offset < size) {
+        if (!bit_stream_reserve(stream, 1)) {
+            break;
+        }
+
+        n = stream->byte_buffer_size - stream->byte_position;
+        if (n > size - offset) {
+            n = size - offset;
+        }
+
+        memcpy(&stream->byte_buffer[stream->byte_position], &src[offset], n);
+        stream->byte_position += n;
+        offset += n;
     }
+
+    return offset;
 }
 
 /*!
@@ -161,11 +584,13 @@ void bit_stream_write_uint(bit_stream* stream, uint32_t value, uint32_t num_bits
  */
 void bit_stream_close(bit_stream* stream) {
     if (stream->mode == BIT_STREAM_MODE_WRITE) {
-        /* バッファに残っている未書き込みのビットを書き込む */
-        bit_stream_write_buffer(stream);
+        /* ビット窓に残っている未書き込みのビットを、最後のバイトの不足分をゼロで埋めて書き出す */
+        stream->bit_count = (stream->bit_count + 7) & ~7u;
+        bit_stream_spill_bytes(stream);
+        bit_stream_flush_bytes(stream);
     }
 
-    /* 後始末 */
-    stream->buffer_position = 0;
-    stream->buffer = 0;
-}
+    /* 後始末（メモリ上に書き込んだデータは保持する） */
+    stream->bit_buffer = 0;
+    stream->bit_count = 0;
+}
\ No newline at end of file
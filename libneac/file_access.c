@@ -4,15 +4,15 @@
 #include <string.h>
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルから、真偽値を読み込みます。
- * @param file  ファイルポインタ
- * @return      真偽値
+ * @brief           指定されたビットストリームから、真偽値を読み込みます。
+ * @param *stream   ビットストリームのハンドル
+ * @return          真偽値
  */
-bool read_bool(FILE* file) {
+bool read_bool(bit_stream* stream) {
     uint8_t value;
-    size_t actual_read = fread(&value, sizeof(uint8_t), 1, file);
+    size_t actual_read = bit_stream_read_bytes(stream, &value, sizeof(uint8_t));
 
-    if (actual_read < 1) {
+    if (actual_read < sizeof(uint8_t)) {
         report_error(NEAC_ERROR_FILE_ACCESS_FAILED_TO_READ_BOOL);
     }
 
@@ -20,15 +20,15 @@ bool read_bool(FILE* file) {
 }
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルから16ビット符号付き整数を読み込みます。
- * @param file  ファイルポインタ
- * @return      読み込まれた値
+ * @brief           指定されたビットストリームから16ビット符号付き整数を読み込みます。
+ * @param *stream   ビットストリームのハンドル
+ * @return          読み込まれた値
  */
-int16_t read_int16(FILE* file) {
+int16_t read_int16(bit_stream* stream) {
     int16_t value;
-    size_t actual_read = fread(&value, sizeof(int16_t), 1, file);
+    size_t actual_read = bit_stream_read_bytes(stream, &value, sizeof(int16_t));
 
-    if (actual_read < 1) {
+    if (actual_read < sizeof(int16_t)) {
         report_error(NEAC_ERROR_FILE_ACCESS_FAILED_TO_READ_INT16);
     }
 
@@ -36,15 +36,15 @@ int16_t read_int16(FILE* file) {
 }
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルから32ビット符号付き整数を読み込みます。
- * @param file  ファイルポインタ
- * @return      読み込まれた値
+ * @brief           指定されたビットストリームから32ビット符号付き整数を読み込みます。
+ * @param *stream   ビットストリームのハンドル
+ * @return          読み込まれた値
  */
-int32_t read_int32(FILE* file) {
+int32_t read_int32(bit_stream* stream) {
     int32_t value;
-    size_t actual_read = fread(&value, sizeof(int32_t), 1, file);
+    size_t actual_read = bit_stream_read_bytes(stream, &value, sizeof(int32_t));
 
-    if (actual_read < 1) {
+    if (actual_read < sizeof(int32_t)) {
         report_error(NEAC_ERROR_FILE_ACCESS_FAILED_TO_READ_INT32);
     }
 
@@ -52,15 +52,15 @@ int32_t read_int32(FILE* file) {
 }
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルからASCII文字を読み込みます。
- * @param file  ファイルポインタ
- * @return      読み込まれた値
+ * @brief           指定されたビットストリームからASCII文字を読み込みます。
+ * @param *stream   ビットストリームのハンドル
+ * @return          読み込まれた値
  */
-char read_char(FILE* file) {
+char read_char(bit_stream* stream) {
     char value;
-    size_t actual_read = fread(&value, sizeof(char), 1, file);
+    size_t actual_read = bit_stream_read_bytes(stream, &value, sizeof(char));
 
-    if (actual_read < 1) {
+    if (actual_read < sizeof(char)) {
         report_error(NEAC_ERROR_FILE_ACCESS_FAILED_TO_READ_CHAR);
     }
 
@@ -68,11 +68,11 @@ char read_char(FILE* file) {
 }
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルからASCII文字を読み込みます。
- * @param file  ファイルポインタ
- * @return      読み込まれた値
+ * @brief           指定されたビットストリームからASCII文字を読み込みます。
+ * @param *stream   ビットストリームのハンドル
+ * @return          読み込まれた値
  */
-const char* read_string(FILE* file, uint32_t bytes) {
+const char* read_string(bit_stream* stream, uint32_t bytes) {
     uint32_t i;
     char* result = (char*)malloc(bytes);
 
@@ -81,22 +81,22 @@ const char* read_string(FILE* file, uint32_t bytes) {
     }
 
     for (i = 0; i < bytes; ++i) {
-        result[i] = read_char(file);
+        result[i] = read_char(stream);
     }
 
     return result;
 }
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルから8ビット整数を読み込みます。
- * @param file  ファイルポインタ
- * @return      読み込まれた値
+ * @brief           指定されたビットストリームから8ビット整数を読み込みます。
+ * @param *stream   ビットストリームのハンドル
+ * @return          読み込まれた値
  */
-uint8_t read_uint8(FILE* file) {
+uint8_t read_uint8(bit_stream* stream) {
     uint8_t value;
-    size_t actual_read = fread(&value, sizeof(uint8_t), 1, file);
+    size_t actual_read = bit_stream_read_bytes(stream, &value, sizeof(uint8_t));
 
-    if (actual_read < 1) {
+    if (actual_read < sizeof(uint8_t)) {
         report_error(NEAC_ERROR_FILE_ACCESS_FAILED_TO_READ_UINT8);
     }
 
@@ -104,15 +104,15 @@ uint8_t read_uint8(FILE* file) {
 }
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルから16ビット整数を読み込みます。
- * @param file  ファイルポインタ
- * @return      読み込まれた値
+ * @brief           指定されたビットストリームから16ビット整数を読み込みます。
+ * @param *stream   ビットストリームのハンドル
+ * @return          読み込まれた値
  */
-uint16_t read_uint16(FILE* file) {
+uint16_t read_uint16(bit_stream* stream) {
     uint16_t value;
-    size_t actual_read = fread(&value, sizeof(uint16_t), 1, file);
+    size_t actual_read = bit_stream_read_bytes(stream, &value, sizeof(uint16_t));
 
-    if (actual_read < 1) {
+    if (actual_read < sizeof(uint16_t)) {
         report_error(NEAC_ERROR_FILE_ACCESS_FAILED_TO_READ_UINT16);
     }
 
@@ -120,15 +120,15 @@ uint16_t read_uint16(FILE* file) {
 }
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルから32ビット整数を読み込みます。
- * @param file  ファイルポインタ
- * @return      読み込まれた値
+ * @brief           指定されたビットストリームから32ビット整数を読み込みます。
+ * @param *stream   ビットストリームのハンドル
+ * @return          読み込まれた値
  */
-uint32_t read_uint32(FILE* file) {
+uint32_t read_uint32(bit_stream* stream) {
     uint32_t value;
-    size_t actual_read = fread(&value, sizeof(uint32_t), 1, file);
+    size_t actual_read = bit_stream_read_bytes(stream, &value, sizeof(uint32_t));
 
-    if (actual_read < 1) {
+    if (actual_read < sizeof(uint32_t)) {
         report_error(NEAC_ERROR_FILE_ACCESS_FAILED_TO_READ_UINT32);
     }
 
@@ -136,20 +136,20 @@ uint32_t read_uint32(FILE* file) {
 }
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルに真偽値を書き込む。
- * @param file  ファイルポインタ
- * @param value 書き込む値
+ * @brief           指定されたビットストリームに真偽値を書き込む。
+ * @param *stream   ビットストリームのハンドル
+ * @param value     書き込む値
  */
-void write_bool(FILE* file, const bool value) {
+void write_bool(bit_stream* stream, const bool value) {
     size_t actual_write = 0;
     const uint8_t _true = 1;
     const uint8_t _false = 0;
 
     if (value) {
-        actual_write = fwrite(&_true, sizeof(uint8_t), 1, file);
+        actual_write = bit_stream_write_bytes(stream, &_true, sizeof(uint8_t));
     }
     else {
-        actual_write = fwrite(&_false, sizeof(uint8_t), 1, file);
+        actual_write = bit_stream_write_bytes(stream, &_false, sizeof(uint8_t));
     }
 
     if (actual_write < 1) {
@@ -158,93 +158,93 @@ void write_bool(FILE* file, const bool value) {
 }
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルにASCII文字を書き込む。
- * @param file  ファイルポインタ
- * @param value 書き込む値
+ * @brief           指定されたビットストリームにASCII文字を書き込む。
+ * @param *stream   ビットストリームのハンドル
+ * @param value     書き込む値
  */
-void write_char(FILE* file, const char value) {
-    size_t actual_write = fwrite(&value, sizeof(char), 1, file);
+void write_char(bit_stream* stream, const char value) {
+    size_t actual_write = bit_stream_write_bytes(stream, &value, sizeof(char));
 
-    if (actual_write < 1) {
+    if (actual_write < sizeof(char)) {
         report_error(NEAC_ERROR_FILE_ACCESS_FAILED_TO_WRITE_CHAR);
     }
 }
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルに文字列を書き込む。
- * @param file  ファイルポインタ
- * @param value 書き込む値
+ * @brief           指定されたビットストリームに文字列を書き込む。
+ * @param *stream   ビットストリームのハンドル
+ * @param value     書き込む値
  */
-void write_string(FILE* file, const char* value, uint32_t bytes) {
+void write_string(bit_stream* stream, const char* value, uint32_t bytes) {
     uint8_t i;
 
     for (i = 0; i < bytes - 1; ++i) {
-        write_char(file, value[i]);
+        write_char(stream, value[i]);
     }
-    write_char(file, '\0');         /* 末端文字 */
+    write_char(stream, '\0');         /* 末端文字 */
 }
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルに8ビット整数を書き込む。
- * @param file  ファイルポインタ
- * @param value 書き込む値
+ * @brief           指定されたビットストリームに8ビット整数を書き込む。
+ * @param *stream   ビットストリームのハンドル
+ * @param value     書き込む値
  */
-void write_uint8(FILE* file, const uint8_t value) {
-    size_t actual_write = fwrite(&value, sizeof(uint8_t), 1, file);
+void write_uint8(bit_stream* stream, const uint8_t value) {
+    size_t actual_write = bit_stream_write_bytes(stream, &value, sizeof(uint8_t));
 
-    if (actual_write < 1) {
+    if (actual_write < sizeof(uint8_t)) {
         report_error(NEAC_ERROR_FILE_ACCESS_FAILED_TO_WRITE_UINT8);
     }
 }
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルに16ビット整数を書き込む。
- * @param file  ファイルポインタ
- * @param value 書き込む値
+ * @brief           指定されたビットストリームに16ビット整数を書き込む。
+ * @param *stream   ビットストリームのハンドル
+ * @param value     書き込む値
  */
-void write_uint16(FILE* file, const uint16_t value) {
-    size_t actual_write = fwrite(&value, sizeof(uint16_t), 1, file);
+void write_uint16(bit_stream* stream, const uint16_t value) {
+    size_t actual_write = bit_stream_write_bytes(stream, &value, sizeof(uint16_t));
 
-    if (actual_write < 1) {
+    if (actual_write < sizeof(uint16_t)) {
         report_error(NEAC_ERROR_FILE_ACCESS_FAILED_TO_WRITE_UINT16);
     }
 }
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルに32ビット整数を書き込む。
- * @param file  ファイルポインタ
- * @param value 書き込む値
+ * @brief           指定されたビットストリームに32ビット整数を書き込む。
+ * @param *stream   ビットストリームのハンドル
+ * @param value     書き込む値
  */
-void write_uint32(FILE* file, const uint32_t value) {
-    size_t actual_write = fwrite(&value, sizeof(uint32_t), 1, file);
+void write_uint32(bit_stream* stream, const uint32_t value) {
+    size_t actual_write = bit_stream_write_bytes(stream, &value, sizeof(uint32_t));
 
-    if (actual_write < 1) {
+    if (actual_write < sizeof(uint32_t)) {
         report_error(NEAC_ERROR_FILE_ACCESS_FAILED_TO_WRITE_UINT32);
     }
 }
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルに16符号付きビット整数を書き込む。
- * @param file  ファイルポインタ
- * @param value 書き込む値
+ * @brief           指定されたビットストリームに16符号付きビット整数を書き込む。
+ * @param *stream   ビットストリームのハンドル
+ * @param value     書き込む値
  */
-void write_int16(FILE* file, const int16_t value) {
-    size_t actual_write = fwrite(&value, sizeof(int16_t), 1, file);
+void write_int16(bit_stream* stream, const int16_t value) {
+    size_t actual_write = bit_stream_write_bytes(stream, &value, sizeof(int16_t));
 
-    if (actual_write < 1) {
+    if (actual_write < sizeof(int16_t)) {
         report_error(NEAC_ERROR_FILE_ACCESS_FAILED_TO_WRITE_INT16);
     }
 }
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルに32ビット符号付整数を書き込む。
- * @param file  ファイルポインタ
- * @param value 書き込む値
+ * @brief           指定されたビットストリームに32ビット符号付整数を書き込む。
+ * @param *stream   ビットストリームのハンドル
+ * @param value     書き込む値
  */
-void write_int32(FILE* file, const int32_t value) {
-    size_t actual_write = fwrite(&value, sizeof(int32_t), 1, file);
+void write_int32(bit_stream* stream, const int32_t value) {
+    size_t actual_write = bit_stream_write_bytes(stream, &value, sizeof(int32_t));
 
-    if (actual_write < 1) {
+    if (actual_write < sizeof(int32_t)) {
         report_error(NEAC_ERROR_FILE_ACCESS_FAILED_TO_WRITE_INT32);
     }
 }
\ No newline at end of file
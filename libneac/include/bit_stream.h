@@ -4,15 +4,22 @@
 #define BIT_STREAM_MODE_READ	0x00
 #define BIT_STREAM_MODE_WRITE	0x01
 
+#define BIT_STREAM_BYTE_BUFFER_SIZE     65536   /* ファイルとの間で一括で読み書きするバイト数 */
+
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 
 typedef struct {
-    FILE* file;
+    FILE* file;                 /* 扱うファイルのファイルハンドル。メモリ上のデータを扱う場合はNULL */
     uint32_t mode;
-    uint8_t buffer;
-    uint32_t buffer_position;
+    uint64_t bit_buffer;        /* ビット窓。読み込み時は最上位ビットから順に消費し、書き込み時は最上位ビットから順に蓄積する。 */
+    uint32_t bit_count;         /* ビット窓に格納されている有効なビット数 */
+    uint8_t* byte_buffer;       /* ファイルとの間でまとめて読み書きするバイト列を格納する領域。メモリ上のデータを扱う場合はデータそのもの */
+    size_t byte_buffer_size;    /* byte_bufferのサイズ */
+    size_t byte_position;       /* byte_bufferの次に読み書きするバイトのオフセット */
+    size_t byte_length;         /* byte_bufferに格納されている有効なバイト数（読み込み時のみ使用） */
+    bool owns_byte_buffer;      /* byte_bufferをビットストリームが解放すべきかどうかを示すフラグ */
 } bit_stream;
 
 /*!
@@ -24,11 +31,46 @@ typedef struct {
 bit_stream* bit_stream_create(FILE* file, uint32_t mode);
 
 /*!
- * @brief           ビットストリームを初期化します。
+ * @brief           メモリ上のデータを読み込む、読み込みモードのビットストリームを生成します。データはコピーされません。
+ * @param *data     読み込むデータのポインタ。ビットストリームを解放するまで有効である必要があります。
+ * @param size      読み込むデータのバイト数
+ * @return          ビットストリームのハンドル
+ */
+bit_stream* bit_stream_create_memory_reader(const uint8_t* data, size_t size);
+
+/*!
+ * @brief           メモリ上の領域に書き込む、書き込みモードのビットストリームを生成します。領域は必要に応じて自動的に拡張されます。
+ * @return          ビットストリームのハンドル
+ */
+bit_stream* bit_stream_create_memory_writer();
+
+/*!
+ * @brief           ビットストリームが内部で確保した領域を解放します。
+ * @param *stream   ビットストリームのハンドル
+ */
+void bit_stream_free(bit_stream* stream);
+
+/*!
+ * @brief           ビットストリームを初期化します。読み込みモードの場合、先読み済みのデータはすべて破棄されます。
  * @param *stream   ビットストリームのハンドル
  */
 void bit_stream_init(bit_stream* stream);
 
+/*!
+ * @brief           読み込みモードのビットストリームを、データの先頭に巻き戻します。
+ * @param *stream   ビットストリームのハンドル
+ */
+void bit_stream_rewind(bit_stream* stream);
+
+/*!
+ * @brief           メモリ上に書き込むビットストリームで、書き込まれたデータを取得します。
+ * @param *stream   ビットストリームのハンドル
+ * @param *size     [出力]書き込まれたデータのバイト数
+ * @return          書き込まれたデータのポインタ。ビットストリームを解放するまで有効です。ファイルに書き込むビットストリームの場合はNULLを返します。
+ * @note            bit_stream_close を呼び出すまでは、ビット窓に残っているデータは含まれません。
+ */
+const uint8_t* bit_stream_get_memory(bit_stream* stream, size_t* size);
+
 /*!
  * @brief           ビットストリームから1ビット読み込みます。
  * @param *stream   ビットストリームのハンドル
@@ -44,6 +86,39 @@ bool bit_stream_read_bit(bit_stream* stream);
  */
 uint32_t bit_stream_read_uint(bit_stream* stream, uint32_t bits);
 
+/*!
+ * @brief           ビットストリームの次の任意ビット数を、読み込み位置を進めずに取得します。
+ * @param *stream   ビットストリームのハンドル
+ * @param bits      取得するビット数（32以下）
+ * @return          取得されたビット列を整数として解釈した値
+ */
+uint32_t bit_stream_peek_uint(bit_stream* stream, uint32_t bits);
+
+/*!
+ * @brief           ビットストリームの読み込み位置を、指定されたビット数だけ進めます。
+ * @param *stream   ビットストリームのハンドル
+ * @param bits      読み飛ばすビット数
+ */
+void bit_stream_skip_bits(bit_stream* stream, uint32_t bits);
+
+/*!
+ * @brief           ビットストリームから、unary符号化された値（終端の0までに連続する1の数）を読み込みます。
+ * @param *stream   ビットストリームのハンドル
+ * @param limit     読み込む1の数の上限
+ * @return          読み込まれた値。1がlimit個連続した場合は、終端の0を読み込まずにlimitを返します。
+ */
+uint32_t bit_stream_read_unary(bit_stream* stream, uint32_t limit);
+
+/*!
+ * @brief           ビットストリームから任意バイト数のデータを読み込みます。
+ * @param *stream   ビットストリームのハンドル
+ * @param *data     読み込んだデータを格納する領域のポインタ
+ * @param size      読み込むバイト数
+ * @return          実際に読み込まれたバイト数
+ * @note            各バイトは最下位ビットから順に読み込まれます。バイト境界に位置している場合、データはそのまま転送されます。
+ */
+size_t bit_stream_read_bytes(bit_stream* stream, void* data, size_t size);
+
 /*!
  * @brief           ビットストリームに1ビット書き込みます。
  * @param *stream   ビットストリームのハンドル
@@ -55,10 +130,20 @@ void bit_stream_write_bit(bit_stream* stream, bool bit);
  * @brief           ビットストリームに任意ビット数の整数を書き込みます。
  * @param *stream   ビットストリームのハンドル
  * @param value     書き込む整数
- * @param num_bits  書き込む整数のビット数
+ * @param num_bits  書き込む整数のビット数（32以下）
  */
 void bit_stream_write_uint(bit_stream* stream, uint32_t value, uint32_t num_bits);
 
+/*!
+ * @brief           ビットストリームに任意バイト数のデータを書き込みます。
+ * @param *stream   ビットストリームのハンドル
+ * @param *data     書き込むデータのポインタ
+ * @param size      書き込むバイト数
+ * @return          実際に書き込まれたバイト数
+ * @note            各バイトは最下位ビットから順に書き込まれます。バイト境界に位置している場合、データはそのまま転送されます。
+ */
+size_t bit_stream_write_bytes(bit_stream* stream, const void* data, size_t size);
+
 /*!
  * @brief			バッファに残っている、ファイルポインタが示すファイルに書き込まれていない値を無条件に書き込みます。
  * @param *stream	ビットストリームのハンドル
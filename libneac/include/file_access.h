@@ -3,118 +3,118 @@
 
 #include <stdbool.h>
 #include <stdint.h>
-#include <stdio.h>
+#include "bit_stream.h"
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルから、真偽値を読み込みます。
- * @param file  ファイルポインタ
- * @return      真偽値
+ * @brief           指定されたビットストリームから、真偽値を読み込みます。
+ * @param *stream   ビットストリームのハンドル
+ * @return          真偽値
  */
-bool read_bool(FILE* file);
+bool read_bool(bit_stream* stream);
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルから16ビット符号付き整数を読み込みます。
- * @param file  ファイルポインタ
- * @return      読み込まれた値
+ * @brief           指定されたビットストリームから16ビット符号付き整数を読み込みます。
+ * @param *stream   ビットストリームのハンドル
+ * @return          読み込まれた値
  */
-int16_t read_int16(FILE* file);
+int16_t read_int16(bit_stream* stream);
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルから32ビット符号付き整数を読み込みます。
- * @param file  ファイルポインタ
- * @return      読み込まれた値
+ * @brief           指定されたビットストリームから32ビット符号付き整数を読み込みます。
+ * @param *stream   ビットストリームのハンドル
+ * @return          読み込まれた値
  */
-int32_t read_int32(FILE* file);
+int32_t read_int32(bit_stream* stream);
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルからASCII文字を読み込みます。
- * @param file  ファイルポインタ
- * @return      読み込まれた値
+ * @brief           指定されたビットストリームからASCII文字を読み込みます。
+ * @param *stream   ビットストリームのハンドル
+ * @return          読み込まれた値
  */
-char read_char(FILE* file);
+char read_char(bit_stream* stream);
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルから文字列を読み込みます。
- * @param file  ファイルポインタ
- * @return      読み込まれた値
+ * @brief           指定されたビットストリームから文字列を読み込みます。
+ * @param *stream   ビットストリームのハンドル
+ * @return          読み込まれた値
  */
-const char* read_string(FILE* file, uint32_t bytes);
+const char* read_string(bit_stream* stream, uint32_t bytes);
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルから8ビット整数を読み込みます。
- * @param file  ファイルポインタ
- * @return      読み込まれた値
+ * @brief           指定されたビットストリームから8ビット整数を読み込みます。
+ * @param *stream   ビットストリームのハンドル
+ * @return          読み込まれた値
  */
-uint8_t read_uint8(FILE* file);
+uint8_t read_uint8(bit_stream* stream);
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルから16ビット整数を読み込みます。
- * @param file  ファイルポインタ
- * @return      読み込まれた値
+ * @brief           指定されたビットストリームから16ビット整数を読み込みます。
+ * @param *stream   ビットストリームのハンドル
+ * @return          読み込まれた値
  */
-uint16_t read_uint16(FILE* file);
+uint16_t read_uint16(bit_stream* stream);
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルから32ビット整数を読み込みます。
- * @param file  ファイルポインタ
- * @return      読み込まれた値
+ * @brief           指定されたビットストリームから32ビット整数を読み込みます。
+ * @param *stream   ビットストリームのハンドル
+ * @return          読み込まれた値
  */
-uint32_t read_uint32(FILE* file);
+uint32_t read_uint32(bit_stream* stream);
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルに真偽値を書き込む。
- * @param file  ファイルポインタ
- * @param value 書き込む値
+ * @brief           指定されたビットストリームに真偽値を書き込む。
+ * @param *stream   ビットストリームのハンドル
+ * @param value     書き込む値
  */
-void write_bool(FILE* file, const bool value);
+void write_bool(bit_stream* stream, const bool value);
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルにASCII文字を書き込む。
- * @param file  ファイルポインタ
- * @param value 書き込む値
+ * @brief           指定されたビットストリームにASCII文字を書き込む。
+ * @param *stream   ビットストリームのハンドル
+ * @param value     書き込む値
  */
-void write_char(FILE* file, const char value);
+void write_char(bit_stream* stream, const char value);
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルに文字列を書き込む。
- * @param file  ファイルポインタ
- * @param value 書き込む値
+ * @brief           指定されたビットストリームに文字列を書き込む。
+ * @param *stream   ビットストリームのハンドル
+ * @param value     書き込む値
  */
-void write_string(FILE* file, const char* value, uint32_t bytes);
+void write_string(bit_stream* stream, const char* value, uint32_t bytes);
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルに8ビット整数を書き込む。
- * @param file  ファイルポインタ
- * @param value 書き込む値
+ * @brief           指定されたビットストリームに8ビット整数を書き込む。
+ * @param *stream   ビットストリームのハンドル
+ * @param value     書き込む値
  */
-void write_uint8(FILE* file, const uint8_t value);
+void write_uint8(bit_stream* stream, const uint8_t value);
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルに16ビット整数を書き込む。
- * @param file  ファイルポインタ
- * @param value 書き込む値
+ * @brief           指定されたビットストリームに16ビット整数を書き込む。
+ * @param *stream   ビットストリームのハンドル
+ * @param value     書き込む値
  */
-void write_uint16(FILE* file, const uint16_t value);
+void write_uint16(bit_stream* stream, const uint16_t value);
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルに32ビット整数を書き込む。
- * @param file  ファイルポインタ
- * @param value 書き込む値
+ * @brief           指定されたビットストリームに32ビット整数を書き込む。
+ * @param *stream   ビットストリームのハンドル
+ * @param value     書き込む値
  */
-void write_uint32(FILE* file, const uint32_t value);
+void write_uint32(bit_stream* stream, const uint32_t value);
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルに16符号付きビット整数を書き込む。
- * @param file  ファイルポインタ
- * @param value 書き込む値
+ * @brief           指定されたビットストリームに16符号付きビット整数を書き込む。
+ * @param *stream   ビットストリームのハンドル
+ * @param value     書き込む値
  */
-void write_int16(FILE* file, const int16_t value);
+void write_int16(bit_stream* stream, const int16_t value);
 
 /*!
- * @brief       指定されたファイルポインタが示すファイルに32ビット符号付整数を書き込む。
- * @param file  ファイルポインタ
- * @param value 書き込む値
+ * @brief           指定されたビットストリームに32ビット符号付整数を書き込む。
+ * @param *stream   ビットストリームのハンドル
+ * @param value     書き込む値
  */
-void write_int32(FILE* file, const int32_t value);
+void write_int32(bit_stream* stream, const int32_t value);
 
 #endif
\ No newline at end of file
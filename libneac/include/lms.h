@@ -1,23 +1,75 @@
 #ifndef LMS_HEADER_INCLUDED
 #define LMS_HEADER_INCLUDED
 
-#define LMS_MAX_TAPS    32
+#define LMS_MAX_TAPS            32      /* 多項式予測器に続くLMSフィルタの最大タップ数 */
+#define LMS_CASCADE_MAX_STAGES  3       /* その前段に置く多段のLMSフィルタの最大段数 */
+#define LMS_CASCADE_MAX_TAPS    1024    /* 多段のLMSフィルタの各段の最大タップ数 */
+#define LMS_MAX_SHIFT           31      /* シフト係数の最大値 */
 
+#define LMS_MODE_SIGN_SIGN      0       /* 予測残差と過去サンプルの符号で重み係数を更新するSSLMS */
+#define LMS_MODE_NORMALIZED     1       /* 過去サンプルの大きさで正規化したステップで重み係数を更新するNLMS */
+#define LMS_MODE_MAX            LMS_MODE_NORMALIZED
+#define LMS_NLMS_WEIGHT_BITS    14      /* NLMSの重み係数の小数部のビット数 */
+
+#include "polynomial_predictor.h"
 #include "signal.h"
 #include <stdint.h>
 
+/* 重み係数と過去サンプルの積をシフト係数で右シフトした値の総和を求める関数 */
+typedef signal (*lms_predict_kernel)(const signal* weights, const signal* history, uint32_t taps, uint32_t shift);
+
+/* 重み係数に、予測残差の符号と過去サンプルの符号の積を加算する関数 */
+typedef void (*lms_update_kernel)(signal* weights, const signal* history, uint32_t taps, int32_t sign);
+
+/* 重み係数に、予測残差と過去サンプルの積を右シフトした値を加算する関数（NLMS用） */
+typedef void (*lms_normalized_update_kernel)(signal* weights, const signal* history, uint32_t taps, int32_t residual, uint32_t shift);
+
+/* 予測次数とシフト係数を定数として、多項式予測器とLMSフィルタをサブブロック単位で適用する関数。
+   多項式予測器の過去サンプルがNULLならLMSフィルタのみを適用する。更新後の最新の過去サンプルの位置を返す */
+typedef uint32_t (*lms_block_kernel)(signal* weights, signal* history, uint32_t position, signal* poly_history, signal* data, uint32_t size);
+
 typedef struct {
-    uint32_t taps;              /* 予測次数 */
-    uint8_t shift;              /* シフト係数 */
-    signal* history;            /* 過去サンプル領域のポインタ */
-    signal* weights;            /* 重み係数領域のポインタ */
+    uint32_t taps;                        /* 予測次数 */
+    uint8_t mode;                         /* 重み係数の更新方式（LMS_MODE_*） */
+    uint8_t shift;                        /* シフト係数（NLMSではステップの大きさを表すシフト量） */
+    signal* history;                      /* 過去サンプル領域のポインタ（予測次数の2倍の長さのリングバッファ） */
+    uint32_t position;                    /* 最新の過去サンプルの位置 */
+    signal* weights;                      /* 重み係数領域のポインタ */
+    uint64_t energy;                      /* 右シフトした過去サンプルの2乗和（NLMSのみ使用） */
+    uint8_t energy_shift;                 /* 2乗和が64ビットに収まるよう、過去サンプルを右シフトするビット数（NLMSのみ使用） */
+    int32_t step_bias;                    /* NLMSの更新時のシフト量に加える定数（NLMSのみ使用） */
+    lms_predict_kernel predict_kernel;    /* 予測に用いる関数（CPUの機能に応じて選択） */
+    lms_update_kernel update_kernel;      /* 重み係数の更新に用いる関数（CPUの機能に応じて選択） */
+    lms_normalized_update_kernel normalized_update_kernel;  /* NLMSの重み係数の更新に用いる関数（CPUの機能に応じて選択） */
+    lms_block_kernel encode_block_kernel; /* サブブロック単位で予測残差を求める関数（該当する関数がなければNULL） */
+    lms_block_kernel decode_block_kernel; /* サブブロック単位で信号を復元する関数（該当する関数がなければNULL） */
 } lms;
 
 /*!
  * @brief           LMSフィルタのハンドルを生成します。
+ * @param taps      予測次数
+ * @param mode      重み係数の更新方式（LMS_MODE_*）
+ * @param pcm_bits  PCMの量子化ビット数
+ * @return          LMSフィルタのハンドル
+ */
+lms* lms_create(uint8_t taps, uint8_t mode, uint8_t pcm_bits);
+
+/*!
+ * @brief           シフト係数を指定して、LMSフィルタのハンドルを生成します。
+ * @param taps      予測次数（LMS_CASCADE_MAX_TAPS以下）
+ * @param mode      重み係数の更新方式（LMS_MODE_*）
+ * @param shift     シフト係数
  * @return          LMSフィルタのハンドル
  */
-lms* lms_create(uint8_t taps, uint8_t pcm_bits);
+lms* lms_create_with_shift(uint16_t taps, uint8_t mode, uint8_t shift);
+
+/*!
+ * @brief           更新方式とPCMのビット数に応じたシフトファクタを返します。
+ * @param mode      重み係数の更新方式（LMS_MODE_*）
+ * @param pcm_bits  PCMの量子化ビット数
+ * @return          シフトファクタ
+ */
+uint8_t lms_get_default_shift(uint8_t mode, uint8_t pcm_bits);
 
 /*!
  * @brief           LMSフィルタを解放します。
@@ -31,6 +83,13 @@ void lms_free(lms* filter);
  */
 void lms_clear(lms* filter);
 
+/*!
+ * @brief           LMSフィルタの状態を、同じ設定で生成された別のLMSフィルタに複製します。
+ * @param *dest     複製先のLMSフィルタのハンドル
+ * @param *source   複製元のLMSフィルタのハンドル
+ */
+void lms_copy(lms* dest, const lms* source);
+
 /*!
  * @brief           PCMサンプルを予測します。
  * @param *filter   LMSフィルタのハンドル
@@ -46,4 +105,38 @@ signal lms_predict(lms* filter);
  */
 void lms_update(lms* filter, signal sample, signal residual);
 
+/*!
+ * @brief           サブブロックの信号に多項式予測器とLMSフィルタを続けて適用し、予測残差に置き換えます。
+ * @param *filter   LMSフィルタのハンドル
+ * @param *poly     多項式予測器のハンドル
+ * @param *data     [入出力]信号。予測残差で上書きされます。
+ * @param size      信号のサンプル数
+ */
+void lms_encode_block(lms* filter, polynomial_predictor* poly, signal* data, uint32_t size);
+
+/*!
+ * @brief           LMSフィルタと多項式予測器の予測残差から、サブブロックの信号を復元します。
+ * @param *filter   LMSフィルタのハンドル
+ * @param *poly     多項式予測器のハンドル
+ * @param *data     [入出力]予測残差。復元された信号で上書きされます。
+ * @param size      信号のサンプル数
+ */
+void lms_decode_block(lms* filter, polynomial_predictor* poly, signal* data, uint32_t size);
+
+/*!
+ * @brief           サブブロックの信号をLMSフィルタのみで予測し、予測残差に置き換えます。多段のLMSフィルタの各段に用います。
+ * @param *filter   LMSフィルタのハンドル
+ * @param *data     [入出力]信号。予測残差で上書きされます。
+ * @param size      信号のサンプル数
+ */
+void lms_encode_stage(lms* filter, signal* data, uint32_t size);
+
+/*!
+ * @brief           LMSフィルタのみの予測残差から、サブブロックの信号を復元します。多段のLMSフィルタの各段に用います。
+ * @param *filter   LMSフィルタのハンドル
+ * @param *data     [入出力]予測残差。復元された信号で上書きされます。
+ * @param size      信号のサンプル数
+ */
+void lms_decode_stage(lms* filter, signal* data, uint32_t size);
+
 #endif
\ No newline at end of file
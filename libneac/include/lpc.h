@@ -0,0 +1,116 @@
+#ifndef LPC_HEADER_INCLUDED
+#define LPC_HEADER_INCLUDED
+
+#define LPC_MAX_ORDER                   32      /* 線形予測の最大次数 */
+#define LPC_SHIFT_NEED_BITS             5       /* 量子化された係数のシフト量の保存に要するビット数 */
+#define LPC_MAX_SHIFT                   31      /* 量子化された係数のシフト量の最大値 */
+#define LPC_COEFFICIENT_BITS_NEED_BITS  4       /* 量子化された係数1個あたりのビット数-1の保存に要するビット数 */
+#define LPC_MAX_COEFFICIENT_PRECISION   15      /* 量子化された係数の、符号を含むビット数の最大値 */
+
+#include "signal.h"
+#include <stdint.h>
+
+typedef struct {
+    signal* history;        /* 過去サンプル領域のポインタ（最大次数の2倍の長さのリングバッファ） */
+    uint32_t position;      /* 最新の過去サンプルの位置 */
+} lpc;
+
+/*!
+ * @brief               線形予測器のハンドルを生成します。
+ * @return              線形予測器のハンドル
+ */
+lpc* lpc_create();
+
+/*!
+ * @brief               線形予測器を解放します。
+ * @param *predictor    線形予測器のハンドル
+ */
+void lpc_free(lpc* predictor);
+
+/*!
+ * @brief               線形予測器を初期化します。
+ * @param *predictor    線形予測器のハンドル
+ */
+void lpc_clear(lpc* predictor);
+
+/*!
+ * @brief                   指定された係数で、次に続くPCMサンプルを予測します。
+ * @param *predictor        線形予測器のハンドル
+ * @param *coefficients     量子化された係数（新しい過去サンプルに掛かるものから順）
+ * @param order             予測次数
+ * @param shift             量子化された係数のシフト量
+ * @return                  予測されたPCMサンプル
+ */
+signal lpc_predict(const lpc* predictor, const signal* coefficients, uint8_t order, uint8_t shift);
+
+/*!
+ * @brief               線形予測器の過去サンプルを更新します。
+ * @param *predictor    線形予測器のハンドル
+ * @param sample        PCMサンプル
+ */
+void lpc_update(lpc* predictor, signal sample);
+
+/*!
+ * @brief               線形予測器を使用しないサブブロックの信号で、過去サンプルのみを更新します。
+ * @param *predictor    線形予測器のハンドル
+ * @param *data         信号
+ * @param size          信号のサンプル数
+ */
+void lpc_update_block(lpc* predictor, const signal* data, uint32_t size);
+
+/*!
+ * @brief               線形予測器の過去サンプルを取得します。
+ * @param *predictor    線形予測器のハンドル
+ * @param *history      [出力]新しい順の過去サンプル
+ * @param count         取得する過去サンプルの数（LPC_MAX_ORDER以下）
+ */
+void lpc_get_history(const lpc* predictor, signal* history, uint32_t count);
+
+/*!
+ * @brief                   サブブロックの信号を指定された係数で予測し、予測残差に置き換えます。
+ * @param *predictor        線形予測器のハンドル
+ * @param *coefficients     量子化された係数（新しい過去サンプルに掛かるものから順）
+ * @param order             予測次数
+ * @param shift             量子化された係数のシフト量
+ * @param *data             [入出力]信号。予測残差で上書きされます。
+ * @param size              信号のサンプル数
+ */
+void lpc_encode_block(lpc* predictor, const signal* coefficients, uint8_t order, uint8_t shift, signal* data, uint32_t size);
+
+/*!
+ * @brief                   指定された係数による予測残差から、サブブロックの信号を復元します。
+ * @param *predictor        線形予測器のハンドル
+ * @param *coefficients     量子化された係数（新しい過去サンプルに掛かるものから順）
+ * @param order             予測次数
+ * @param shift             量子化された係数のシフト量
+ * @param *data             [入出力]予測残差。復元された信号で上書きされます。
+ * @param size              信号のサンプル数
+ */
+void lpc_decode_block(lpc* predictor, const signal* coefficients, uint8_t order, uint8_t shift, signal* data, uint32_t size);
+
+/*!
+ * @brief                   指定された係数による予測残差の絶対値の合計を、過去サンプルを更新せずに求めます。
+ * @param *predictor        線形予測器のハンドル
+ * @param *coefficients     量子化された係数（新しい過去サンプルに掛かるものから順）
+ * @param order             予測次数
+ * @param shift             量子化された係数のシフト量
+ * @param *data             信号
+ * @param size              信号のサンプル数
+ * @return                  予測残差の絶対値の合計
+ */
+uint64_t lpc_compute_residual_sum(const lpc* predictor, const signal* coefficients, uint8_t order, uint8_t shift, const signal* data, uint32_t size);
+
+/*!
+ * @brief                   サブブロックの信号の自己相関からレビンソン・ダービン法で係数を求め、量子化します。
+ * @param *data             信号
+ * @param size              信号のサンプル数
+ * @param max_order         予測次数の上限（LPC_MAX_ORDER以下）
+ * @param precision         量子化された係数の、符号を含むビット数（LPC_MAX_COEFFICIENT_PRECISION以下）
+ * @param *work             窓関数を掛けた信号を格納する、信号のサンプル数分の作業領域
+ * @param *coefficients     [出力]量子化された係数（新しい過去サンプルに掛かるものから順）
+ * @param *shift            [出力]量子化された係数のシフト量
+ * @return                  推定される符号量が最小となる予測次数。線形予測が適さない信号では0
+ */
+uint8_t lpc_compute_coefficients(const signal* data, uint32_t size, uint8_t max_order, uint8_t precision, double* work, signal* coefficients, uint8_t* shift);
+
+#endif
\ No newline at end of file
@@ -12,6 +12,29 @@
 #define CONVERT_INT32_TO_UINT32(value) ((uint32_t)((LSHIFT((value), 1)) ^ (RSHIFT((value), 31))))
 #define CONVERT_UINT32_TO_INT32(value) ((int32_t)(RSHIFT((value), 1) ^ (-(int32_t)((value) & 1))))
 
-#define POLYNOMIAL_PREDICATOR_MAX_HISTORY   2
+#define POLYNOMIAL_PREDICATOR_MAX_HISTORY   4
+
+/* 64ビット整数の最上位ビットから連続するゼロの数を数える（xはゼロ以外である必要がある） */
+#if defined(__GNUC__) || defined(__clang__)
+#define COUNT_LEADING_ZEROS64(x) ((uint32_t)__builtin_clzll(x))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+static __inline uint32_t count_leading_zeros64(uint64_t x) {
+    unsigned long index;
+    _BitScanReverse64(&index, x);
+    return (uint32_t)(63 - index);
+}
+#define COUNT_LEADING_ZEROS64(x) count_leading_zeros64(x)
+#else
+static inline uint32_t count_leading_zeros64(uint64_t x) {
+    uint32_t n = 0;
+    while ((x & 0x8000000000000000ULL) == 0) {
+        x <<= 1;
+        ++n;
+    }
+    return n;
+}
+#define COUNT_LEADING_ZEROS64(x) count_leading_zeros64(x)
+#endif
 
 #endif
@@ -4,7 +4,12 @@
 #define LIBNEAC_VERSION_MAJOR 1             /* NEACライブラリのメジャーバージョン */
 #define LIBNEAC_VERSION_MINOR 0             /* NEACライブラリのマイナーバージョン */
 
-#define NEAC_ENCODER_FORMAT_VERSION 0x01    /* エンコーダが出力するファイルのフォーマットのバージョン */
+#define NEAC_ENCODER_FORMAT_VERSION 0x03    /* エンコーダが出力するファイルのフォーマットのバージョン */
 #define NEAC_DECODER_FORMAT_VERSION 0x01    /* デコーダがデコード可能なファイルのフォーマットの最小バージョンのバージョン番号 */
 
+/* 各機能が導入されたフォーマットのバージョン */
+#define NEAC_FORMAT_VERSION_RICE_ESCAPE 0x02    /* ライス符号の長すぎる商のエスケープ */
+#define NEAC_FORMAT_VERSION_EXTENDED 0x03       /* パーティション数の拡張、ヘッダでのエントロピー符号化の方式・多段のLMSフィルタ・LMSフィルタの更新方式・線形予測の指定、
+                                                 * サブブロック毎の種類・下位のゼロのビット数・多項式予測器の次数の指定、ゼロ連続長符号と固定長のパーティション */
+
 #endif
\ No newline at end of file
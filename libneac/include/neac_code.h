@@ -3,34 +3,98 @@
 
 #define RESTORE_PARTITION_COUNT(partition_parameter) (LSHIFT(1, partition_parameter))
 #define RESTORE_PARTITION_SIZE(data_size, partition_parameter) ((data_size) / RESTORE_PARTITION_COUNT(partition_parameter))
+/* パーティションの拡張後のフォーマットにおける、partition_index番目のパーティションの開始位置（端数のサンプルを各パーティションに分散させる） */
+#define RESTORE_PARTITION_START(data_size, partition_parameter, partition_index) ((uint32_t)RSHIFT((uint32_t)(partition_index) * (data_size), (partition_parameter)))
 
 #define ENTROPY_PARAMETER_NEED_BITS                 5
 #define ENTROPY_PARAMETER_MIN                       0
 #define ENTROPY_RICE_PARAMETER_MIN                  ENTROPY_PARAMETER_MIN
 #define ENTROPY_RICE_PARAMETER_MAX                  ENTROPY_RICE_PARAMETER_MIN + 30
 #define ENTROPY_PARAMETER_BLANK_PARTITION           ENTROPY_RICE_PARAMETER_MAX + 1
+
+/* ゼロ連続長符号が導入された後のフォーマットでは、ライス符号化のパラメータの上限を下げ、空いた値を別の符号化に割り当てる */
+#define ENTROPY_PARTITION_RICE_PARAMETER_MAX        ENTROPY_RICE_PARAMETER_MIN + 28
+#define ENTROPY_PARAMETER_ZERO_RUN_PARTITION        ENTROPY_PARTITION_RICE_PARAMETER_MAX + 1   /* ゼロの連続長と非ゼロの値を交互に符号化するパーティション */
+#define ENTROPY_PARAMETER_FIXED_WIDTH_PARTITION     ENTROPY_PARTITION_RICE_PARAMETER_MAX + 2   /* 値を固定長で格納するパーティション */
+#define ENTROPY_FIXED_WIDTH_NEED_BITS               5       /* 固定長のパーティションで、値1個あたりのビット数-1の保存に要するビット数 */
 #define ENTROPY_PARAMETER_MAX                       LSHIFT(1, ENTROPY_PARAMETER_NEED_BITS)
 
-#define ENTROPY_PARTITION_PARAMETER_MIN             1
-#define ENTROPY_PARTITION_PARAMETER_MAX             ENTROPY_PARTITION_PARAMETER_MIN + 3
-#define ENTROPY_PARTITION_PARAMETER_NEED_BITS       2
+#define ENTROPY_PARTITION_PARAMETER_MIN             0
+#define ENTROPY_PARTITION_PARAMETER_MAX             8
+#define ENTROPY_PARTITION_PARAMETER_NEED_BITS       4
 #define ENTROPY_PARTITION_COUNT_MAX                 RESTORE_PARTITION_COUNT(ENTROPY_PARTITION_PARAMETER_MAX)
 
+/* パーティションパラメータの範囲が拡張される前のフォーマットにおける、パーティションパラメータの定義 */
+#define ENTROPY_LEGACY_PARTITION_PARAMETER_MIN      1
+#define ENTROPY_LEGACY_PARTITION_PARAMETER_NEED_BITS 2
+
+#define SUB_BLOCK_VALUE_BITS_NEED_BITS              5       /* 無圧縮・定数のサブブロックで、値1個あたりのビット数-1の保存に要するビット数 */
+
+#define ENTROPY_MODE_PARTITIONED_RICE               0x00    /* パーティション毎にパラメータを選ぶライス符号 */
+#define ENTROPY_MODE_ADAPTIVE_RICE                  0x01    /* 直近の値の大きさに応じて、サンプル毎にパラメータを更新するライス符号 */
+#define ENTROPY_MODE_RANGE_CODER                    0x02    /* 値の大きさを文脈とする適応型2値レンジコーダ（低速だが高圧縮） */
+#define ENTROPY_MODE_MAX                            ENTROPY_MODE_RANGE_CODER
+#define ENTROPY_MODE_DEFAULT                        ENTROPY_MODE_PARTITIONED_RICE
+
+#define ADAPTIVE_RICE_HISTORY_SHIFT                 4       /* 適応型ライス符号で、値の大きさの移動平均に用いる履歴の長さ（2のべき乗の指数） */
+#define ADAPTIVE_RICE_INITIAL_SAMPLES               16      /* 適応型ライス符号で、パラメータの初期値を求めるために用いるサンプル数 */
+
+#define RANGE_CODER_HISTORY_SHIFT                   4       /* レンジコーダで、文脈に用いる値の大きさの移動平均の履歴の長さ（2のべき乗の指数） */
+#define RANGE_CODER_CONTEXTS                        72      /* 値の大きさの移動平均から求める文脈の数（移動平均の2^RANGE_CODER_HISTORY_SHIFT倍を半オクターブ単位で区切った数） */
+#define RANGE_CODER_LENGTH_MAX                      32      /* 符号化する値に1を加えた値の、最上位ビットを除いたビット数の最大値 */
+#define RANGE_CODER_LENGTH_OFFSET_MAX               3       /* 仮数部の確率を切り替える、予測したビット数との差の最大値（絶対値） */
+#define RANGE_CODER_MODELED_BITS                    3       /* 最上位ビットに続くビットのうち、確率を用いて符号化するビット数 */
+#define RANGE_CODER_CHANNELS_MAX                    256     /* 値の大きさの移動平均をチャンネル毎に保持する最大のチャンネル数 */
+
+#define RICE_ESCAPE_QUOTIENT                        32      /* この数以上の商をエスケープし、値をそのまま書き込む（32以下） */
+#define RICE_ESCAPE_VALUE_BITS                      32      /* エスケープされた値のビット数 */
+
+#define RICE_DECODE_TABLE_BITS                      12      /* ライス符号の復号テーブルの索引に用いるビット数 */
+#define RICE_DECODE_TABLE_SIZE                      LSHIFT(1, RICE_DECODE_TABLE_BITS)
+#define RICE_DECODE_TABLE_PARAMETER_MAX             8       /* 復号テーブルを使用するライス符号化のパラメータの最大値 */
+#define RICE_DECODE_TABLE_MAX_SYMBOLS               4       /* 復号テーブルの1要素で復号する符号語の最大数 */
+
 #include "bit_stream.h"
 #include "neac_block.h"
+#include "range_coder.h"
+
+typedef struct {
+    uint8_t count;                                          /* 索引のビット列に完全に含まれる符号語の数 */
+    uint8_t lengths[RICE_DECODE_TABLE_MAX_SYMBOLS];         /* 先頭からi+1個目の符号語までの合計ビット数 */
+    int16_t values[RICE_DECODE_TABLE_MAX_SYMBOLS];          /* 復号された値 */
+} rice_decode_entry;
+
+typedef struct {
+    range_coder_probability split_probabilities[RANGE_CODER_CONTEXTS];                                 /* 文脈毎の、ビット数が予測したビット数以上であることを表すビットの確率 */
+    range_coder_probability upper_length_probabilities[RANGE_CODER_CONTEXTS][RANGE_CODER_LENGTH_MAX];  /* 文脈毎の、予測したビット数から数えたunary符号の各ビットの確率 */
+    range_coder_probability nearest_probabilities[RANGE_CODER_CONTEXTS];                               /* 文脈毎の、ビット数が予測したビット数より1少ないことを表すビットの確率 */
+    range_coder_probability lower_length_probabilities[RANGE_CODER_CONTEXTS][RANGE_CODER_LENGTH_MAX];  /* 文脈毎の、0から数えたunary符号の各ビットの確率 */
+    range_coder_probability mantissa_probabilities[RANGE_CODER_CONTEXTS][2 * RANGE_CODER_LENGTH_OFFSET_MAX + 1][LSHIFT(1, RANGE_CODER_MODELED_BITS)];  /* 文脈と予測したビット数との差毎の、最上位ビットに続くビットの確率（2分木の節点毎） */
+} range_value_model;
 
 typedef struct {
-    bit_stream* bitstream;      /* 入出力用ビットストリームのハンドル */
-    uint32_t* workA;            /* 作業領域A */
-    uint32_t* workB;            /* 作業領域B */
+    bit_stream* bitstream;                                  /* 入出力用ビットストリームのハンドル */
+    uint8_t format_version;                                 /* 読み書きするデータのフォーマットのバージョン */
+    uint8_t entropy_mode;                                   /* エントロピー符号化の方式 */
+    uint8_t lpc_order_bits;                                 /* サブブロック毎の線形予測の次数の保存に要するビット数（線形予測を使用しない場合は0） */
+    uint32_t* entropy_parameters;                           /* 各パーティションのエントロピー符号化のパラメータを格納する作業領域 */
+    uint64_t* partition_sums;                               /* 各パーティションの値の合計を格納する作業領域 */
+    range_coder* range_coder;                               /* レンジコーダのハンドル */
+    range_coder_probability blank_probability;              /* サブブロックがブランクであることを表すビットの確率 */
+    uint64_t* magnitude_sums;                               /* チャンネル毎の値の大きさの移動平均の2^RANGE_CODER_HISTORY_SHIFT倍 */
+    range_value_model value_model;                          /* 値を符号化する確率のモデル */
+    range_value_model trial_value_model;                    /* ビット数の見積もりで、確率を更新する作業領域 */
 } neac_code;
 
 /*!
- * @brief           ブロックを読み書きするAPIのハンドルを生成します。
- * @param *stream   ビットストリームのハンドル
- * @return          ブロック読み書きAPIのハンドル
+ * @brief                   ブロックを読み書きするAPIのハンドルを生成します。
+ * @param *stream           ビットストリームのハンドル
+ * @param format_version    読み書きするデータのフォーマットのバージョン
+ * @param entropy_mode      エントロピー符号化の方式
+ * @param max_lpc_order     サブブロック毎の線形予測の最大次数（線形予測を使用しない場合は0）
+ * @return                  ブロック読み書きAPIのハンドル
  */
-neac_code* neac_code_create(bit_stream* stream);
+neac_code* neac_code_create(bit_stream* stream, uint8_t format_version, uint8_t entropy_mode, uint8_t max_lpc_order);
 
 /*!
  * @brief           ブロックを読み書きするAPIのハンドルを解放します。
@@ -38,6 +102,29 @@ neac_code* neac_code_create(bit_stream* stream);
  */
 void neac_code_free(neac_code* coder);
 
+/*!
+ * @brief           ブロックを読み書きするAPIの、ブロック間で引き継がれる状態を初期化します。
+ * @param *coder    ブロック読み書きAPIのハンドル
+ */
+void neac_code_clear(neac_code* coder);
+
+/*!
+ * @brief               予測残差のサブブロックを、予測前の信号と比べて最もビット数が少なくなる種類のサブブロックに置き換えます。
+ * @param *coder        ブロック読み書きAPIのハンドル
+ * @param *sub_block    予測残差が格納されたサブブロックのハンドル
+ * @param *source       予測前の信号
+ */
+void neac_code_select_sub_block_type(neac_code* coder, neac_sub_block* sub_block, const signal* source);
+
+/*!
+ * @brief           予測残差をパーティション毎のライス符号で符号化した場合のビット数を見積もります。
+ * @param *coder    ブロック読み書きAPIのハンドル
+ * @param *data     予測残差
+ * @param size      予測残差のサンプル数
+ * @return          見積もったビット数
+ */
+uint32_t neac_code_estimate_bits(neac_code* coder, const signal* data, uint16_t size);
+
 /*!
  * @brief           ブロックを書き込みます。
  * @param *coder    ブロック読み書きAPIのハンドル
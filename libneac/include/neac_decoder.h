@@ -3,6 +3,7 @@
 
 #include "bit_stream.h"
 #include "lms.h"
+#include "lpc.h"
 #include "neac_block.h"
 #include "neac_code.h"
 #include "neac_tag.h"
@@ -15,7 +16,7 @@
  * @brief NEACデコーダ
  */
 typedef struct {
-    FILE* file;                                     /* ファイルハンドル */
+    FILE* file;                                     /* ファイルハンドル（メモリ上のデータをデコードする場合はNULL） */
     bit_stream* bit_stream;                         /* ビットストリームのハンドル */
 
     uint8_t format_version;                         /* フォーマットのバージョン */
@@ -23,13 +24,22 @@ typedef struct {
     uint8_t bits_per_sample;                        /* PCMの量子化ビット数 */
     uint8_t num_channels;                           /* チャンネル数 */
     uint32_t num_total_samples;                     /* ファイルに含まれるサンプルの総数 */
-    uint8_t filter_taps;                            /* SSLMSフィルタのタップ数 */
+    uint8_t filter_taps;                            /* 最後のLMSフィルタのタップ数 */
     uint16_t block_size;                            /* ブロック（厳密にはサブブロック）に含まれるサンプル数*/
     bool use_mid_side_stereo;                       /* ミッドサイドステレオが使用されているかどうかを示すフラグ */
     uint32_t num_blocks;                            /* ファイルに含まれるブロックの総数 */
+    uint8_t entropy_mode;                           /* エントロピー符号化の方式 */
+    uint8_t num_cascade_stages;                     /* 最後のLMSフィルタの前段に置かれた多段のLMSフィルタの段数 */
+    uint16_t cascade_taps[LMS_CASCADE_MAX_STAGES];  /* 多段のLMSフィルタの各段のタップ数 */
+    uint8_t cascade_shifts[LMS_CASCADE_MAX_STAGES]; /* 多段のLMSフィルタの各段のシフト係数 */
+    uint8_t lms_mode;                               /* LMSフィルタの重み係数の更新方式（LMS_MODE_*） */
+    uint8_t lpc_order;                              /* サブブロック毎の線形予測の最大次数（0なら線形予測を使用しない） */
 
-    lms** lms_filters;                              /* チャンネル毎のSSLMSフィルタのハンドルを格納する領域 */
+    lms** lms_filters;                              /* チャンネル毎の最後のLMSフィルタのハンドルを格納する領域 */
     polynomial_predictor** polynomial_predictors;   /* チャンネル毎の多項式予測器のハンドルを格納する領域 */
+    lms** cascade_filters;                          /* チャンネル毎・段毎の多段のLMSフィルタのハンドルを格納する領域 */
+    lpc** lpc_predictors;                           /* チャンネル毎の線形予測器のハンドルを格納する領域 */
+    signal* work_samples;                           /* サブブロックのサンプル数分の作業領域 */
 
     neac_tag* tag;                                  /* タグ情報のハンドル */
     neac_code* coder;                               /* ブロック読み書きAPIのハンドル */
@@ -48,6 +58,14 @@ typedef struct {
  */
 neac_decoder* neac_decoder_create(const char* path);
 
+/*!
+ * @brief                   メモリ上のデータをデコードするデコーダのハンドルを生成します。データはコピーされません。
+ * @param *data             デコードするデータのポインタ。デコーダを解放するまで有効である必要があります。
+ * @param size              デコードするデータのバイト数
+ * @return                  デコーダのハンドル
+ */
+neac_decoder* neac_decoder_create_from_memory(const uint8_t* data, size_t size);
+
 /*!
  * @brief                   デコーダを解放します。
  * @param decoder           デコーダのハンドル
@@ -3,6 +3,7 @@
 
 #include "bit_stream.h"
 #include "lms.h"
+#include "lpc.h"
 #include "neac_block.h"
 #include "neac_code.h"
 #include "neac_tag.h"
@@ -13,7 +14,7 @@
  * @brief エンコーダ
  */
 typedef struct {
-    FILE* output_file;                                  /* 出力先ファイルのハンドル*/
+    FILE* output_file;                                  /* 出力先ファイルのハンドル（メモリ上に出力する場合はNULL） */
     bit_stream* output_bit_stream;                      /* 出力先ビットストリームのハンドル */
 
     uint32_t sample_rate;                               /* サンプリング周波数 */
@@ -21,21 +22,47 @@ typedef struct {
     uint8_t num_channels;                               /* チャンネル数 */
     uint32_t num_samples;                               /* ファイルに含まれるサンプルの総数 */
 
-    uint8_t filter_taps;                                /* SSLMSフィルタのタップ数 */
+    uint8_t filter_taps;                                /* 最後のLMSフィルタのタップ数 */
     uint16_t block_size;                                /* ブロック（厳密にはサブブロック）に格納されるサンプル数 */
     bool use_mid_side_stereo;                           /* ミッドサイドステレオを使用するかどうかを示すフラグ */
     uint32_t num_blocks;                                /* ファイルに含まれるブロック数 */
+    uint8_t entropy_mode;                               /* エントロピー符号化の方式 */
+    uint8_t num_cascade_stages;                         /* 最後のLMSフィルタの前段に置く多段のLMSフィルタの段数 */
+    uint16_t cascade_taps[LMS_CASCADE_MAX_STAGES];      /* 多段のLMSフィルタの各段のタップ数 */
+    uint8_t cascade_shifts[LMS_CASCADE_MAX_STAGES];     /* 多段のLMSフィルタの各段のシフト係数 */
+    uint8_t lms_mode;                                   /* LMSフィルタの重み係数の更新方式（LMS_MODE_*） */
+    uint8_t lpc_order;                                  /* サブブロック毎に求める線形予測の最大次数（0なら線形予測を使用しない） */
 
-    lms** lms_filters;                                  /* チャンネル毎のSSLMSフィルタのハンドルが格納される領域 */
+    lms** lms_filters;                                  /* チャンネル毎の最後のLMSフィルタのハンドルが格納される領域 */
     polynomial_predictor** polynomial_predictors;       /* チャンネル毎の多項式予測器のハンドルが格納される領域 */
+    lms** cascade_filters;                              /* チャンネル毎・段毎の多段のLMSフィルタのハンドルが格納される領域 */
+    lpc** lpc_predictors;                               /* チャンネル毎の線形予測器のハンドルが格納される領域 */
+    double* lpc_work;                                   /* 線形予測の係数の計算に用いる、サブブロックのサンプル数分の作業領域 */
+    polynomial_predictor* trial_polynomial_predictor;   /* 既定の次数と減衰の度合いを試すための、多項式予測器の複製 */
+    lms* trial_lms_filter;                              /* 既定の次数と減衰の度合いを試すための、最後のLMSフィルタの複製 */
+    lms* trial_cascade_filters[LMS_CASCADE_MAX_STAGES]; /* 既定の次数と減衰の度合いを試すための、段毎の多段のLMSフィルタの複製 */
+    signal* trial_samples;                              /* 既定の次数と減衰の度合いでの予測残差を保持する、サブブロックのサンプル数分の作業領域 */
 
     neac_tag* tag;                                      /* タグ情報のハンドル */
     neac_code* coder;                                   /* ブロック読み書きAPIのハンドル */
     neac_block* current_block;                          /* エンコード中のブロックのハンドル */
+    signal* source_samples;                             /* 予測前の信号を一時的に保持する、サブブロックのサンプル数分の作業領域 */
     uint8_t current_sub_block_channel;                  /* 次にブロックにサンプルを書き込む場合のチャンネルのオフセット */
     uint16_t current_sub_block_offset;                  /* 次にブロックにサンプルを書き込む場合のサブブロックのオフセット */
 } neac_encoder;
 
+/*!
+ * @brief 拡張版のエンコーダ生成関数に渡す、追加の設定
+ * @note  size には sizeof(neac_encoder_options) を設定してください。size に含まれないメンバは既定値として扱われます。
+ */
+typedef struct {
+    uint32_t size;                                      /* この構造体のバイト数 */
+    uint8_t num_cascade_stages;                         /* 多段のLMSフィルタの段数（LMS_CASCADE_MAX_STAGES以下。使用しない場合は0） */
+    uint16_t cascade_taps[LMS_CASCADE_MAX_STAGES];      /* 多段のLMSフィルタの、各段のタップ数（長いものから順） */
+    uint8_t lpc_order;                                  /* サブブロック毎に求める線形予測の最大次数（LPC_MAX_ORDER以下。使用しない場合は0） */
+    uint8_t entropy_mode;                               /* エントロピー符号化の方式（ENTROPY_MODE_*） */
+} neac_encoder_options;
+
 /*!
  * @brief                           指定された設定で、エンコーダのハンドルを生成します。
  * @param *file                     出力先のファイルハンドル
@@ -82,6 +109,100 @@ neac_encoder* neac_encoder_create_from_path(
     uint8_t filter_taps,
     neac_tag* tag);
 
+/*!
+ * @brief                           指定された設定で、メモリ上に出力するエンコーダのハンドルを生成します。出力先の領域は必要に応じて自動的に拡張されます。
+ * @param sample_rate               サンプリング周波数
+ * @param bits_per_sample           量子化ビット数
+ * @param num_channels              チャンネル数
+ * @param num_samples               合計サンプル数
+ * @param block_size                ブロックサイズ
+ * @param use_mid_side_stereo       ミッドサイドステレオを使用するかどうかを示すフラグ
+ * @param filter_taps               LMSフィルタの最大タップ数
+ * @param *tag                      タグ情報
+ */
+neac_encoder* neac_encoder_create_from_memory(
+    uint32_t sample_rate,
+    uint8_t bits_per_sample,
+    uint8_t num_channels,
+    uint32_t num_samples,
+    uint16_t block_size,
+    bool use_mid_side_stereo,
+    uint8_t filter_taps,
+    neac_tag* tag);
+
+/*!
+ * @brief                           指定された設定と追加の設定で、エンコーダのハンドルを生成します。
+ * @param *file                     出力先のファイルハンドル
+ * @param sample_rate               サンプリング周波数
+ * @param bits_per_sample           量子化ビット数
+ * @param num_channels              チャンネル数
+ * @param num_samples               合計サンプル数
+ * @param block_size                ブロックサイズ
+ * @param use_mid_side_stereo       ミッドサイドステレオを使用するかどうかを示すフラグ
+ * @param filter_taps               LMSフィルタの最大タップ数
+ * @param *options                  追加の設定（NULLの場合はすべて既定値）
+ * @param *tag                      タグ情報
+ */
+neac_encoder* neac_encoder_create_ex(
+    FILE* file,
+    uint32_t sample_rate,
+    uint8_t bits_per_sample,
+    uint8_t num_channels,
+    uint32_t num_samples,
+    uint16_t block_size,
+    bool use_mid_side_stereo,
+    uint8_t filter_taps,
+    const neac_encoder_options* options,
+    neac_tag* tag);
+
+/*!
+ * @brief                           指定された設定と追加の設定で、エンコーダのハンドルを生成します。
+ * @param *path                      出力先のパス
+ * @param sample_rate               サンプリング周波数
+ * @param bits_per_sample           量子化ビット数
+ * @param num_channels              チャンネル数
+ * @param num_samples               合計サンプル数
+ * @param block_size                ブロックサイズ
+ * @param use_mid_side_stereo       ミッドサイドステレオを使用するかどうかを示すフラグ
+ * @param filter_taps               LMSフィルタの最大タップ数
+ * @param *options                  追加の設定（NULLの場合はすべて既定値）
+ * @param *tag                      タグ情報
+ */
+neac_encoder* neac_encoder_create_from_path_ex(
+    const char* path,
+    uint32_t sample_rate,
+    uint8_t bits_per_sample,
+    uint8_t num_channels,
+    uint32_t num_samples,
+    uint16_t block_size,
+    bool use_mid_side_stereo,
+    uint8_t filter_taps,
+    const neac_encoder_options* options,
+    neac_tag* tag);
+
+/*!
+ * @brief                           指定された設定と追加の設定で、メモリ上に出力するエンコーダのハンドルを生成します。出力先の領域は必要に応じて自動的に拡張されます。
+ * @param sample_rate               サンプリング周波数
+ * @param bits_per_sample           量子化ビット数
+ * @param num_channels              チャンネル数
+ * @param num_samples               合計サンプル数
+ * @param block_size                ブロックサイズ
+ * @param use_mid_side_stereo       ミッドサイドステレオを使用するかどうかを示すフラグ
+ * @param filter_taps               LMSフィルタの最大タップ数
+ * @param *options                  追加の設定（NULLの場合はすべて既定値）
+ * @param *tag                      タグ情報
+ */
+neac_encoder* neac_encoder_create_from_memory_ex(
+    uint32_t sample_rate,
+    uint8_t bits_per_sample,
+    uint8_t num_channels,
+    uint32_t num_samples,
+    uint16_t block_size,
+    bool use_mid_side_stereo,
+    uint8_t filter_taps,
+    const neac_encoder_options* options,
+    neac_tag* tag);
+
 /*!
  * @brief           エンコーダを解放します。
  * @param *encoder  エンコーダのハンドル
@@ -101,4 +222,12 @@ void neac_encoder_write_sample(neac_encoder* encoder, int32_t sample);
  */
 void neac_encoder_end_write(neac_encoder* encoder);
 
+/*!
+ * @brief           メモリ上に出力するエンコーダで、エンコードされたデータを取得します。neac_encoder_end_write の呼び出し後に使用してください。
+ * @param *encoder  エンコーダのハンドル
+ * @param *size     [出力]エンコードされたデータのバイト数
+ * @return          エンコードされたデータのポインタ。エンコーダを解放するまで有効です。ファイルに出力するエンコーダの場合はNULLを返します。
+ */
+const uint8_t* neac_encoder_get_output_memory(neac_encoder* encoder, size_t* size);
+
 #endif
\ No newline at end of file
@@ -29,6 +29,8 @@
 #define NEAC_ERROR_BIT_STREAM_CANNOT_ALLOCATE_MEMORY            0x0020      /* ビットストリームで必要な領域のメモリアロケーションに失敗した */
 #define NEAC_ERROR_BIT_STREAM_NOT_READ_MODE                     0x0021      /* ビットストリームが読み込みモードでないにもかかわらず、読み込みモード専用の関数が呼び出された */
 #define NEAC_ERROR_BIT_STREAM_NOT_WRITE_MODE                    0x0022      /* ビットストリームが書き込みモードでないにもかかわらず、書き込みモード専用の関数が呼び出された */
+#define NEAC_ERROR_BIT_STREAM_END_OF_STREAM                     0x0023      /* ビットストリームの終端を越えて読み込もうとした */
+#define NEAC_ERROR_BIT_STREAM_FAILED_TO_WRITE                   0x0024      /* ビットストリームのデータをファイルに書き込めなかった */
 
 /* LMSフィルタのエラー */
 #define NEAC_ERROR_LMS_CANNOT_ALLOCATE_MEMORY                   0x0030      /* LMSフィルタで必要な領域のメモリアロケーションに失敗した */
@@ -38,20 +40,32 @@
 /* 多項式予測器のエラー */
 #define NEAC_ERROR_POLYNOMIAL_PREDICTOR_CANNOT_ALLOCATE_MEMORY  0x0040  /* 多項式予測器で必要な領域のメモリアロケーションに失敗した */
 
+/* 線形予測器のエラー */
+#define NEAC_ERROR_LPC_CANNOT_ALLOCATE_MEMORY                   0x00A0      /* 線形予測器で必要な領域のメモリアロケーションに失敗した */
+
 /* ブロックのエラー */
 #define NEAC_ERROR_BLOCK_CANNOT_ALLOCATE_MEMORY                 0x0050      /* ブロックで必要な領域のメモリアロケーションに失敗した */
 
 /* サブブロックのエラー */
 #define NEAC_ERROR_SUB_BLOCK_CANNOT_ALLOCATE_MEMORY             0x0060      /* サブブロックで必要な領域のメモリアロケーションに失敗した */
+#define NEAC_ERROR_SUB_BLOCK_INVALID_TYPE                       0x0061      /* サブブロックの種類が不正な値であった */
+#define NEAC_ERROR_SUB_BLOCK_INVALID_LPC_ORDER                  0x0062      /* サブブロックの線形予測の次数が有効範囲外であった */
+#define NEAC_ERROR_SUB_BLOCK_INVALID_POLYNOMIAL_ORDER           0x0063      /* サブブロックの多項式予測器の次数が有効範囲外であった */
 
 /* エントロピー符号化のエラー */
 #define NEAC_ERROR_RICE_CODING_INVALID_PARAMETER             0x0070      /* エントロピー符号化に用いられたパラメータが不正なパラメータであった */
+#define NEAC_ERROR_RICE_CODING_INVALID_CODE                  0x0071      /* ライス符号の商が、表現可能な範囲を超えていた */
+#define NEAC_ERROR_RICE_CODING_INVALID_PARTITION_PARAMETER   0x0072      /* パーティションパラメータが、サブブロックのサイズに対して不正な値であった */
 
 /* デコードエラー */
 #define NEAC_ERROR_DECODER_CANNOT_ALLOCATE_MEMORY               0x0080      /* デコーダで必要な領域のメモリアロケーションに失敗した */
 #define NEAC_ERROR_DECODER_FAILED_TO_OPEN_FILE                  0x0081      /* デコードしようとしたファイルを開けなかった */
 #define NEAC_ERROR_DECODER_INVALID_MAGIC_NUMBER                 0x0082      /* デコードしようとしたファイルのマジックナンバーがNEACのものではなかった */
 #define NEAC_ERROR_DECODER_UNSUPPORTED_FORMAT_VERSION           0x0083      /* デコードしようとしたファイルに含まれているNEACデータのバージョンがサポート対象外のバージョンであった */
+#define NEAC_ERROR_DECODER_UNSUPPORTED_ENTROPY_MODE             0x0084      /* デコードしようとしたファイルで使用されているエントロピー符号化の方式がサポート対象外であった */
+#define NEAC_ERROR_DECODER_INVALID_LMS_CASCADE                  0x0085      /* デコードしようとしたファイルの多段のLMSフィルタの段数・タップ数・シフト係数が有効範囲外であった */
+#define NEAC_ERROR_DECODER_UNSUPPORTED_LMS_MODE                 0x0086      /* デコードしようとしたファイルで使用されているLMSフィルタの更新方式がサポート対象外であった */
+#define NEAC_ERROR_DECODER_INVALID_LPC_ORDER                    0x0087      /* デコードしようとしたファイルの線形予測の最大次数が有効範囲外であった */
 
 /* エンコードエラー */
 #define NEAC_ERROR_ENCODER_CANNOT_ALLOCATE_MEMORY               0x0090      /* エンコーダーで必要な領域のメモリアロケーションに失敗した */
@@ -1,6 +1,17 @@
 #ifndef NEAC_SUB_BLOCK_HEADER_INCLUDED
 #define NEAC_SUB_BLOCK_HEADER_INCLUDED
 
+#define SUB_BLOCK_TYPE_PREDICTED    0x00    /* 予測残差をエントロピー符号化したサブブロック */
+#define SUB_BLOCK_TYPE_VERBATIM     0x01    /* 入力信号をそのまま固定長で格納したサブブロック */
+#define SUB_BLOCK_TYPE_CONSTANT     0x02    /* すべてのサンプルが同じ値であり、その値のみを格納したサブブロック */
+#define SUB_BLOCK_TYPE_MAX          SUB_BLOCK_TYPE_CONSTANT
+#define SUB_BLOCK_TYPE_NEED_BITS    2
+
+#define SUB_BLOCK_WASTED_BITS_MAX       31      /* サンプルから取り除く下位のゼロのビット数の最大値 */
+#define SUB_BLOCK_WASTED_BITS_NEED_BITS 5       /* 取り除いたビット数-1の保存に要するビット数 */
+
+#include "lpc.h"
+#include "polynomial_predictor.h"
 #include "signal.h"
 #include <stdint.h>
 
@@ -8,6 +19,13 @@ typedef struct {
     signal* samples;            /* サンプル領域のポインタ */
     uint16_t size;              /* サブブロックに格納されたサンプル数 */
     uint8_t channel;            /* サブブロックに対応するチャンネル */
+    uint8_t type;               /* サブブロックの種類（SUB_BLOCK_TYPE_*）。PREDICTED以外では、samplesは予測前の信号そのもの */
+    uint8_t wasted_bits;        /* すべてのサンプルに共通する下位のゼロのビット数。samplesにはこのビット数だけ右シフトした値が格納される */
+    uint8_t polynomial_order;   /* 多項式予測器の次数 */
+    uint8_t polynomial_leak;    /* 多項式予測器の減衰の度合いの番号 */
+    uint8_t lpc_order;          /* 線形予測の次数。0なら多項式予測器を使用する */
+    uint8_t lpc_shift;          /* 量子化された線形予測の係数のシフト量 */
+    signal lpc_coefficients[LPC_MAX_ORDER]; /* 量子化された線形予測の係数（新しい過去サンプルに掛かるものから順） */
 } neac_sub_block;
 
 /*!
@@ -27,6 +27,7 @@
 
 #define NEAC_TAG_INFO_COUNT             18
 
+#include "bit_stream.h"
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
@@ -83,16 +84,16 @@ void neac_tag_set_picture_from_path(neac_tag* tag, const char* path);
 
 /*!
  * @brief                   タグを読み込み、タグ構造体に格納します。
- * @param *file             ファイルのハンドル
+ * @param *stream           ビットストリームのハンドル
  * @param **tag             タグ構造体のポインタのポインタ
  */
-void neac_tag_read(FILE* file, neac_tag** tag);
+void neac_tag_read(bit_stream* stream, neac_tag** tag);
 
 /*!
  * @brief                   タグを書き込みます。
- * @param *file             ファイルのハンドル
+ * @param *stream           ビットストリームのハンドル
  * @param *tag              タグ構造体のハンドル
  */
-void neac_tag_write(FILE* file, neac_tag* tag);
+void neac_tag_write(bit_stream* stream, neac_tag* tag);
 
 #endif
@@ -1,10 +1,30 @@
 #ifndef POLYNOMIAL_PREDICTOR_HEADER_INCLUDED
 #define POLYNOMIAL_PREDICTOR_HEADER_INCLUDED
 
+#include "macro.h"
 #include "signal.h"
+#include <stdint.h>
+
+#define POLYNOMIAL_PREDICTOR_K  4   /* 予測値の減衰の度合い（大きいほど減衰が小さい） */
+
+#define POLYNOMIAL_PREDICTOR_MAX_ORDER          4   /* 多項式予測器の次数の最大値（POLYNOMIAL_PREDICATOR_MAX_HISTORY以下） */
+#define POLYNOMIAL_PREDICTOR_ORDER_NEED_BITS    3   /* 多項式予測器の次数の保存に要するビット数 */
+#define POLYNOMIAL_PREDICTOR_NUM_LEAKS          4   /* 選択できる減衰の度合いの数 */
+#define POLYNOMIAL_PREDICTOR_LEAK_NEED_BITS     2   /* 減衰の度合いの番号の保存に要するビット数 */
+#define POLYNOMIAL_PREDICTOR_DEFAULT_ORDER      2   /* サブブロック毎の指定がないフォーマットで用いる次数 */
+#define POLYNOMIAL_PREDICTOR_DEFAULT_LEAK       2   /* サブブロック毎の指定がないフォーマットで用いる減衰の度合いの番号（POLYNOMIAL_PREDICTOR_Kに対応） */
+
+/* 直前のサンプルlatestと、その1つ前のサンプルpreviousから、次に続くサンプルを予測する */
+/* p * (2^k - 1) / 2^k（切り捨て）を、32ビットのPCMでも積があふれないよう p + floor(-p / 2^k) として求める */
+#define POLYNOMIAL_PREDICTOR_PREDICT_1(p, k) ((p) + RSHIFT(-(p), (k)))
+#define POLYNOMIAL_PREDICTOR_PREDICT(latest, previous) \
+    (LSHIFT(POLYNOMIAL_PREDICTOR_PREDICT_1((latest), POLYNOMIAL_PREDICTOR_K), 1) - POLYNOMIAL_PREDICTOR_PREDICT_1((previous), POLYNOMIAL_PREDICTOR_K - 1))
 
 typedef struct {
-    signal* history;
+    signal* history;        /* 過去サンプル領域のポインタ（履歴数の2倍の長さのリングバッファ） */
+    uint32_t position;      /* 最新の過去サンプルの位置 */
+    uint8_t order;          /* 予測に用いる次数 */
+    uint8_t leak;           /* 予測に用いる減衰の度合いの番号 */
 } polynomial_predictor;
 
 /*!
@@ -25,6 +45,21 @@ void polynomial_predictor_free(polynomial_predictor* predictor);
  */
 void polynomial_predictor_clear(polynomial_predictor* predictor);
 
+/*!
+ * @brief               多項式予測器の状態を、別の多項式予測器に複製します。
+ * @param *dest         複製先の多項式予測器のハンドル
+ * @param *source       複製元の多項式予測器のハンドル
+ */
+void polynomial_predictor_copy(polynomial_predictor* dest, const polynomial_predictor* source);
+
+/*!
+ * @brief               多項式予測器の次数と減衰の度合いを設定します。過去サンプルは引き継がれます。
+ * @param *predictor    多項式予測器のハンドル
+ * @param order         次数（POLYNOMIAL_PREDICTOR_MAX_ORDER以下）
+ * @param leak          減衰の度合いの番号（POLYNOMIAL_PREDICTOR_NUM_LEAKS未満）
+ */
+void polynomial_predictor_set_parameters(polynomial_predictor* predictor, uint8_t order, uint8_t leak);
+
 /*!
  * @brief               指定されたハンドルの多項式予測器で、次に続くPCMサンプルを予測します。
  * @param *predictor    多項式予測器のハンドル
@@ -39,4 +74,56 @@ signal polynomial_predictor_predict(polynomial_predictor* predictor);
  */
 void polynomial_predictor_update(polynomial_predictor* predictor, signal sample);
 
+/*!
+ * @brief               多項式予測器の過去サンプルを取得します。
+ * @param *predictor    多項式予測器のハンドル
+ * @param *history      [出力]新しい順の過去サンプル（POLYNOMIAL_PREDICATOR_MAX_HISTORY個）
+ */
+void polynomial_predictor_get_history(const polynomial_predictor* predictor, signal* history);
+
+/*!
+ * @brief               多項式予測器の過去サンプルを設定します。
+ * @param *predictor    多項式予測器のハンドル
+ * @param *history      新しい順の過去サンプル（POLYNOMIAL_PREDICATOR_MAX_HISTORY個）
+ */
+void polynomial_predictor_set_history(polynomial_predictor* predictor, const signal* history);
+
+/*!
+ * @brief               サブブロックの信号を多項式予測器で予測し、予測残差に置き換えます。
+ * @param *predictor    多項式予測器のハンドル
+ * @param *data         [入出力]信号。予測残差で上書きされます。
+ * @param size          信号のサンプル数
+ */
+void polynomial_predictor_encode_block(polynomial_predictor* predictor, signal* data, uint32_t size);
+
+/*!
+ * @brief               多項式予測器の予測残差から、サブブロックの信号を復元します。
+ * @param *predictor    多項式予測器のハンドル
+ * @param *data         [入出力]予測残差。復元された信号で上書きされます。
+ * @param size          信号のサンプル数
+ */
+void polynomial_predictor_decode_block(polynomial_predictor* predictor, signal* data, uint32_t size);
+
+/*!
+ * @brief               サブブロックの信号を指定された次数と減衰の度合いで予測した場合の予測残差の絶対値の合計を、過去サンプルを更新せずに求めます。
+ * @param *predictor    多項式予測器のハンドル
+ * @param order         次数（POLYNOMIAL_PREDICTOR_MAX_ORDER以下）
+ * @param leak          減衰の度合いの番号（POLYNOMIAL_PREDICTOR_NUM_LEAKS未満）
+ * @param *data         信号
+ * @param size          信号のサンプル数
+ * @return              予測残差の絶対値の合計
+ */
+uint64_t polynomial_predictor_compute_residual_sum(const polynomial_predictor* predictor, uint8_t order, uint8_t leak, const signal* data, uint32_t size);
+
+/*!
+ * @brief               サブブロックの信号に適した多項式予測器の次数と減衰の度合いを、予測残差の絶対値の合計から選びます。
+ * @param *predictor    多項式予測器のハンドル
+ * @param *data         信号
+ * @param size          信号のサンプル数
+ * @param *order        [出力]選ばれた次数
+ * @param *leak         [出力]選ばれた減衰の度合いの番号
+ * @return              選ばれた次数と減衰の度合いでの予測残差の絶対値の合計
+ */
+uint64_t polynomial_predictor_select_parameters(const polynomial_predictor* predictor, const signal* data, uint32_t size, uint8_t* order, uint8_t* leak);
+
 #endif
\ No newline at end of file
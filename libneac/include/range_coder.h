@@ -0,0 +1,109 @@
+#ifndef RANGE_CODER_HEADER_INCLUDED
+#define RANGE_CODER_HEADER_INCLUDED
+
+#define RANGE_CODER_PROBABILITY_BITS    15      /* 確率の精度（ビット数） */
+#define RANGE_CODER_PROBABILITY_INITIAL LSHIFT(1, RANGE_CODER_PROBABILITY_BITS - 1)   /* 確率の初期値（0と1が等確率） */
+#define RANGE_CODER_ADAPTATION_SHIFT    6       /* 確率を更新する速さ（大きいほどゆっくり適応する） */
+#define RANGE_CODER_TOP_VALUE           0x01000000  /* 区間幅がこの値を下回ったら正規化する */
+#define RANGE_CODER_HEAD_BYTES          5       /* 復号開始時に読み込むバイト数 */
+#define RANGE_CODER_DIRECT_CHUNK_BITS   8       /* 等確率のビット列を、まとめて区間を分割するビット数 */
+#define RANGE_CODER_COST_TABLE_BITS     10      /* 符号長の見積もりで、確率を量子化するビット数 */
+#define RANGE_CODER_COST_FRACTION_BITS  8       /* 符号長の見積もりの、小数部のビット数 */
+
+#include "bit_stream.h"
+#include "macro.h"
+#include <stdint.h>
+
+/* 0が出現する確率を2^RANGE_CODER_PROBABILITY_BITS倍した値 */
+typedef uint16_t range_coder_probability;
+
+typedef struct {
+    bit_stream* bitstream;      /* 入出力用ビットストリームのハンドル */
+    uint64_t low;               /* 区間の下端（符号化時のみ使用。桁上がりを扱うため32ビットより広く取る） */
+    uint32_t range;             /* 区間の幅 */
+    uint32_t code;              /* 読み込んだ符号の、区間の下端からのオフセット（復号時のみ使用） */
+    uint8_t cache;              /* 桁上がりが確定するまで保留しているバイト（符号化時のみ使用） */
+    uint64_t cache_size;        /* 保留しているバイト数（符号化時のみ使用） */
+    uint16_t* costs;            /* 量子化した確率毎の、符号長の見積もり（1/2^RANGE_CODER_COST_FRACTION_BITSビット単位） */
+} range_coder;
+
+/*!
+ * @brief           レンジコーダのハンドルを生成します。
+ * @param *stream   ビットストリームのハンドル
+ * @return          レンジコーダのハンドル
+ */
+range_coder* range_coder_create(bit_stream* stream);
+
+/*!
+ * @brief           レンジコーダを解放します。
+ * @param *coder    レンジコーダのハンドル
+ */
+void range_coder_free(range_coder* coder);
+
+/*!
+ * @brief                   確率を初期値で初期化します。
+ * @param *probabilities    確率を格納する領域
+ * @param count             確率の個数
+ */
+void range_coder_init_probabilities(range_coder_probability* probabilities, uint32_t count);
+
+/*!
+ * @brief           符号化を開始します。
+ * @param *coder    レンジコーダのハンドル
+ */
+void range_coder_start_encode(range_coder* coder);
+
+/*!
+ * @brief                   1ビットを、適応的に更新される確率を用いて符号化します。
+ * @param *coder            レンジコーダのハンドル
+ * @param *probability      このビットの文脈に対応する確率（符号化後に更新されます）
+ * @param bit               符号化するビット（0または1）
+ */
+void range_coder_encode_bit(range_coder* coder, range_coder_probability* probability, uint32_t bit);
+
+/*!
+ * @brief           任意ビット数の値を、各ビットが等確率であるものとして符号化します。
+ * @param *coder    レンジコーダのハンドル
+ * @param value     符号化する値
+ * @param num_bits  ビット数（32以下）
+ */
+void range_coder_encode_direct_bits(range_coder* coder, uint32_t value, uint32_t num_bits);
+
+/*!
+ * @brief                   1ビットを符号化した場合の符号長を見積もり、符号化した場合と同じく確率を更新します。
+ * @param *coder            レンジコーダのハンドル
+ * @param *probability      このビットの文脈に対応する確率（見積もり後に更新されます）
+ * @param bit               符号化するビット（0または1）
+ * @return                  符号長（1/2^RANGE_CODER_COST_FRACTION_BITSビット単位）
+ */
+uint32_t range_coder_estimate_bit(const range_coder* coder, range_coder_probability* probability, uint32_t bit);
+
+/*!
+ * @brief           符号化を終了し、保留しているデータをすべてビットストリームに書き込みます。
+ * @param *coder    レンジコーダのハンドル
+ */
+void range_coder_finish_encode(range_coder* coder);
+
+/*!
+ * @brief           復号を開始します。
+ * @param *coder    レンジコーダのハンドル
+ */
+void range_coder_start_decode(range_coder* coder);
+
+/*!
+ * @brief                   1ビットを、適応的に更新される確率を用いて復号します。
+ * @param *coder            レンジコーダのハンドル
+ * @param *probability      このビットの文脈に対応する確率（復号後に更新されます）
+ * @return                  復号されたビット（0または1）
+ */
+uint32_t range_coder_decode_bit(range_coder* coder, range_coder_probability* probability);
+
+/*!
+ * @brief           各ビットが等確率であるものとして符号化された、任意ビット数の値を復号します。
+ * @param *coder    レンジコーダのハンドル
+ * @param num_bits  ビット数（32以下）
+ * @return          復号された値
+ */
+uint32_t range_coder_decode_direct_bits(range_coder* coder, uint32_t num_bits);
+
+#endif
\ No newline at end of file
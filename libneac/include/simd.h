@@ -0,0 +1,45 @@
+#ifndef SIMD_HEADER_INCLUDED
+#define SIMD_HEADER_INCLUDED
+
+#include "signal.h"
+#include <stdint.h>
+
+#define SIMD_CPU_FEATURE_SSE41  0x01    /* SSE4.1命令が使用可能 */
+#define SIMD_CPU_FEATURE_AVX2   0x02    /* AVX2命令が使用可能 */
+
+/* x86向けのSIMD命令を使用する関数を、コンパイルオプションによらずビルドするための指定 */
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86
+#define SIMD_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define SIMD_X86
+#define SIMD_TARGET_SSE41
+#define SIMD_TARGET_AVX2
+#endif
+
+/*!
+ * @brief 値を符号なし整数に変換した値の統計量
+ */
+typedef struct {
+    uint64_t sum;           /* 値を符号なし整数に変換した値の合計 */
+    uint32_t mask;          /* 値を符号なし整数に変換した値の論理和 */
+    uint32_t num_zeros;     /* ゼロである値の個数 */
+} zigzag_stats;
+
+/*!
+ * @brief           実行中のCPUで使用可能なSIMD命令を取得します。判定結果は初回の呼び出し時に保持されます。
+ * @return          使用可能なSIMD命令を表すフラグ（SIMD_CPU_FEATURE_*の論理和）
+ */
+uint32_t simd_get_cpu_features();
+
+/*!
+ * @brief           値を符号なし整数に変換した値の合計・論理和と、ゼロである値の個数を、データを1回走査して求めます。
+ * @param *data     データのポインタ
+ * @param size      データのサイズ
+ * @param *stats    [出力]求めた統計量
+ * @note            実行中のCPUで使用可能な最も高速な実装が、初回の呼び出し時に選ばれます。
+ */
+void simd_compute_zigzag_stats(const signal* data, uint32_t size, zigzag_stats* stats);
+
+#endif
\ No newline at end of file
@@ -2,20 +2,569 @@
 #include "./include/macro.h"
 #include "./include/neac.h"
 #include "./include/neac_error.h"
+#include "./include/polynomial_predictor.h"
+#include "./include/simd.h"
 #include <stdlib.h>
 #include <string.h>
 
+#define SHIFT_FACTOR_PCM8   9
 #define SHIFT_FACTOR_PCM16  9
 #define SHIFT_FACTOR_PCM24  8
+#define SHIFT_FACTOR_PCM32  8
+#define STEP_SHIFT_PCM8     3
+#define STEP_SHIFT_PCM16    3
+#define STEP_SHIFT_PCM24    2
+#define STEP_SHIFT_PCM32    2
 #define SIGN(value)         ((value > 0) - (value < 0))
+#define SQUARE(value)       ((uint64_t)((int64_t)(value) * (value)))
+#define IS_DEFAULT_POLYNOMIAL_PREDICTOR(poly) \
+    ((poly)->order == POLYNOMIAL_PREDICTOR_DEFAULT_ORDER && (poly)->leak == POLYNOMIAL_PREDICTOR_DEFAULT_LEAK)
+
+#if defined(SIMD_X86)
+#include <immintrin.h>
+#endif
+
+#pragma region 予測・更新の実装
+
+/*!
+ * @brief           重み係数と過去サンプルの積をシフト係数で右シフトした値の総和を、1要素ずつ求めます。
+ * @param *weights  重み係数領域のポインタ
+ * @param *history  過去サンプル領域のポインタ
+ * @param taps      予測次数
+ * @param shift     シフト係数
+ * @return          予測されたPCMサンプル
+ */
+static signal predict_scalar(const signal* weights, const signal* history, uint32_t taps, uint32_t shift) {
+    register signal sum = 0;
+    register uint32_t i;
+
+    for (i = 0; i < taps; ++i) {
+        sum += RSHIFT(weights[i] * history[i], shift);
+    }
+
+    return sum;
+}
+
+/*!
+ * @brief           重み係数に、予測残差の符号と過去サンプルの符号の積を、1要素ずつ加算します。
+ * @param *weights  重み係数領域のポインタ
+ * @param *history  過去サンプル領域のポインタ
+ * @param taps      予測次数
+ * @param sign      予測残差の符号
+ */
+static void update_scalar(signal* weights, const signal* history, uint32_t taps, int32_t sign) {
+    register uint32_t i;
+
+    for (i = 0; i < taps; ++i) {
+        weights[i] += sign * SIGN(history[i]);
+    }
+}
+
+/*!
+ * @brief           重み係数と過去サンプルの積の総和を、64ビットで1要素ずつ求めます。
+ * @param *weights  重み係数領域のポインタ
+ * @param *history  過去サンプル領域のポインタ
+ * @param taps      予測次数
+ * @return          積の総和（2^64を法とする）
+ */
+static uint64_t dot_product_scalar(const signal* weights, const signal* history, uint32_t taps) {
+    register uint64_t sum = 0;
+    register uint32_t i;
+
+    for (i = 0; i < taps; ++i) {
+        sum += (uint64_t)((int64_t)weights[i] * history[i]);
+    }
+
+    return sum;
+}
+
+/*!
+ * @brief           重み係数と過去サンプルの積の総和を64ビットで求め、小数部を切り捨てます（NLMS用）。
+ * @param *weights  重み係数領域のポインタ
+ * @param *history  過去サンプル領域のポインタ
+ * @param taps      予測次数
+ * @param shift     重み係数の小数部のビット数（32以下）
+ * @return          予測されたPCMサンプル
+ * @note            32ビット以下の右シフトでは、論理シフトと算術シフトで下位32ビットは一致します。
+ */
+static signal predict_normalized_scalar(const signal* weights, const signal* history, uint32_t taps, uint32_t shift) {
+    return (signal)(uint32_t)RSHIFT(dot_product_scalar(weights, history, taps), shift);
+}
+
+/*!
+ * @brief           重み係数に、予測残差と過去サンプルの積を丸めて右シフトした値を、1要素ずつ加算します（NLMS用）。
+ * @param *weights  重み係数領域のポインタ
+ * @param *history  過去サンプル領域のポインタ
+ * @param taps      予測次数
+ * @param residual  予測残差
+ * @param shift     右シフトするビット数（32以下）
+ */
+static void update_normalized_scalar(signal* weights, const signal* history, uint32_t taps, int32_t residual, uint32_t shift) {
+    register uint64_t round = (shift == 0) ? 0 : LSHIFT((uint64_t)1, shift - 1);
+    register uint32_t i;
+
+    for (i = 0; i < taps; ++i) {
+        weights[i] = (signal)((uint32_t)weights[i] + (uint32_t)RSHIFT((uint64_t)((int64_t)residual * history[i]) + round, shift));
+    }
+}
+
+#if defined(SIMD_X86)
+
+/*!
+ * @brief           重み係数と過去サンプルの積をシフト係数で右シフトした値の総和を、SSE4.1命令で4要素ずつ求めます。
+ * @param *weights  重み係数領域のポインタ
+ * @param *history  過去サンプル領域のポインタ
+ * @param taps      予測次数
+ * @param shift     シフト係数
+ * @return          予測されたPCMサンプル
+ * @note            積の下位32ビットを算術右シフトしてから加算するため、1要素ずつ求めた場合と結果は一致します。
+ */
+SIMD_TARGET_SSE41 static signal predict_sse41(const signal* weights, const signal* history, uint32_t taps, uint32_t shift) {
+    const __m128i count = _mm_cvtsi32_si128((int)shift);
+    __m128i sum = _mm_setzero_si128();
+    __m128i product;
+    uint32_t i;
+
+    for (i = 0; i + 4 <= taps; i += 4) {
+        product = _mm_mullo_epi32(_mm_loadu_si128((const __m128i*)&weights[i]), _mm_loadu_si128((const __m128i*)&history[i]));
+        sum = _mm_add_epi32(sum, _mm_sra_epi32(product, count));
+    }
+
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return (signal)_mm_cvtsi128_si32(sum) + predict_scalar(&weights[i], &history[i], taps - i, shift);
+}
+
+/*!
+ * @brief           重み係数に、予測残差の符号と過去サンプルの符号の積を、SSE4.1命令で4要素ずつ加算します。
+ * @param *weights  重み係数領域のポインタ
+ * @param *history  過去サンプル領域のポインタ
+ * @param taps      予測次数
+ * @param sign      予測残差の符号
+ */
+SIMD_TARGET_SSE41 static void update_sse41(signal* weights, const signal* history, uint32_t taps, int32_t sign) {
+    const __m128i sign_vector = _mm_set1_epi32(sign);
+    __m128i weight;
+    uint32_t i;
+
+    for (i = 0; i + 4 <= taps; i += 4) {
+        /* _mm_sign_epi32は、過去サンプルが負なら符号を反転し、ゼロならゼロを返す */
+        weight = _mm_loadu_si128((const __m128i*)&weights[i]);
+        weight = _mm_add_epi32(weight, _mm_sign_epi32(sign_vector, _mm_loadu_si128((const __m128i*)&history[i])));
+        _mm_storeu_si128((__m128i*)&weights[i], weight);
+    }
+
+    update_scalar(&weights[i], &history[i], taps - i, sign);
+}
+
+/*!
+ * @brief           重み係数と過去サンプルの積をシフト係数で右シフトした値の総和を、AVX2命令で8要素ずつ求めます。
+ * @param *weights  重み係数領域のポインタ
+ * @param *history  過去サンプル領域のポインタ
+ * @param taps      予測次数
+ * @param shift     シフト係数
+ * @return          予測されたPCMサンプル
+ */
+SIMD_TARGET_AVX2 static signal predict_avx2(const signal* weights, const signal* history, uint32_t taps, uint32_t shift) {
+    const __m128i count = _mm_cvtsi32_si128((int)shift);
+    __m256i sum = _mm256_setzero_si256();
+    __m256i product;
+    __m128i half;
+    signal predict;
+    uint32_t i;
+
+    for (i = 0; i + 8 <= taps; i += 8) {
+        product = _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i*)&weights[i]), _mm256_loadu_si256((const __m256i*)&history[i]));
+        sum = _mm256_add_epi32(sum, _mm256_sra_epi32(product, count));
+    }
+
+    half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    predict = (signal)_mm_cvtsi128_si32(half);
+
+    /* 8要素に満たない残りは、4要素単位の実装で処理する。update_avx2と同じく、
+       YMMレジスタの上位を解放してからSSE4.1命令の実装を呼び出す */
+    _mm256_zeroupper();
+    return predict + predict_sse41(&weights[i], &history[i], taps - i, shift);
+}
+
+/*!
+ * @brief           重み係数に、予測残差の符号と過去サンプルの符号の積を、AVX2命令で8要素ずつ加算します。
+ * @param *weights  重み係数領域のポインタ
+ * @param *history  過去サンプル領域のポインタ
+ * @param taps      予測次数
+ * @param sign      予測残差の符号
+ */
+SIMD_TARGET_AVX2 static void update_avx2(signal* weights, const signal* history, uint32_t taps, int32_t sign) {
+    const __m256i sign_vector = _mm256_set1_epi32(sign);
+    __m256i weight;
+    uint32_t i;
+
+    for (i = 0; i + 8 <= taps; i += 8) {
+        weight = _mm256_loadu_si256((const __m256i*)&weights[i]);
+        weight = _mm256_add_epi32(weight, _mm256_sign_epi32(sign_vector, _mm256_loadu_si256((const __m256i*)&history[i])));
+        _mm256_storeu_si256((__m256i*)&weights[i], weight);
+    }
+
+    /* 残りはSSE4.1命令の実装で処理する。末尾呼び出しではコンパイラがYMMレジスタの上位を解放しないため、
+       明示的に解放してAVXとSSEの切り替えによる遅延を避ける */
+    _mm256_zeroupper();
+    update_sse41(&weights[i], &history[i], taps - i, sign);
+}
+
+/*!
+ * @brief           重み係数と過去サンプルの積の総和を、SSE4.1命令で64ビットで4要素ずつ求めます。
+ * @param *weights  重み係数領域のポインタ
+ * @param *history  過去サンプル領域のポインタ
+ * @param taps      予測次数
+ * @return          積の総和（2^64を法とする）
+ */
+SIMD_TARGET_SSE41 static uint64_t dot_product_sse41(const signal* weights, const signal* history, uint32_t taps) {
+    __m128i sum = _mm_setzero_si128();
+    __m128i weight, sample;
+    uint64_t sums[2];
+    uint32_t i;
+
+    for (i = 0; i + 4 <= taps; i += 4) {
+        /* _mm_mul_epi32は偶数番目の要素どうしの積を64ビットで求めるため、奇数番目は右シフトして揃える */
+        weight = _mm_loadu_si128((const __m128i*)&weights[i]);
+        sample = _mm_loadu_si128((const __m128i*)&history[i]);
+        sum = _mm_add_epi64(sum, _mm_mul_epi32(weight, sample));
+        sum = _mm_add_epi64(sum, _mm_mul_epi32(_mm_srli_epi64(weight, 32), _mm_srli_epi64(sample, 32)));
+    }
+
+    _mm_storeu_si128((__m128i*)sums, sum);
+
+    return sums[0] + sums[1] + dot_product_scalar(&weights[i], &history[i], taps - i);
+}
+
+/*!
+ * @brief           重み係数と過去サンプルの積の総和を、SSE4.1命令で64ビットで求め、小数部を切り捨てます（NLMS用）。
+ * @param *weights  重み係数領域のポインタ
+ * @param *history  過去サンプル領域のポインタ
+ * @param taps      予測次数
+ * @param shift     重み係数の小数部のビット数（32以下）
+ * @return          予測されたPCMサンプル
+ */
+SIMD_TARGET_SSE41 static signal predict_normalized_sse41(const signal* weights, const signal* history, uint32_t taps, uint32_t shift) {
+    return (signal)(uint32_t)RSHIFT(dot_product_sse41(weights, history, taps), shift);
+}
+
+/*!
+ * @brief           重み係数に、予測残差と過去サンプルの積を丸めて右シフトした値を、SSE4.1命令で4要素ずつ加算します（NLMS用）。
+ * @param *weights  重み係数領域のポインタ
+ * @param *history  過去サンプル領域のポインタ
+ * @param taps      予測次数
+ * @param residual  予測残差
+ * @param shift     右シフトするビット数（32以下）
+ */
+SIMD_TARGET_SSE41 static void update_normalized_sse41(signal* weights, const signal* history, uint32_t taps, int32_t residual, uint32_t shift) {
+    const __m128i error = _mm_set1_epi32(residual);
+    const __m128i round = _mm_set1_epi64x((shift == 0) ? 0 : (int64_t)LSHIFT((uint64_t)1, shift - 1));
+    const __m128i count = _mm_cvtsi32_si128((int)shift);
+    __m128i sample, even, odd;
+    uint32_t i;
+
+    for (i = 0; i + 4 <= taps; i += 4) {
+        /* 偶数番目と奇数番目の要素の積を別々に64ビットで求め、それぞれの下位32ビットを1つのレジスタに戻す */
+        sample = _mm_loadu_si128((const __m128i*)&history[i]);
+        even = _mm_srl_epi64(_mm_add_epi64(_mm_mul_epi32(error, sample), round), count);
+        odd = _mm_srl_epi64(_mm_add_epi64(_mm_mul_epi32(error, _mm_srli_epi64(sample, 32)), round), count);
+        even = _mm_blend_epi16(even, _mm_slli_epi64(odd, 32), 0xCC);
+        _mm_storeu_si128((__m128i*)&weights[i], _mm_add_epi32(_mm_loadu_si128((const __m128i*)&weights[i]), even));
+    }
+
+    update_normalized_scalar(&weights[i], &history[i], taps - i, residual, shift);
+}
+
+/*!
+ * @brief           重み係数と過去サンプルの積の総和を、AVX2命令で64ビットで8要素ずつ求めます。
+ * @param *weights  重み係数領域のポインタ
+ * @param *history  過去サンプル領域のポインタ
+ * @param taps      予測次数
+ * @return          積の総和（2^64を法とする）
+ */
+SIMD_TARGET_AVX2 static uint64_t dot_product_avx2(const signal* weights, const signal* history, uint32_t taps) {
+    __m256i sum = _mm256_setzero_si256();
+    __m256i weight, sample;
+    uint64_t sums[4];
+    uint32_t i;
+
+    for (i = 0; i + 8 <= taps; i += 8) {
+        weight = _mm256_loadu_si256((const __m256i*)&weights[i]);
+        sample = _mm256_loadu_si256((const __m256i*)&history[i]);
+        sum = _mm256_add_epi64(sum, _mm256_mul_epi32(weight, sample));
+        sum = _mm256_add_epi64(sum, _mm256_mul_epi32(_mm256_srli_epi64(weight, 32), _mm256_srli_epi64(sample, 32)));
+    }
+
+    _mm256_storeu_si256((__m256i*)sums, sum);
+
+    /* 8要素に満たない残りは、4要素単位の実装で処理する。predict_avx2と同じく、
+       YMMレジスタの上位を解放してからSSE4.1命令の実装を呼び出す */
+    _mm256_zeroupper();
+    return sums[0] + sums[1] + sums[2] + sums[3] + dot_product_sse41(&weights[i], &history[i], taps - i);
+}
+
+/*!
+ * @brief           重み係数と過去サンプルの積の総和を、AVX2命令で64ビットで求め、小数部を切り捨てます（NLMS用）。
+ * @param *weights  重み係数領域のポインタ
+ * @param *history  過去サンプル領域のポインタ
+ * @param taps      予測次数
+ * @param shift     重み係数の小数部のビット数（32以下）
+ * @return          予測されたPCMサンプル
+ */
+SIMD_TARGET_AVX2 static signal predict_normalized_avx2(const signal* weights, const signal* history, uint32_t taps, uint32_t shift) {
+    return (signal)(uint32_t)RSHIFT(dot_product_avx2(weights, history, taps), shift);
+}
+
+/*!
+ * @brief           重み係数に、予測残差と過去サンプルの積を丸めて右シフトした値を、AVX2命令で8要素ずつ加算します（NLMS用）。
+ * @param *weights  重み係数領域のポインタ
+ * @param *history  過去サンプル領域のポインタ
+ * @param taps      予測次数
+ * @param residual  予測残差
+ * @param shift     右シフトするビット数（32以下）
+ */
+SIMD_TARGET_AVX2 static void update_normalized_avx2(signal* weights, const signal* history, uint32_t taps, int32_t residual, uint32_t shift) {
+    const __m256i error = _mm256_set1_epi32(residual);
+    const __m256i round = _mm256_set1_epi64x((shift == 0) ? 0 : (int64_t)LSHIFT((uint64_t)1, shift - 1));
+    const __m128i count = _mm_cvtsi32_si128((int)shift);
+    __m256i sample, even, odd;
+    uint32_t i;
+
+    for (i = 0; i + 8 <= taps; i += 8) {
+        sample = _mm256_loadu_si256((const __m256i*)&history[i]);
+        even = _mm256_srl_epi64(_mm256_add_epi64(_mm256_mul_epi32(error, sample), round), count);
+        odd = _mm256_srl_epi64(_mm256_add_epi64(_mm256_mul_epi32(error, _mm256_srli_epi64(sample, 32)), round), count);
+        even = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+        _mm256_storeu_si256((__m256i*)&weights[i], _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)&weights[i]), even));
+    }
+
+    /* update_avx2と同じく、YMMレジスタの上位を解放してから残りを処理する */
+    _mm256_zeroupper();
+    update_normalized_sse41(&weights[i], &history[i], taps - i, residual, shift);
+}
+
+#endif
+
+/*!
+ * @brief           実行中のCPUで使用可能な命令に応じて、予測・更新に用いる関数を選びます。
+ * @param *filter   LMSフィルタのハンドル
+ */
+static void select_kernels(lms* filter) {
+    uint32_t features = simd_get_cpu_features();
+
+    filter->predict_kernel = predict_scalar;
+    filter->update_kernel = update_scalar;
+    filter->normalized_update_kernel = update_normalized_scalar;
+
+#if defined(SIMD_X86)
+    if (features & SIMD_CPU_FEATURE_AVX2) {
+        filter->predict_kernel = predict_avx2;
+        filter->update_kernel = update_avx2;
+        filter->normalized_update_kernel = update_normalized_avx2;
+    }
+    else if (features & SIMD_CPU_FEATURE_SSE41) {
+        filter->predict_kernel = predict_sse41;
+        filter->update_kernel = update_sse41;
+        filter->normalized_update_kernel = update_normalized_sse41;
+    }
+#else
+    (void)features;
+#endif
+
+    /* NLMSの予測は、積の総和を64ビットで求める関数に置き換える */
+    if (filter->mode == LMS_MODE_NORMALIZED) {
+        filter->predict_kernel = predict_normalized_scalar;
+#if defined(SIMD_X86)
+        if (features & SIMD_CPU_FEATURE_AVX2) {
+            filter->predict_kernel = predict_normalized_avx2;
+        }
+        else if (features & SIMD_CPU_FEATURE_SSE41) {
+            filter->predict_kernel = predict_normalized_sse41;
+        }
+#endif
+    }
+}
+
+#pragma endregion
+
+#pragma region サブブロック単位の予測・更新の実装
+
+/* 予測次数とシフト係数を定数とし、重み係数と過去サンプルの積の総和を求める */
+#define BLOCK_PREDICT(TAPS, SHIFT, prediction, window) \
+    prediction = 0; \
+    for (i = 0; i < (TAPS); ++i) { \
+        prediction += RSHIFT(w[i] * (window)[i], (SHIFT)); \
+    }
+
+/* 予測次数を定数とし、重み係数を更新して過去サンプルを書き込む */
+#define BLOCK_UPDATE(TAPS, sgn, window, sample) \
+    if ((sgn) != 0) { \
+        for (i = 0; i < (TAPS); ++i) { \
+            w[i] += (sgn) * SIGN((window)[i]); \
+        } \
+    } \
+    position = (position == 0 ? (TAPS) : position) - 1; \
+    history[position] = (sample); \
+    history[position + (TAPS)] = (sample);
+
+/* 予測次数とシフト係数ごとに、多項式予測器とLMSフィルタをサブブロック単位で続けて適用する関数を定義する。
+   多項式予測器の過去サンプルと重み係数はローカル変数に読み込んでループ中はレジスタに置き、終了時に一度だけ書き戻す。
+   重み係数をローカルの配列とすることで、過去サンプルの領域と別名にならないこともコンパイラに示す。
+   多項式予測器の過去サンプルにNULLを渡すと、LMSフィルタのみを適用する */
+#define DEFINE_BLOCK_KERNELS(NAME, TARGET, TAPS, SHIFT) \
+TARGET static uint32_t encode_block_##NAME##_##TAPS##_##SHIFT(signal* weights, signal* history, uint32_t position, signal* poly_history, signal* data, uint32_t size) { \
+    signal w[TAPS]; \
+    signal latest = (poly_history != NULL) ? poly_history[0] : 0; \
+    signal previous = (poly_history != NULL) ? poly_history[1] : 0; \
+    const signal* window; \
+    signal prediction, sample, input, residual; \
+    int32_t sgn; \
+    uint32_t i, j; \
+    memcpy(w, weights, sizeof(w)); \
+    for (j = 0; j < size; ++j) { \
+        sample = data[j]; \
+        input = (poly_history != NULL) ? sample - POLYNOMIAL_PREDICTOR_PREDICT(latest, previous) : sample; \
+        previous = latest; \
+        latest = sample; \
+        window = &history[position]; \
+        BLOCK_PREDICT(TAPS, SHIFT, prediction, window) \
+        residual = input - prediction; \
+        sgn = SIGN(residual); \
+        BLOCK_UPDATE(TAPS, sgn, window, input) \
+        data[j] = residual; \
+    } \
+    memcpy(weights, w, sizeof(w)); \
+    if (poly_history != NULL) { \
+        poly_history[0] = latest; \
+        poly_history[1] = previous; \
+    } \
+    return position; \
+} \
+TARGET static uint32_t decode_block_##NAME##_##TAPS##_##SHIFT(signal* weights, signal* history, uint32_t position, signal* poly_history, signal* data, uint32_t size) { \
+    signal w[TAPS]; \
+    signal latest = (poly_history != NULL) ? poly_history[0] : 0; \
+    signal previous = (poly_history != NULL) ? poly_history[1] : 0; \
+    const signal* window; \
+    signal prediction, sample, input, residual; \
+    int32_t sgn; \
+    uint32_t i, j; \
+    memcpy(w, weights, sizeof(w)); \
+    for (j = 0; j < size; ++j) { \
+        window = &history[position]; \
+        BLOCK_PREDICT(TAPS, SHIFT, prediction, window) \
+        residual = data[j]; \
+        input = residual + prediction; \
+        sgn = SIGN(residual); \
+        BLOCK_UPDATE(TAPS, sgn, window, input) \
+        sample = (poly_history != NULL) ? input + POLYNOMIAL_PREDICTOR_PREDICT(latest, previous) : input; \
+        previous = latest; \
+        latest = sample; \
+        data[j] = sample; \
+    } \
+    memcpy(weights, w, sizeof(w)); \
+    if (poly_history != NULL) { \
+        poly_history[0] = latest; \
+        poly_history[1] = previous; \
+    } \
+    return position; \
+}
+
+#define BLOCK_KERNEL_ENTRY(NAME, TARGET, TAPS, SHIFT) \
+    { encode_block_##NAME##_##TAPS##_##SHIFT, decode_block_##NAME##_##TAPS##_##SHIFT },
+
+/* 1からLMS_MAX_TAPSまでの予測次数について、マクロを展開する */
+#define FOR_EACH_TAPS(M, NAME, TARGET, SHIFT) \
+    M(NAME, TARGET, 1, SHIFT)  M(NAME, TARGET, 2, SHIFT)  M(NAME, TARGET, 3, SHIFT)  M(NAME, TARGET, 4, SHIFT) \
+    M(NAME, TARGET, 5, SHIFT)  M(NAME, TARGET, 6, SHIFT)  M(NAME, TARGET, 7, SHIFT)  M(NAME, TARGET, 8, SHIFT) \
+    M(NAME, TARGET, 9, SHIFT)  M(NAME, TARGET, 10, SHIFT) M(NAME, TARGET, 11, SHIFT) M(NAME, TARGET, 12, SHIFT) \
+    M(NAME, TARGET, 13, SHIFT) M(NAME, TARGET, 14, SHIFT) M(NAME, TARGET, 15, SHIFT) M(NAME, TARGET, 16, SHIFT) \
+    M(NAME, TARGET, 17, SHIFT) M(NAME, TARGET, 18, SHIFT) M(NAME, TARGET, 19, SHIFT) M(NAME, TARGET, 20, SHIFT) \
+    M(NAME, TARGET, 21, SHIFT) M(NAME, TARGET, 22, SHIFT) M(NAME, TARGET, 23, SHIFT) M(NAME, TARGET, 24, SHIFT) \
+    M(NAME, TARGET, 25, SHIFT) M(NAME, TARGET, 26, SHIFT) M(NAME, TARGET, 27, SHIFT) M(NAME, TARGET, 28, SHIFT) \
+    M(NAME, TARGET, 29, SHIFT) M(NAME, TARGET, 30, SHIFT) M(NAME, TARGET, 31, SHIFT) M(NAME, TARGET, 32, SHIFT)
+
+typedef struct {
+    lms_block_kernel encode;    /* 予測残差を求める関数 */
+    lms_block_kernel decode;    /* 予測残差から信号を復元する関数 */
+} block_kernels;
+
+FOR_EACH_TAPS(DEFINE_BLOCK_KERNELS, generic, , SHIFT_FACTOR_PCM16)
+FOR_EACH_TAPS(DEFINE_BLOCK_KERNELS, generic, , SHIFT_FACTOR_PCM24)
+
+/* 添字は[PCM16, PCM24][予測次数 - 1] */
+static const block_kernels block_kernels_generic[2][LMS_MAX_TAPS] = {
+    { FOR_EACH_TAPS(BLOCK_KERNEL_ENTRY, generic, , SHIFT_FACTOR_PCM16) },
+    { FOR_EACH_TAPS(BLOCK_KERNEL_ENTRY, generic, , SHIFT_FACTOR_PCM24) },
+};
+
+#if defined(SIMD_X86)
+
+/* 同じ関数をAVX2命令を使用してビルドし、展開されたループをコンパイラにベクトル化させる */
+FOR_EACH_TAPS(DEFINE_BLOCK_KERNELS, avx2, SIMD_TARGET_AVX2, SHIFT_FACTOR_PCM16)
+FOR_EACH_TAPS(DEFINE_BLOCK_KERNELS, avx2, SIMD_TARGET_AVX2, SHIFT_FACTOR_PCM24)
+
+static const block_kernels block_kernels_avx2[2][LMS_MAX_TAPS] = {
+    { FOR_EACH_TAPS(BLOCK_KERNEL_ENTRY, avx2, SIMD_TARGET_AVX2, SHIFT_FACTOR_PCM16) },
+    { FOR_EACH_TAPS(BLOCK_KERNEL_ENTRY, avx2, SIMD_TARGET_AVX2, SHIFT_FACTOR_PCM24) },
+};
+
+#endif
+
+/*!
+ * @brief           予測次数とシフト係数に応じて、サブブロック単位で予測・更新を行う関数を選びます。
+ * @param *filter   LMSフィルタのハンドル
+ * @note            該当する関数がない場合は、1サンプルずつ予測・更新を行います。
+ */
+static void select_block_kernels(lms* filter) {
+    const block_kernels (*table)[LMS_MAX_TAPS] = block_kernels_generic;
+    uint32_t index;
+
+    filter->encode_block_kernel = NULL;
+    filter->decode_block_kernel = NULL;
+
+    if (filter->mode != LMS_MODE_SIGN_SIGN || filter->taps == 0 || filter->taps > LMS_MAX_TAPS) {
+        return;
+    }
+
+    if (filter->shift == SHIFT_FACTOR_PCM16) {
+        index = 0;
+    }
+    else if (filter->shift == SHIFT_FACTOR_PCM24) {
+        index = 1;
+    }
+    else {
+        return;
+    }
+
+#if defined(SIMD_X86)
+    if (simd_get_cpu_features() & SIMD_CPU_FEATURE_AVX2) {
+        table = block_kernels_avx2;
+    }
+#endif
+
+    filter->encode_block_kernel = table[index][filter->taps - 1].encode;
+    filter->decode_block_kernel = table[index][filter->taps - 1].decode;
+}
+
+#pragma endregion
 
 /*!
  * @brief           LMSフィルタを初期化します。
  * @param filter    LMSフィルタのハンドル
+ * @param taps      予測次数
+ * @param mode      重み係数の更新方式（LMS_MODE_*）
+ * @param shift     シフト係数
  */
-static void lms_init(lms* filter, uint8_t taps, uint8_t pcm_bits) {
+static void lms_init(lms* filter, uint32_t taps, uint8_t mode, uint8_t shift) {
+    uint8_t energy_shift = 0;
+
     /* 過去サンプルと重み係数の領域を確保 */
-    filter->history = (signal*)calloc(taps, sizeof(signal));
+    /* 過去サンプルは2回ずつ書き込み、連続した予測次数分の領域として読み出せるようにする */
+    filter->history = (signal*)calloc(LSHIFT(taps, 1), sizeof(signal));
     filter->weights = (signal*)calloc(taps, sizeof(signal));
 
     if (filter->history == NULL || filter->weights == NULL) {
@@ -23,23 +572,78 @@ static void lms_init(lms* filter, uint8_t taps, uint8_t pcm_bits) {
         return;
     }
 
-    /* タップ数を設定 */
+    /* タップ数とシフトファクタを設定 */
     filter->taps = taps;
+    filter->mode = mode;
+    filter->shift = shift;
+    filter->position = 0;
+    filter->energy = 0;
 
-    /* PCMのビット数に応じたシフトファクタを設定 */
-    if (pcm_bits == 16) {
-        filter->shift = SHIFT_FACTOR_PCM16;
+    /* 32ビットの過去サンプルの2乗は2^62に達するため、タップ数が4を超える場合は、その2乗和が64ビットに収まるだけ右シフトしておく */
+    while (LSHIFT(LSHIFT((uint64_t)1, 2 * energy_shift), 2) < taps) {
+        ++energy_shift;
+    }
+    filter->energy_shift = energy_shift;
+
+    /* NLMSの更新時のシフト量は、過去サンプルの2乗和の対数にステップのシフト量を加え、重み係数の小数部のビット数を引いたもの */
+    filter->step_bias = (int32_t)shift - LMS_NLMS_WEIGHT_BITS + (int32_t)LSHIFT(energy_shift, 1);
+
+    /* 予測・更新に用いる関数を選ぶ */
+    select_kernels(filter);
+    select_block_kernels(filter);
+}
+
+/*!
+ * @brief           更新方式とPCMのビット数に応じたシフトファクタを返します。
+ * @param mode      重み係数の更新方式（LMS_MODE_*）
+ * @param pcm_bits  PCMの量子化ビット数
+ * @return          シフトファクタ
+ */
+uint8_t lms_get_default_shift(uint8_t mode, uint8_t pcm_bits) {
+    if (mode == LMS_MODE_NORMALIZED) {
+        switch (pcm_bits) {
+        case 8:
+            return STEP_SHIFT_PCM8;
+        case 24:
+            return STEP_SHIFT_PCM24;
+        case 32:
+            return STEP_SHIFT_PCM32;
+        default:
+            return STEP_SHIFT_PCM16;
+        }
     }
-    else if (pcm_bits == 24) {
-        filter->shift = SHIFT_FACTOR_PCM24;
+
+    switch (pcm_bits) {
+    case 8:
+        return SHIFT_FACTOR_PCM8;
+    case 24:
+        return SHIFT_FACTOR_PCM24;
+    case 32:
+        return SHIFT_FACTOR_PCM32;
+    default:
+        return SHIFT_FACTOR_PCM16;
     }
 }
 
 /*!
  * @brief           LMSフィルタのハンドルを生成します。
+ * @param taps      予測次数
+ * @param mode      重み係数の更新方式（LMS_MODE_*）
+ * @param pcm_bits  PCMの量子化ビット数
  * @return			LMSフィルタのハンドル
  */
-lms* lms_create(uint8_t taps, uint8_t pcm_bits) {
+lms* lms_create(uint8_t taps, uint8_t mode, uint8_t pcm_bits) {
+    return lms_create_with_shift(taps, mode, lms_get_default_shift(mode, pcm_bits));
+}
+
+/*!
+ * @brief           シフト係数を指定して、LMSフィルタのハンドルを生成します。
+ * @param taps      予測次数（LMS_CASCADE_MAX_TAPS以下）
+ * @param mode      重み係数の更新方式（LMS_MODE_*）
+ * @param shift     シフト係数
+ * @return          LMSフィルタのハンドル
+ */
+lms* lms_create_with_shift(uint16_t taps, uint8_t mode, uint8_t shift) {
     lms* result = (lms*)malloc(sizeof(lms));
 
     if (result == NULL){
@@ -47,7 +651,7 @@ lms* lms_create(uint8_t taps, uint8_t pcm_bits) {
         return NULL;
     }
 
-    lms_init(result, taps, pcm_bits);
+    lms_init(result, taps, mode, shift);
     return result;
 }
 
@@ -61,8 +665,22 @@ void lms_free(lms* filter) {
 }
 
 void lms_clear(lms* filter) {
-    memset(filter->history, 0, sizeof(signal) * filter->taps);
+    memset(filter->history, 0, sizeof(signal) * LSHIFT(filter->taps, 1));
     memset(filter->weights, 0, sizeof(signal) * filter->taps);
+    filter->position = 0;
+    filter->energy = 0;
+}
+
+/*!
+ * @brief           LMSフィルタの状態を、同じ設定で生成された別のLMSフィルタに複製します。
+ * @param *dest     複製先のLMSフィルタのハンドル
+ * @param *source   複製元のLMSフィルタのハンドル
+ */
+void lms_copy(lms* dest, const lms* source) {
+    memcpy(dest->history, source->history, sizeof(signal) * LSHIFT(source->taps, 1));
+    memcpy(dest->weights, source->weights, sizeof(signal) * source->taps);
+    dest->position = source->position;
+    dest->energy = source->energy;
 }
 
 /*!
@@ -71,14 +689,43 @@ void lms_clear(lms* filter) {
  * @return          予測されたPCMサンプル
  */
 signal lms_predict(lms* filter) {
-    register signal sum = 0;
-    register uint32_t i;
+    register uint32_t shift = (filter->mode == LMS_MODE_NORMALIZED) ? LMS_NLMS_WEIGHT_BITS : filter->shift;
+
+    return filter->predict_kernel(filter->weights, &filter->history[filter->position], filter->taps, shift);
+}
+
+/*!
+ * @brief           NLMSの重み係数を、過去サンプルの2乗和で正規化したステップで更新します。
+ * @param *filter   LMSフィルタのハンドル
+ * @param residual  実際のPCMサンプルと、予測されたPCMサンプルの差分
+ * @note            予測残差の2乗が過去サンプルの2乗和を上回る場合は、予測残差の2乗で正規化します。
+ *                  これにより、重み係数の1回の変化量はステップの大きさで抑えられ、信号の立ち上がりでも発散しません。
+ */
+static void update_normalized(lms* filter, signal residual) {
+    register uint64_t norm = filter->energy;
+    register uint64_t error = SQUARE(RSHIFT(residual, filter->energy_shift));
+    register int32_t shift = filter->step_bias;
 
-    for (i = 0; i < filter->taps; ++i) {
-        sum += RSHIFT(filter->weights[i] * filter->history[i], filter->shift);  
+    if (error > norm) {
+        norm = error;
     }
 
-    return sum;
+    if (norm != 0) {
+        shift += (int32_t)(64 - COUNT_LEADING_ZEROS64(norm));
+    }
+
+    /* 更新関数が扱えるのは32ビットまでの右シフトのため、超える分は予測残差を先にシフトしておく */
+    if (shift > 32) {
+        residual = RSHIFT(residual, (shift - 32 > 31) ? 31 : shift - 32);
+        shift = 32;
+    }
+    else if (shift < 0) {
+        shift = 0;
+    }
+
+    if (residual != 0) {
+        filter->normalized_update_kernel(filter->weights, &filter->history[filter->position], filter->taps, residual, (uint32_t)shift);
+    }
 }
 
 /*!
@@ -88,22 +735,148 @@ signal lms_predict(lms* filter) {
  * @param residual  実際のPCMサンプルと、予測されたPCMサンプルの差分
  */
 void lms_update(lms* filter, signal sample, signal residual) {
-    register uint32_t i;
     register int32_t sgn = SIGN(residual);
+    register uint32_t position = filter->position;
 
     if (filter->taps == 0){
         return;
     }
 
-    for (i = 0; i < filter->taps; ++i) {
-        filter->weights[i] += sgn * SIGN(filter->history[i]);
+    if (filter->mode == LMS_MODE_NORMALIZED) {
+        update_normalized(filter, residual);
+
+        /* 最も古いサンプルが領域から外れ、新しいサンプルが加わる */
+        filter->energy += SQUARE(RSHIFT(sample, filter->energy_shift));
+        filter->energy -= SQUARE(RSHIFT(filter->history[position + filter->taps - 1], filter->energy_shift));
     }
+    /* 予測残差がゼロであれば、重み係数は変化しない */
+    else if (sgn != 0) {
+        filter->update_kernel(filter->weights, &filter->history[position], filter->taps, sgn);
+    }
+
+    /* 位置を1つ戻して最新のサンプルを書き込む。後半にも同じ値を書き込むことで、
+       history[position]からtaps個の領域が、常に新しい順の過去サンプルとなる */
+    position = (position == 0 ? filter->taps : position) - 1;
+    filter->history[position] = sample;
+    filter->history[position + filter->taps] = sample;
+    filter->position = position;
+}
 
-    memmove(&filter->history[1], &filter->history[0], (filter->taps - 1) * sizeof(int32_t));
-    filter->history[0] = sample;
+/*!
+ * @brief           サブブロックの信号に多項式予測器とLMSフィルタを続けて適用し、予測残差に置き換えます。
+ * @param *filter   LMSフィルタのハンドル
+ * @param *poly     多項式予測器のハンドル
+ * @param *data     [入出力]信号。予測残差で上書きされます。
+ * @param size      信号のサンプル数
+ */
+void lms_encode_block(lms* filter, polynomial_predictor* poly, signal* data, uint32_t size) {
+    register uint32_t i;
+    register signal input;
+    signal poly_history[POLYNOMIAL_PREDICATOR_MAX_HISTORY];
+    signal tail[POLYNOMIAL_PREDICATOR_MAX_HISTORY];
+    uint32_t num_tail;
+
+    /* 専用の処理は既定の次数と減衰の度合いの多項式予測器を組み込んでおり、直近の2サンプルのみを保持する。
+     * 多項式予測器の過去サンプルは、上書きされる前の信号の末尾で更新する */
+    if (filter->encode_block_kernel != NULL && IS_DEFAULT_POLYNOMIAL_PREDICTOR(poly)) {
+        num_tail = (size < POLYNOMIAL_PREDICATOR_MAX_HISTORY) ? size : POLYNOMIAL_PREDICATOR_MAX_HISTORY;
+        memcpy(tail, &data[size - num_tail], sizeof(signal) * num_tail);
+        polynomial_predictor_get_history(poly, poly_history);
+        filter->position = filter->encode_block_kernel(filter->weights, filter->history, filter->position, poly_history, data, size);
+        for (i = 0; i < num_tail; ++i) {
+            polynomial_predictor_update(poly, tail[i]);
+        }
+        return;
+    }
+
+    /* それ以外の次数と減衰の度合いでは、多項式予測器を先にまとめて適用し、LMSフィルタのみを専用の処理で適用する */
+    if (filter->encode_block_kernel != NULL) {
+        polynomial_predictor_encode_block(poly, data, size);
+        filter->position = filter->encode_block_kernel(filter->weights, filter->history, filter->position, NULL, data, size);
+        return;
+    }
+
+    for (i = 0; i < size; ++i) {
+        input = data[i] - polynomial_predictor_predict(poly);
+        polynomial_predictor_update(poly, data[i]);
+        data[i] = input - lms_predict(filter);
+        lms_update(filter, input, data[i]);
+    }
+}
+
+/*!
+ * @brief           LMSフィルタと多項式予測器の予測残差から、サブブロックの信号を復元します。
+ * @param *filter   LMSフィルタのハンドル
+ * @param *poly     多項式予測器のハンドル
+ * @param *data     [入出力]予測残差。復元された信号で上書きされます。
+ * @param size      信号のサンプル数
+ */
+void lms_decode_block(lms* filter, polynomial_predictor* poly, signal* data, uint32_t size) {
+    register uint32_t i;
+    register signal input;
+    signal poly_history[POLYNOMIAL_PREDICATOR_MAX_HISTORY];
+
+    if (filter->decode_block_kernel != NULL && IS_DEFAULT_POLYNOMIAL_PREDICTOR(poly)) {
+        polynomial_predictor_get_history(poly, poly_history);
+        filter->position = filter->decode_block_kernel(filter->weights, filter->history, filter->position, poly_history, data, size);
+        for (i = (size < POLYNOMIAL_PREDICATOR_MAX_HISTORY) ? 0 : size - POLYNOMIAL_PREDICATOR_MAX_HISTORY; i < size; ++i) {
+            polynomial_predictor_update(poly, data[i]);
+        }
+        return;
+    }
+
+    if (filter->decode_block_kernel != NULL) {
+        filter->position = filter->decode_block_kernel(filter->weights, filter->history, filter->position, NULL, data, size);
+        polynomial_predictor_decode_block(poly, data, size);
+        return;
+    }
+
+    for (i = 0; i < size; ++i) {
+        input = data[i] + lms_predict(filter);
+        lms_update(filter, input, data[i]);
+        data[i] = input + polynomial_predictor_predict(poly);
+        polynomial_predictor_update(poly, data[i]);
+    }
+}
+
+/*!
+ * @brief           サブブロックの信号をLMSフィルタのみで予測し、予測残差に置き換えます。多段のLMSフィルタの各段に用います。
+ * @param *filter   LMSフィルタのハンドル
+ * @param *data     [入出力]信号。予測残差で上書きされます。
+ * @param size      信号のサンプル数
+ */
+void lms_encode_stage(lms* filter, signal* data, uint32_t size) {
+    register uint32_t i;
+    register signal input;
+
+    if (filter->taps == 0) {
+        return;
+    }
+
+    for (i = 0; i < size; ++i) {
+        input = data[i];
+        data[i] = input - lms_predict(filter);
+        lms_update(filter, input, data[i]);
+    }
+}
+
+/*!
+ * @brief           LMSフィルタのみの予測残差から、サブブロックの信号を復元します。多段のLMSフィルタの各段に用います。
+ * @param *filter   LMSフィルタのハンドル
+ * @param *data     [入出力]予測残差。復元された信号で上書きされます。
+ * @param size      信号のサンプル数
+ */
+void lms_decode_stage(lms* filter, signal* data, uint32_t size) {
+    register uint32_t i;
+    register signal residual;
+
+    if (filter->taps == 0) {
+        return;
+    }
 
-    /*for (i = filter->taps - 1; i >= 1; --i) {
-        filter->history[i] = filter->history[i - 1];
+    for (i = 0; i < size; ++i) {
+        residual = data[i];
+        data[i] = residual + lms_predict(filter);
+        lms_update(filter, data[i], residual);
     }
-    filter->history[0] = sample;*/
 }
\ No newline at end of file
@@ -0,0 +1,376 @@
+#include "./include/lpc.h"
+#include "./include/macro.h"
+#include "./include/neac_error.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LPC_AUTOCORRELATION_BIAS    (1.0 + 1.0e-9)      /* 自己相関の0次の項に掛け、係数の計算を数値的に安定させる値 */
+#define LPC_INVERSE_LN2             1.4426950408889634  /* 1 / ln(2) */
+
+#pragma region 固定係数のFIRフィルタ
+
+/*!
+ * @brief                   新しい順の過去サンプルと量子化された係数から、次に続くPCMサンプルを予測します。
+ * @param *coefficients     量子化された係数
+ * @param *history          新しい順の過去サンプル
+ * @param order             予測次数
+ * @param shift             量子化された係数のシフト量
+ * @return                  予測されたPCMサンプル（PCMサンプルの範囲に収まるよう飽和させた値）
+ */
+static inline signal predict_fir(const signal* coefficients, const signal* history, uint32_t order, uint32_t shift) {
+    register uint32_t i;
+    register int64_t sum = 0;
+
+    /* 32ビットのPCMでも、係数と過去サンプルの積の総和は64ビットに収まる */
+    for (i = 0; i < order; ++i) {
+        sum += (int64_t)coefficients[i] * history[i];
+    }
+    sum = RSHIFT(sum, shift);
+
+    if (sum > INT32_MAX) {
+        return INT32_MAX;
+    }
+    if (sum < INT32_MIN) {
+        return INT32_MIN;
+    }
+    return (signal)sum;
+}
+
+/*!
+ * @brief               リングバッファに過去サンプルを追加します。
+ * @param *history      過去サンプル領域（最大次数の2倍の長さ）
+ * @param position      最新の過去サンプルの位置
+ * @param sample        追加するPCMサンプル
+ * @return              追加後の最新の過去サンプルの位置
+ */
+static inline uint32_t push_history(signal* history, uint32_t position, signal sample) {
+    position = (position == 0 ? LPC_MAX_ORDER : position) - 1;
+    history[position] = sample;
+    history[position + LPC_MAX_ORDER] = sample;
+    return position;
+}
+
+#pragma endregion
+
+/*!
+ * @brief               線形予測器のハンドルを生成します。
+ * @return              線形予測器のハンドル
+ */
+lpc* lpc_create() {
+    lpc* result = (lpc*)malloc(sizeof(lpc));
+
+    if (result == NULL) {
+        report_error(NEAC_ERROR_LPC_CANNOT_ALLOCATE_MEMORY);
+        return NULL;
+    }
+
+    /* 過去サンプルは2回ずつ書き込み、連続した最大次数分の領域として読み出せるようにする */
+    result->history = (signal*)calloc(LSHIFT(LPC_MAX_ORDER, 1), sizeof(signal));
+    result->position = 0;
+
+    if (result->history == NULL) {
+        report_error(NEAC_ERROR_LPC_CANNOT_ALLOCATE_MEMORY);
+    }
+    return result;
+}
+
+/*!
+ * @brief               線形予測器を解放します。
+ * @param *predictor    線形予測器のハンドル
+ */
+void lpc_free(lpc* predictor) {
+    free(predictor->history);
+}
+
+/*!
+ * @brief               線形予測器を初期化します。
+ * @param *predictor    線形予測器のハンドル
+ */
+void lpc_clear(lpc* predictor) {
+    memset(predictor->history, 0, sizeof(signal) * LSHIFT(LPC_MAX_ORDER, 1));
+    predictor->position = 0;
+}
+
+/*!
+ * @brief                   指定された係数で、次に続くPCMサンプルを予測します。
+ * @param *predictor        線形予測器のハンドル
+ * @param *coefficients     量子化された係数（新しい過去サンプルに掛かるものから順）
+ * @param order             予測次数
+ * @param shift             量子化された係数のシフト量
+ * @return                  予測されたPCMサンプル
+ */
+signal lpc_predict(const lpc* predictor, const signal* coefficients, uint8_t order, uint8_t shift) {
+    return predict_fir(coefficients, &predictor->history[predictor->position], order, shift);
+}
+
+/*!
+ * @brief               線形予測器の過去サンプルを更新します。
+ * @param *predictor    線形予測器のハンドル
+ * @param sample        PCMサンプル
+ */
+void lpc_update(lpc* predictor, signal sample) {
+    predictor->position = push_history(predictor->history, predictor->position, sample);
+}
+
+/*!
+ * @brief               線形予測器を使用しないサブブロックの信号で、過去サンプルのみを更新します。
+ * @param *predictor    線形予測器のハンドル
+ * @param *data         信号
+ * @param size          信号のサンプル数
+ */
+void lpc_update_block(lpc* predictor, const signal* data, uint32_t size) {
+    register uint32_t i;
+    register uint32_t position = predictor->position;
+
+    /* 最大次数より前のサンプルは、後続のサンプルで上書きされるため読み飛ばす */
+    i = (size > LPC_MAX_ORDER) ? size - LPC_MAX_ORDER : 0;
+    for (; i < size; ++i) {
+        position = push_history(predictor->history, position, data[i]);
+    }
+
+    predictor->position = position;
+}
+
+/*!
+ * @brief               線形予測器の過去サンプルを取得します。
+ * @param *predictor    線形予測器のハンドル
+ * @param *history      [出力]新しい順の過去サンプル
+ * @param count         取得する過去サンプルの数（LPC_MAX_ORDER以下）
+ */
+void lpc_get_history(const lpc* predictor, signal* history, uint32_t count) {
+    memcpy(history, &predictor->history[predictor->position], sizeof(signal) * count);
+}
+
+/*!
+ * @brief                   サブブロックの信号を指定された係数で予測し、予測残差に置き換えます。
+ * @param *predictor        線形予測器のハンドル
+ * @param *coefficients     量子化された係数（新しい過去サンプルに掛かるものから順）
+ * @param order             予測次数
+ * @param shift             量子化された係数のシフト量
+ * @param *data             [入出力]信号。予測残差で上書きされます。
+ * @param size              信号のサンプル数
+ */
+void lpc_encode_block(lpc* predictor, const signal* coefficients, uint8_t order, uint8_t shift, signal* data, uint32_t size) {
+    register uint32_t i;
+    register uint32_t position = predictor->position;
+    register signal sample;
+    signal* history = predictor->history;
+
+    /* 32ビットのPCMでは予測残差が32ビットを超え得るが、デコーダと同じく32ビットで循環させる */
+    for (i = 0; i < size; ++i) {
+        sample = data[i];
+        data[i] = (signal)(uint32_t)((int64_t)sample - predict_fir(coefficients, &history[position], order, shift));
+        position = push_history(history, position, sample);
+    }
+
+    predictor->position = position;
+}
+
+/*!
+ * @brief                   指定された係数による予測残差から、サブブロックの信号を復元します。
+ * @param *predictor        線形予測器のハンドル
+ * @param *coefficients     量子化された係数（新しい過去サンプルに掛かるものから順）
+ * @param order             予測次数
+ * @param shift             量子化された係数のシフト量
+ * @param *data             [入出力]予測残差。復元された信号で上書きされます。
+ * @param size              信号のサンプル数
+ */
+void lpc_decode_block(lpc* predictor, const signal* coefficients, uint8_t order, uint8_t shift, signal* data, uint32_t size) {
+    register uint32_t i;
+    register uint32_t position = predictor->position;
+    signal* history = predictor->history;
+
+    for (i = 0; i < size; ++i) {
+        data[i] = (signal)(uint32_t)((int64_t)data[i] + predict_fir(coefficients, &history[position], order, shift));
+        position = push_history(history, position, data[i]);
+    }
+
+    predictor->position = position;
+}
+
+/*!
+ * @brief                   指定された係数による予測残差の絶対値の合計を、過去サンプルを更新せずに求めます。
+ * @param *predictor        線形予測器のハンドル
+ * @param *coefficients     量子化された係数（新しい過去サンプルに掛かるものから順）
+ * @param order             予測次数
+ * @param shift             量子化された係数のシフト量
+ * @param *data             信号
+ * @param size              信号のサンプル数
+ * @return                  予測残差の絶対値の合計
+ */
+uint64_t lpc_compute_residual_sum(const lpc* predictor, const signal* coefficients, uint8_t order, uint8_t shift, const signal* data, uint32_t size) {
+    register uint32_t i;
+    register uint32_t position = predictor->position;
+    register int64_t residual;
+    uint64_t sum = 0;
+    signal history[LSHIFT(LPC_MAX_ORDER, 1)];
+
+    memcpy(history, predictor->history, sizeof(history));
+
+    for (i = 0; i < size; ++i) {
+        residual = (int64_t)data[i] - predict_fir(coefficients, &history[position], order, shift);
+        sum += (uint64_t)(residual < 0 ? -residual : residual);
+        position = push_history(history, position, data[i]);
+    }
+
+    return sum;
+}
+
+#pragma region 係数の計算
+
+/*!
+ * @brief       正の実数の2を底とする対数の近似値を求めます。
+ * @param x     正の実数
+ * @return      対数の近似値
+ */
+static double approximate_log2(double x) {
+    register int32_t exponent = 0;
+    register double t, t2;
+
+    while (x >= 2.0) {
+        x *= 0.5;
+        ++exponent;
+    }
+    while (x < 1.0) {
+        x *= 2.0;
+        --exponent;
+    }
+
+    /* [1, 2)の仮数部の自然対数を、ln(x) = 2 * artanh((x - 1) / (x + 1)) の級数の3項で近似する */
+    t = (x - 1.0) / (x + 1.0);
+    t2 = t * t;
+    return exponent + 2.0 * t * (1.0 + t2 * (1.0 / 3.0 + t2 * 0.2)) * LPC_INVERSE_LN2;
+}
+
+/*!
+ * @brief                   サブブロックの信号の自己相関からレビンソン・ダービン法で係数を求め、量子化します。
+ * @param *data             信号
+ * @param size              信号のサンプル数
+ * @param max_order         予測次数の上限（LPC_MAX_ORDER以下）
+ * @param precision         量子化された係数の、符号を含むビット数（LPC_MAX_COEFFICIENT_PRECISION以下）
+ * @param *work             窓関数を掛けた信号を格納する、信号のサンプル数分の作業領域
+ * @param *coefficients     [出力]量子化された係数（新しい過去サンプルに掛かるものから順）
+ * @param *shift            [出力]量子化された係数のシフト量
+ * @return                  推定される符号量が最小となる予測次数。線形予測が適さない信号では0
+ */
+uint8_t lpc_compute_coefficients(const signal* data, uint32_t size, uint8_t max_order, uint8_t precision, double* work, signal* coefficients, uint8_t* shift) {
+    register uint32_t i, j;
+    uint32_t order, best_order;
+    double center, half_width, distance;
+    double autocorrelation[LPC_MAX_ORDER + 1];
+    double lp[LPC_MAX_ORDER][LPC_MAX_ORDER];
+    double error, reflection, sum, bits, best_bits;
+    double max_coefficient, scale, quantization_error, value;
+    int32_t quantized;
+    const int32_t max_quantized = (int32_t)LSHIFT(1, precision - 1) - 1;
+
+    *shift = 0;
+
+    if (max_order > LPC_MAX_ORDER) {
+        max_order = LPC_MAX_ORDER;
+    }
+    if (size <= max_order) {
+        max_order = (uint8_t)(size > 0 ? size - 1 : 0);
+    }
+    if (max_order == 0) {
+        return 0;
+    }
+
+    /* STEP 1. ブロックの両端の影響を抑えるため、Welch窓を掛ける */
+    center = (size - 1) * 0.5;
+    half_width = (size + 1) * 0.5;
+    for (i = 0; i < size; ++i) {
+        distance = (i - center) / half_width;
+        work[i] = data[i] * (1.0 - distance * distance);
+    }
+
+    /* STEP 2. 自己相関を求める */
+    for (j = 0; j <= max_order; ++j) {
+        sum = 0.0;
+        for (i = j; i < size; ++i) {
+            sum += work[i] * work[i - j];
+        }
+        autocorrelation[j] = sum;
+    }
+    autocorrelation[0] *= LPC_AUTOCORRELATION_BIAS;
+
+    if (autocorrelation[0] <= 0.0) {
+        return 0;
+    }
+
+    /* STEP 3. レビンソン・ダービン法で各次数の係数を求め、予測誤差と係数の符号量の合計が最小となる次数を選ぶ */
+    error = autocorrelation[0];
+    best_order = 0;
+    best_bits = 0.5 * size * approximate_log2(error);
+    for (order = 0; order < max_order; ++order) {
+        sum = autocorrelation[order + 1];
+        for (j = 0; j < order; ++j) {
+            sum -= lp[order - 1][j] * autocorrelation[order - j];
+        }
+        reflection = sum / error;
+
+        for (j = 0; j < order; ++j) {
+            lp[order][j] = lp[order - 1][j] - reflection * lp[order - 1][order - 1 - j];
+        }
+        lp[order][order] = reflection;
+
+        error *= 1.0 - reflection * reflection;
+        if (error <= 0.0) {
+            break;
+        }
+
+        bits = 0.5 * size * approximate_log2(error) + (double)(order + 1) * precision;
+        if (bits < best_bits) {
+            best_bits = bits;
+            best_order = order + 1;
+        }
+    }
+
+    if (best_order == 0) {
+        return 0;
+    }
+
+    /* STEP 4. 最大の係数が符号を含めてprecisionビットに収まる、最大のシフト量を求める */
+    max_coefficient = 0.0;
+    for (j = 0; j < best_order; ++j) {
+        value = lp[best_order - 1][j];
+        if (value < 0.0) {
+            value = -value;
+        }
+        if (value > max_coefficient) {
+            max_coefficient = value;
+        }
+    }
+
+    if (max_coefficient > max_quantized || max_coefficient == 0.0) {
+        return 0;
+    }
+
+    scale = 1.0;
+    while (*shift < LPC_MAX_SHIFT && max_coefficient * scale * 2.0 <= max_quantized) {
+        scale *= 2.0;
+        ++(*shift);
+    }
+
+    /* STEP 5. 丸め誤差を次の係数に持ち越しながら量子化する */
+    quantization_error = 0.0;
+    for (j = 0; j < best_order; ++j) {
+        quantization_error += lp[best_order - 1][j] * scale;
+        quantized = (int32_t)(quantization_error >= 0.0 ? quantization_error + 0.5 : quantization_error - 0.5);
+
+        if (quantized > max_quantized) {
+            quantized = max_quantized;
+        }
+        else if (quantized < -max_quantized) {
+            quantized = -max_quantized;
+        }
+
+        coefficients[j] = quantized;
+        quantization_error -= quantized;
+    }
+
+    return (uint8_t)best_order;
+}
+
+#pragma endregion
\ No newline at end of file
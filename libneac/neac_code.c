@@ -1,13 +1,27 @@
 #include "./include/macro.h"
+#include "./include/neac.h"
 #include "./include/neac_code.h"
 #include "./include/neac_error.h"
 #include "./include/neac_sub_block.h"
+#include "./include/range_coder.h"
+#include "./include/simd.h"
 #include "./include/signal.h"
-#include <math.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(_WIN32)
+/* InitOnceExecuteOnce はWindows Vista以降で使用可能 */
+#if !defined(_WIN32_WINNT) || _WIN32_WINNT < 0x0600
+#undef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600
+#endif
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
+
 #define U8_MAX  0xff
 #define U16_MAX 0xffff
 #define U24_MAX 0xffffff
@@ -62,28 +76,25 @@ static inline uint32_t count_bits(const uint32_t value) {
  * @param *stream   ビットストリームのハンドル
  * @param value     書き込む値
  */
-static inline void write_unary_code(bit_stream* stream, const uint32_t value) {
-    register uint32_t i;
-
-    for (i = 0; i < value; ++i) {
-        bit_stream_write_bit(stream, 1);
+static inline void write_unary_code(bit_stream* stream, uint32_t value) {
+    /* 32個以上の1は、32ビット単位でまとめて書き込む */
+    while (value >= 32) {
+        bit_stream_write_uint(stream, U32_MAX, 32);
+        value -= 32;
     }
-    bit_stream_write_bit(stream, 0);
+
+    /* 残りの1と終端の0を、1回で書き込む */
+    bit_stream_write_uint(stream, LSHIFT(LSHIFT(1u, value) - 1, 1), value + 1);
 }
 
 /*!
  * @brief           ビットストリームから、unary符号化された値を読み込みます。
  * @param *stream   ビットストリームのハンドル
- * @return          読み込まれた値
+ * @param limit     読み込む値の上限
+ * @return          読み込まれた値。上限に達した場合は、終端の0を読み込まずにlimitを返します。
  */
-static inline uint32_t read_unary_code(bit_stream* stream) {
-    register uint32_t result = 0;
-
-    while (bit_stream_read_bit(stream)) {
-        ++result;
-    }
-
-    return result;
+static inline uint32_t read_unary_code(bit_stream* stream, const uint32_t limit) {
+    return bit_stream_read_unary(stream, limit);
 }
 
 #pragma endregion
@@ -91,57 +102,95 @@ static inline uint32_t read_unary_code(bit_stream* stream) {
 #pragma region rice符号の実装
 
 /*!
- * @brief           指定されたビットストリームに、指定された値を、指定されたパラメータでライス符号化して書き込みます。
- * @param *stream   ビットストリームのハンドル
- * @param parameter ライス符号化のパラメータ
- * @param value     値
+ * @brief               指定されたビットストリームに、指定された値を、指定されたパラメータでライス符号化して書き込みます。
+ * @param *stream       ビットストリームのハンドル
+ * @param parameter     ライス符号化のパラメータ
+ * @param value         値
+ * @param use_escape    商がRICE_ESCAPE_QUOTIENT以上の場合に、値をエスケープして書き込むかどうか
+ * @note                パラメータの検証は呼び出し元で行います。
  */
-static void write_rice_code(bit_stream* stream, const uint32_t parameter, const int32_t value) {
+static inline void write_rice_code(bit_stream* stream, const uint32_t parameter, const int32_t value, const bool use_escape) {
     register uint32_t val;
     register uint32_t quotient;
-    register uint32_t remainder;
-
-    if (parameter < ENTROPY_PARAMETER_MIN || parameter > ENTROPY_RICE_PARAMETER_MAX) {
-        report_error(NEAC_ERROR_RICE_CODING_INVALID_PARAMETER);
-        return;
-    }
+    register uint32_t length;
 
     val = CONVERT_INT32_TO_UINT32(value);
     quotient = RSHIFT(val, parameter);
-    remainder = val - LSHIFT(quotient, parameter);
-
-    /* 商をunary符号として書き込む */
-    write_unary_code(stream, quotient);
+    length = quotient + 1 + parameter;
 
-    /* 剰余を書き込む */
-    bit_stream_write_uint(stream, remainder, parameter);
+    if (use_escape && quotient >= RICE_ESCAPE_QUOTIENT) {
+        /* RICE_ESCAPE_QUOTIENT個の1（終端の0は書き込まない）に続けて、値をそのまま書き込む */
+        bit_stream_write_uint(stream, (uint32_t)(LSHIFT(1ull, RICE_ESCAPE_QUOTIENT) - 1), RICE_ESCAPE_QUOTIENT);
+        bit_stream_write_uint(stream, val, RICE_ESCAPE_VALUE_BITS);
+    }
+    else if (length <= 32) {
+        /* 商のunary符号、終端の0、剰余を1つの符号語としてレジスタ上で組み立て、1回で書き込む */
+        bit_stream_write_uint(stream, LSHIFT(LSHIFT(1u, quotient) - 1, parameter + 1) | (val & (LSHIFT(1u, parameter) - 1)), length);
+    }
+    else {
+        /* 符号語が32ビットを超える場合は、商と剰余を分けて書き込む */
+        write_unary_code(stream, quotient);
+        bit_stream_write_uint(stream, val & (uint32_t)(LSHIFT(1ull, parameter) - 1), parameter);
+    }
 }
 
-static inline void write_rice_values(bit_stream* stream, const signal* data, uint16_t start, uint16_t data_size, uint32_t parameter) {
-    uint16_t offset;
+/*!
+ * @brief           指定されたビットストリームに、パーティションの値を、指定されたパラメータでまとめてライス符号化して書き込みます。
+ * @param *coder    ブロック読み書きAPIのハンドル
+ * @param *data     データのポインタ
+ * @param start     パーティションの開始位置
+ * @param data_size パーティションのサイズ
+ * @param parameter ライス符号化のパラメータ
+ */
+static inline void write_rice_values(neac_code* coder, const signal* data, uint16_t start, uint16_t data_size, uint32_t parameter) {
+    bit_stream* stream = coder->bitstream;
+    const bool use_escape = coder->format_version >= NEAC_FORMAT_VERSION_RICE_ESCAPE;
+    register uint32_t offset;
+
+    if (parameter < ENTROPY_PARAMETER_MIN || parameter > ENTROPY_RICE_PARAMETER_MAX) {
+        report_error(NEAC_ERROR_RICE_CODING_INVALID_PARAMETER);
+        return;
+    }
 
     for (offset = 0; offset < data_size; ++offset) {
-        write_rice_code(stream, parameter, data[offset + start]);
+        write_rice_code(stream, parameter, data[offset + start], use_escape);
     }
 }
 
 /*!
  * @brief           指定されたビットストリームから、指定されたパラメータでエントロピー符号化された値を1つ読み込みます。
- * @param *stream   ビットストリームのハンドル
+ * @param *coder    ブロック読み書きAPIのハンドル
  * @param parameter エントロピー符号化のパラメータ
  * @return          読み込まれた値
  */
-static int32_t read_rice_code(bit_stream* stream, const uint32_t parameter) {
+static int32_t read_rice_code(neac_code* coder, const uint32_t parameter) {
+    bit_stream* stream = coder->bitstream;
     register uint32_t quotient;
     register uint32_t remainder;
+    register uint32_t limit;
 
     if (parameter < ENTROPY_PARAMETER_MIN || parameter > ENTROPY_RICE_PARAMETER_MAX) {
         report_error(NEAC_ERROR_RICE_CODING_INVALID_PARAMETER);
         return 0;
     }
 
-    /* unary符号化された商を読み込む */
-    quotient = read_unary_code(stream);
+    if (coder->format_version >= NEAC_FORMAT_VERSION_RICE_ESCAPE) {
+        /* unary符号化された商を読み込む。商がRICE_ESCAPE_QUOTIENTに達していれば、値がそのまま書き込まれている。*/
+        quotient = read_unary_code(stream, RICE_ESCAPE_QUOTIENT);
+        if (quotient == RICE_ESCAPE_QUOTIENT) {
+            remainder = bit_stream_read_uint(stream, RICE_ESCAPE_VALUE_BITS);
+            return CONVERT_UINT32_TO_INT32(remainder);
+        }
+    }
+    else {
+        /* エスケープのない古いフォーマットでは、32ビットで表現可能な商の最大値を上限とし、不正なデータで停止しないようにする */
+        limit = RSHIFT(U32_MAX, parameter);
+        quotient = read_unary_code(stream, limit);
+        if (quotient == limit && bit_stream_read_bit(stream)) {
+            report_error(NEAC_ERROR_RICE_CODING_INVALID_CODE);
+            return 0;
+        }
+    }
 
     /* 剰余を読み込む */
     remainder = bit_stream_read_uint(stream, parameter);
@@ -150,17 +199,144 @@ static int32_t read_rice_code(bit_stream* stream, const uint32_t parameter) {
     return CONVERT_UINT32_TO_INT32(LSHIFT(quotient, parameter) + remainder);
 }
 
-static inline void read_rice_values(bit_stream* stream, signal* data, uint16_t start, uint16_t data_size, uint32_t parameter) {
-    uint16_t offset;
+/* パラメータ毎のライス符号の復号テーブル。内容はパラメータのみで決まるため、すべてのハンドルで共有する（最初のハンドルの生成時に一度だけ生成） */
+static rice_decode_entry rice_decode_tables[RICE_DECODE_TABLE_PARAMETER_MAX + 1][RICE_DECODE_TABLE_SIZE];
+
+/*!
+ * @brief           指定されたパラメータでライス符号化された符号語を、索引のビット列から可能な限り復号するテーブルを生成します。
+ * @param parameter ライス符号化のパラメータ（RICE_DECODE_TABLE_PARAMETER_MAX以下）
+ */
+static void build_rice_decode_table(const uint32_t parameter) {
+    rice_decode_entry* table = rice_decode_tables[parameter];
+    rice_decode_entry* entry;
+    uint32_t index, position, quotient, remainder;
+
+    for (index = 0; index < RICE_DECODE_TABLE_SIZE; ++index) {
+        entry = &table[index];
+        entry->count = 0;
+        position = 0;
+
+        while (entry->count < RICE_DECODE_TABLE_MAX_SYMBOLS) {
+            /* 索引の上位から、unary符号化された商を読む */
+            quotient = 0;
+            while (position + quotient < RICE_DECODE_TABLE_BITS && (RSHIFT(index, RICE_DECODE_TABLE_BITS - 1 - position - quotient) & 1)) {
+                ++quotient;
+            }
+
+            /* 終端の0と剰余が索引に収まらなければ、この符号語は復号できない */
+            if (position + quotient + 1 + parameter > RICE_DECODE_TABLE_BITS) {
+                break;
+            }
+            position += quotient + 1;
+
+            remainder = RSHIFT(index, RICE_DECODE_TABLE_BITS - position - parameter) & (LSHIFT(1u, parameter) - 1);
+            position += parameter;
+
+            entry->values[entry->count] = (int16_t)CONVERT_UINT32_TO_INT32(LSHIFT(quotient, parameter) + remainder);
+            entry->lengths[entry->count] = (uint8_t)position;
+            entry->count++;
+        }
+    }
+}
+
+/*!
+ * @brief           すべてのパラメータのライス符号の復号テーブルを生成します。
+ */
+static void build_rice_decode_tables(void) {
+    uint32_t parameter;
+
+    for (parameter = 0; parameter <= RICE_DECODE_TABLE_PARAMETER_MAX; ++parameter) {
+        build_rice_decode_table(parameter);
+    }
+}
+
+#if defined(_WIN32)
+static INIT_ONCE rice_decode_tables_once = INIT_ONCE_STATIC_INIT;
+
+/*!
+ * @brief           InitOnceExecuteOnce から呼び出され、ライス符号の復号テーブルを生成します。
+ * @return          常に TRUE を返します
+ */
+static BOOL CALLBACK build_rice_decode_tables_once(PINIT_ONCE once, PVOID parameter, PVOID* context) {
+    (void)once;
+    (void)parameter;
+    (void)context;
+    build_rice_decode_tables();
+    return TRUE;
+}
+#else
+static pthread_once_t rice_decode_tables_once = PTHREAD_ONCE_INIT;
+#endif
+
+/*!
+ * @brief           ライス符号の復号テーブルが生成されていなければ生成します。
+ * @note            複数のスレッドから同時に呼び出された場合も、テーブルは一度だけ生成され、生成が完了するまで他のスレッドは待機します。
+ */
+static void initialize_rice_decode_tables(void) {
+#if defined(_WIN32)
+    InitOnceExecuteOnce(&rice_decode_tables_once, build_rice_decode_tables_once, NULL, NULL);
+#else
+    pthread_once(&rice_decode_tables_once, build_rice_decode_tables);
+#endif
+}
+
+/*!
+ * @brief           指定されたビットストリームから、指定されたパラメータでライス符号化された値を、指定された数だけ読み込みます。
+ * @param *coder    ブロック読み書きAPIのハンドル
+ * @param *data     読み込んだ値を格納する領域のポインタ
+ * @param start     格納を開始するオフセット
+ * @param data_size 読み込む値の数
+ * @param parameter ライス符号化のパラメータ
+ * @note            パラメータが小さい場合は復号テーブルを用いて一度に複数の符号語を復号し、テーブルで復号できない長い符号語のみ1つずつ復号します。
+ */
+static inline void read_rice_values(neac_code* coder, signal* data, uint16_t start, uint16_t data_size, uint32_t parameter) {
+    bit_stream* stream = coder->bitstream;
+    const rice_decode_entry* table = NULL;
+    const rice_decode_entry* entry;
+    register uint32_t offset = 0;
+    register uint32_t count, i;
+
+    if (parameter <= RICE_DECODE_TABLE_PARAMETER_MAX) {
+        table = rice_decode_tables[parameter];
+    }
+
+    if (table != NULL) {
+        while (offset < data_size) {
+            entry = &table[bit_stream_peek_uint(stream, RICE_DECODE_TABLE_BITS)];
+
+            /* 索引に収まらない長い符号語は、1つずつ復号する */
+            if (entry->count == 0) {
+                data[start + offset] = read_rice_code(coder, parameter);
+                ++offset;
+                continue;
+            }
+
+            /* 復号すべき残りの値の数を超えないように、テーブルから値を取り出す */
+            count = entry->count;
+            if (count > data_size - offset) {
+                count = data_size - offset;
+            }
+
+            for (i = 0; i < count; ++i) {
+                data[start + offset + i] = entry->values[i];
+            }
+
+            bit_stream_skip_bits(stream, entry->lengths[count - 1]);
+            offset += count;
+        }
+
+        return;
+    }
 
     for (offset = 0; offset < data_size; ++offset) {
-        data[start + offset] = read_rice_code(stream, parameter);
+        data[start + offset] = read_rice_code(coder, parameter);
     }
 }
 
 /*!
  * @brief                   指定されたデータを、指定されたパラメータでライス符号化した場合のビット数を計算します。
  * @param *data             データ
+ * @param start             データの開始オフセット
  * @param data_size         データのサイズ
  * @param parameter         ライス符号化のパラメータ
  * @return                  指定されたデータを、指定されたパラメータでライス符号化した場合のビット数
@@ -175,7 +351,8 @@ static uint32_t compute_rice_total_bits(const signal* data, const uint16_t start
         val = CONVERT_INT32_TO_UINT32(data[start + offset]);
         quotient = RSHIFT(val, parameter);
 
-        estimated_size += quotient;                 /* 商のビット数 */
+        /* 商と終端の0のビット数（エスケープされる場合は、エスケープと値のビット数から、後で加算する剰余のビット数を除いたもの） */
+        estimated_size += (quotient < RICE_ESCAPE_QUOTIENT) ? (quotient + 1) : (RICE_ESCAPE_QUOTIENT + RICE_ESCAPE_VALUE_BITS - parameter);
     }
 
     estimated_size += (parameter * data_size);      /* 剰余のビット数 */
@@ -188,30 +365,287 @@ static uint32_t compute_rice_total_bits(const signal* data, const uint16_t start
  * @param *data         データのポインタ
  * @param start         データの開始オフセット
  * @param data_size     データのサイズ
- * @param *total_bits   [出力]求められたパラメータでライス符号化した場合のデータの合計ビット数
+ * @param sum           データを符号なし整数に変換した値の合計
+ * @param *total_bits   [出力]求められたパラメータでライス符号化した場合のデータの合計ビット数（パラメータの保存に要するビット数を含む）
  * @return              指定されたデータに対して最適となるライス符号化のパラメータ
  */
-static uint32_t compute_optimal_rice_parameter(const signal* data, const uint16_t start, const uint16_t data_size, uint32_t* total_bits) {
-    register double sum = 0;
-    register double mean = 0;
-    register uint32_t i;
+static uint32_t compute_optimal_rice_parameter(const signal* data, const uint16_t start, const uint16_t data_size, const uint64_t sum, uint32_t* total_bits) {
+    register uint32_t mean;
+    uint32_t parameter, trial, trial_max;
+    uint32_t bits, min_bits;
+
+    /* 出現するデータを符号なし整数に変換した値の平均を、整数演算のみで求める。*/
+    mean = (uint32_t)(sum / data_size);
+
+    /* 平均の2を底とする対数の整数部を、パラメータの推定値とする。*/
+    parameter = (mean > 0) ? count_bits(mean) - 1 : 0;
+    if (parameter > ENTROPY_PARTITION_RICE_PARAMETER_MAX) {
+        parameter = ENTROPY_PARTITION_RICE_PARAMETER_MAX;
+    }
+
+    /* 推定値とその前後のパラメータで実際のビット数を計算し、最小となるものを選ぶ。*/
+    trial = (parameter > ENTROPY_RICE_PARAMETER_MIN) ? parameter - 1 : parameter;
+    trial_max = (parameter < ENTROPY_PARTITION_RICE_PARAMETER_MAX) ? parameter + 1 : parameter;
+    min_bits = U32_MAX;
+
+    for (; trial <= trial_max; ++trial) {
+        bits = compute_rice_total_bits(data, start, data_size, trial);
+
+        if (bits < min_bits) {
+            min_bits = bits;
+            parameter = trial;
+        }
+    }
+
+    *(total_bits) = min_bits + ENTROPY_PARAMETER_NEED_BITS;
+
+    return parameter;
+}
+
+#pragma endregion
+
+#pragma region ゼロ連続長符号の実装
+
+/*!
+ * @brief               符号なし整数の値の合計と個数から、ライス符号化のパラメータを推定します。
+ * @param sum           値の合計
+ * @param count         値の個数
+ * @return              平均の2を底とする対数の整数部
+ */
+static inline uint32_t estimate_rice_parameter(const uint64_t sum, const uint32_t count) {
+    register uint64_t mean = (count > 0) ? sum / count : 0;
     register uint32_t parameter;
 
-    /* 出現するデータの絶対値の平均を求める。*/
-    for (i = 0; i < data_size; ++i) {
-        /* sum += CONVERT_INT32_TO_UINT32(data[start + i]);     // こっちを使う場合、パラメータの最終出力を-1にすると良い */
-        sum += abs(data[start + i]);
+    if (mean == 0) {
+        return ENTROPY_RICE_PARAMETER_MIN;
+    }
+
+    parameter = 63 - COUNT_LEADING_ZEROS64(mean);
+    return (parameter > ENTROPY_PARTITION_RICE_PARAMETER_MAX) ? ENTROPY_PARTITION_RICE_PARAMETER_MAX : parameter;
+}
+
+/*!
+ * @brief               符号なし整数の値を、指定されたパラメータでライス符号化した場合のビット数を計算します。
+ * @param value         値
+ * @param parameter     ライス符号化のパラメータ
+ * @return              符号語のビット数（エスケープされる場合を含む）
+ */
+static inline uint32_t compute_rice_code_bits(const uint32_t value, const uint32_t parameter) {
+    register uint32_t quotient = RSHIFT(value, parameter);
+
+    return (quotient < RICE_ESCAPE_QUOTIENT) ? quotient + 1 + parameter : RICE_ESCAPE_QUOTIENT + RICE_ESCAPE_VALUE_BITS;
+}
+
+/*!
+ * @brief                   パーティションのゼロの連続長と、非ゼロの値のそれぞれに用いるライス符号化のパラメータを求めます。
+ * @param *data             データのポインタ
+ * @param start             パーティションの開始位置
+ * @param data_size         パーティションのサイズ
+ * @param *run_parameter    [出力]ゼロの連続長に用いるパラメータ
+ * @param *value_parameter  [出力]非ゼロの値から1を引いた値に用いるパラメータ
+ */
+static void compute_zero_run_parameters(const signal* data, const uint16_t start, const uint16_t data_size, uint32_t* run_parameter, uint32_t* value_parameter) {
+    register uint32_t offset;
+    register uint32_t run = 0;
+    uint64_t run_sum = 0, value_sum = 0;
+    uint32_t run_count = 0, value_count = 0;
+
+    for (offset = start; offset < (uint32_t)start + data_size; ++offset) {
+        if (data[offset] == 0) {
+            ++run;
+            continue;
+        }
+
+        run_sum += run;
+        ++run_count;
+        value_sum += CONVERT_INT32_TO_UINT32(data[offset]) - 1;
+        ++value_count;
+        run = 0;
     }
-    mean = sum / data_size;
 
-    /* 平均を整数に丸め込んだ値の表現に必要なビット数をパラメータとする。*/
-    parameter = count_bits((uint32_t)round(mean));
-    if (parameter > ENTROPY_RICE_PARAMETER_MAX) {
-        parameter = ENTROPY_RICE_PARAMETER_MAX;
+    if (run > 0) {
+        run_sum += run;
+        ++run_count;
     }
-    *(total_bits) = compute_rice_total_bits(data, start, data_size, parameter);
 
-    return parameter;
+    *(run_parameter) = estimate_rice_parameter(run_sum, run_count);
+    *(value_parameter) = estimate_rice_parameter(value_sum, value_count);
+}
+
+/*!
+ * @brief                   パーティションをゼロ連続長符号で符号化した場合のビット数を計算します。
+ * @param *data             データのポインタ
+ * @param start             パーティションの開始位置
+ * @param data_size         パーティションのサイズ
+ * @return                  パーティションのビット数（エントロピー符号化のパラメータの保存に要するビット数を含む）
+ */
+static uint32_t compute_zero_run_total_bits(const signal* data, const uint16_t start, const uint16_t data_size) {
+    register uint32_t offset;
+    register uint32_t run = 0;
+    uint32_t run_parameter, value_parameter;
+    uint32_t bits = 3 * ENTROPY_PARAMETER_NEED_BITS;
+
+    compute_zero_run_parameters(data, start, data_size, &run_parameter, &value_parameter);
+
+    for (offset = start; offset < (uint32_t)start + data_size; ++offset) {
+        if (data[offset] == 0) {
+            ++run;
+            continue;
+        }
+
+        bits += compute_rice_code_bits(run, run_parameter) + compute_rice_code_bits(CONVERT_INT32_TO_UINT32(data[offset]) - 1, value_parameter);
+        run = 0;
+    }
+
+    if (run > 0) {
+        bits += compute_rice_code_bits(run, run_parameter);
+    }
+
+    return bits;
+}
+
+/*!
+ * @brief           指定されたビットストリームに、パーティションの値をゼロ連続長符号で書き込みます。
+ * @param *coder    ブロック読み書きAPIのハンドル
+ * @param *data     データのポインタ
+ * @param start     パーティションの開始位置
+ * @param data_size パーティションのサイズ
+ * @note            2つのパラメータに続けて、非ゼロの値の直前のゼロの連続長と、非ゼロの値から1を引いた値を交互にライス符号化します。
+ *                  パーティションの末尾がゼロで終わる場合は、最後に連続長のみを書き込みます。
+ */
+static void write_zero_run_values(neac_code* coder, const signal* data, uint16_t start, uint16_t data_size) {
+    bit_stream* stream = coder->bitstream;
+    register uint32_t offset;
+    register uint32_t end = (uint32_t)start + data_size;
+    register uint32_t run;
+    register uint32_t value;
+    uint32_t run_parameter, value_parameter;
+
+    compute_zero_run_parameters(data, start, data_size, &run_parameter, &value_parameter);
+    bit_stream_write_uint(stream, run_parameter - ENTROPY_PARAMETER_MIN, ENTROPY_PARAMETER_NEED_BITS);
+    bit_stream_write_uint(stream, value_parameter - ENTROPY_PARAMETER_MIN, ENTROPY_PARAMETER_NEED_BITS);
+
+    /* 符号なし整数をそのまま書き込むため、ライス符号化の前に符号付き整数に戻しておく */
+    for (offset = start; offset < end; ) {
+        run = 0;
+        while (offset + run < end && data[offset + run] == 0) {
+            ++run;
+        }
+        write_rice_code(stream, run_parameter, CONVERT_UINT32_TO_INT32(run), true);
+
+        offset += run;
+        if (offset == end) {
+            break;
+        }
+
+        value = CONVERT_INT32_TO_UINT32(data[offset]) - 1;
+        write_rice_code(stream, value_parameter, CONVERT_UINT32_TO_INT32(value), true);
+        ++offset;
+    }
+}
+
+/*!
+ * @brief           指定されたビットストリームから、ゼロ連続長符号で書き込まれたパーティションの値を読み込みます。
+ * @param *coder    ブロック読み書きAPIのハンドル
+ * @param *data     読み込んだ値を格納する領域のポインタ
+ * @param start     パーティションの開始位置
+ * @param data_size パーティションのサイズ
+ */
+static void read_zero_run_values(neac_code* coder, signal* data, uint16_t start, uint16_t data_size) {
+    bit_stream* stream = coder->bitstream;
+    register uint32_t offset;
+    register uint32_t end = (uint32_t)start + data_size;
+    register uint32_t run;
+    register uint32_t value;
+    register int32_t code;
+    uint32_t run_parameter, value_parameter;
+
+    run_parameter = bit_stream_read_uint(stream, ENTROPY_PARAMETER_NEED_BITS) + ENTROPY_PARAMETER_MIN;
+    value_parameter = bit_stream_read_uint(stream, ENTROPY_PARAMETER_NEED_BITS) + ENTROPY_PARAMETER_MIN;
+
+    for (offset = start; offset < end; ) {
+        /* 変換マクロは引数を複数回評価するため、読み込んだ値を一旦変数に格納する */
+        code = read_rice_code(coder, run_parameter);
+        run = CONVERT_INT32_TO_UINT32(code);
+
+        /* 連続するゼロはまとめて埋める */
+        if (run > end - offset) {
+            report_error(NEAC_ERROR_RICE_CODING_INVALID_CODE);
+            run = end - offset;
+        }
+        memset(&data[offset], 0, sizeof(signal) * run);
+
+        offset += run;
+        if (offset == end) {
+            break;
+        }
+
+        code = read_rice_code(coder, value_parameter);
+        value = CONVERT_INT32_TO_UINT32(code) + 1;
+        data[offset] = CONVERT_UINT32_TO_INT32(value);
+        ++offset;
+    }
+}
+
+#pragma endregion
+
+#pragma region 固定長符号の実装
+
+/*!
+ * @brief               指定されたデータのすべての値を、符号なし整数に変換して格納するのに必要なビット数を求めます。
+ * @param *data         データのポインタ
+ * @param data_size     データのサイズ
+ * @return              必要なビット数（1以上32以下）
+ */
+static uint32_t compute_value_bits(const signal* data, const uint16_t data_size) {
+    zigzag_stats stats;
+
+    simd_compute_zigzag_stats(data, data_size, &stats);
+
+    return (stats.mask == 0) ? 1 : 64 - COUNT_LEADING_ZEROS64(stats.mask);
+}
+
+/*!
+ * @brief           指定されたビットストリームに、パーティションの値を固定長で書き込みます。
+ * @param *coder    ブロック読み書きAPIのハンドル
+ * @param *data     データのポインタ
+ * @param start     パーティションの開始位置
+ * @param data_size パーティションのサイズ
+ * @note            値1個あたりのビット数に続けて、すべての値を符号なし整数に変換して、そのビット数で書き込みます。
+ */
+static void write_fixed_width_values(neac_code* coder, const signal* data, uint16_t start, uint16_t data_size) {
+    bit_stream* stream = coder->bitstream;
+    register uint32_t offset;
+    register uint32_t end = (uint32_t)start + data_size;
+    uint32_t value_bits = compute_value_bits(&data[start], data_size);
+
+    bit_stream_write_uint(stream, value_bits - 1, ENTROPY_FIXED_WIDTH_NEED_BITS);
+
+    for (offset = start; offset < end; ++offset) {
+        bit_stream_write_uint(stream, CONVERT_INT32_TO_UINT32(data[offset]), value_bits);
+    }
+}
+
+/*!
+ * @brief           指定されたビットストリームから、固定長で書き込まれたパーティションの値を読み込みます。
+ * @param *coder    ブロック読み書きAPIのハンドル
+ * @param *data     読み込んだ値を格納する領域のポインタ
+ * @param start     パーティションの開始位置
+ * @param data_size パーティションのサイズ
+ */
+static void read_fixed_width_values(neac_code* coder, signal* data, uint16_t start, uint16_t data_size) {
+    bit_stream* stream = coder->bitstream;
+    register uint32_t offset;
+    register uint32_t end = (uint32_t)start + data_size;
+    register uint32_t value;
+    uint32_t value_bits;
+
+    value_bits = bit_stream_read_uint(stream, ENTROPY_FIXED_WIDTH_NEED_BITS) + 1;
+
+    for (offset = start; offset < end; ++offset) {
+        value = bit_stream_read_uint(stream, value_bits);
+        data[offset] = CONVERT_UINT32_TO_INT32(value);
+    }
 }
 
 #pragma endregion
@@ -225,160 +659,1149 @@ static uint32_t compute_optimal_rice_parameter(const signal* data, const uint16_
  * @return                  最適なパーティションパラメータ
  */
 static uint32_t compute_optimal_entropy_parameter(const signal* data, const uint16_t start, const uint16_t partition_size, uint32_t* partition_bits) {
-    bool is_blank_partition = true;
-    register uint16_t offset;
+    zigzag_stats stats;
+    uint32_t parameter;
+    uint32_t zero_run_bits;
+    uint32_t fixed_width_bits;
 
-    /* ブランクパーティション（すべての値がゼロであるパーティション）であるか判定する。*/
-    for (offset = 0; offset < partition_size; ++offset) {
-        if (data[offset + start] != 0) {
-            is_blank_partition = false;
-            break;
-        }
-    }
+    /* 値の合計・論理和・ゼロの個数を、1回の走査でまとめて求める */
+    simd_compute_zigzag_stats(&data[start], partition_size, &stats);
 
-    if (is_blank_partition) {
+    /* ブランクパーティション（すべての値がゼロであるパーティション）はパラメータのみで表現する */
+    if (stats.mask == 0) {
         *(partition_bits) = ENTROPY_PARAMETER_NEED_BITS;
         return ENTROPY_PARAMETER_BLANK_PARTITION;
     }
 
-    return compute_optimal_rice_parameter(data, start, partition_size, partition_bits);
+    parameter = compute_optimal_rice_parameter(data, start, partition_size, stats.sum, partition_bits);
+
+    /* 固定長で格納した方が少なければ、固定長とする（白色雑音に近い値や、クリップした信号の予測残差など） */
+    fixed_width_bits = ENTROPY_PARAMETER_NEED_BITS + ENTROPY_FIXED_WIDTH_NEED_BITS + (64 - COUNT_LEADING_ZEROS64(stats.mask)) * partition_size;
+    if (fixed_width_bits < *(partition_bits)) {
+        *(partition_bits) = fixed_width_bits;
+        parameter = ENTROPY_PARAMETER_FIXED_WIDTH_PARTITION;
+    }
+
+    /* ゼロが半数以上を占める場合に限り、ゼロ連続長符号のビット数を計算し、少なければそちらを選ぶ */
+    if (2 * stats.num_zeros >= partition_size) {
+        zero_run_bits = compute_zero_run_total_bits(data, start, partition_size);
+
+        if (zero_run_bits < *(partition_bits)) {
+            *(partition_bits) = zero_run_bits;
+            return ENTROPY_PARAMETER_ZERO_RUN_PARTITION;
+        }
+    }
+
+    return parameter;
 }
 
 /*!
- * @brief                           指定されたデータに対して最適となるパーティションパラメータ、および、それぞれのパーティションで使用すべきエントロピー符号化のパラメータを計算します。
+ * @brief                   値の合計のみから、パーティションをライス符号化した場合のビット数を概算します。
+ * @param sum               パーティションに含まれる値を符号なし整数に変換した値の合計
+ * @param partition_size    パーティションのサイズ
+ * @return                  パーティションのビット数の概算値（エントロピー符号化のパラメータの保存に要するビット数を含む）
+ * @note                    各値の商の合計を、合計値を右シフトした値で近似します。
+ */
+static uint32_t estimate_partition_bits(const uint64_t sum, const uint32_t partition_size) {
+    uint32_t parameter, trial, trial_max;
+    uint64_t bits, min_bits;
+
+    /* ブランクパーティションは、パラメータのみで表現される */
+    if (sum == 0) {
+        return ENTROPY_PARAMETER_NEED_BITS;
+    }
+
+    parameter = (sum >= partition_size) ? count_bits((uint32_t)(sum / partition_size)) - 1 : 0;
+    trial = (parameter > ENTROPY_RICE_PARAMETER_MIN) ? parameter - 1 : parameter;
+    trial_max = (parameter < ENTROPY_PARTITION_RICE_PARAMETER_MAX) ? parameter + 1 : ENTROPY_PARTITION_RICE_PARAMETER_MAX;
+    min_bits = UINT64_MAX;
+
+    for (; trial <= trial_max; ++trial) {
+        bits = (uint64_t)partition_size * (trial + 1) + RSHIFT(sum, trial);
+
+        if (bits < min_bits) {
+            min_bits = bits;
+        }
+    }
+
+    return (min_bits > U32_MAX - ENTROPY_PARAMETER_NEED_BITS) ? U32_MAX : (uint32_t)min_bits + ENTROPY_PARAMETER_NEED_BITS;
+}
+
+/*!
+ * @brief                   指定されたサイズのデータに対して使用可能な、最大のパーティションパラメータを求めます。
+ * @param data_size         データのサイズ
+ * @return                  すべてのパーティションが1個以上の値を含む、最大のパーティションパラメータ
+ */
+static inline uint32_t compute_max_partition_parameter(const uint16_t data_size) {
+    uint32_t partition_parameter = ENTROPY_PARTITION_PARAMETER_MIN;
+
+    while (partition_parameter < ENTROPY_PARTITION_PARAMETER_MAX && RSHIFT(data_size, partition_parameter + 1) > 0) {
+        ++partition_parameter;
+    }
+
+    return partition_parameter;
+}
+
+/*!
+ * @brief                           指定されたデータに対して、ビット数の概算値が最小となるパーティションパラメータを探索します。
  * @param *data                     データのポインタ
  * @param data_size                 データのサイズ
- * @param *entropy_parameters       [出力]各パーティションで使用すべきエントロピー符号化のパラメータを出力する領域のポインタ。ENTROPY_PARTITION_COUNT_MAX個の要素を格納できる必要があります。
- * @param *work                     作業領域のポインタ。ENTROPY_PARTITION_COUNT_MAX個の要素を格納できる必要があります。
- * @return                          指定されたデータに対して最適となるパーティションパラメータ
+ * @param *partition_sums           作業領域のポインタ。ENTROPY_PARTITION_COUNT_MAX個の要素を格納できる必要があります。
+ * @param *estimated_bits           [出力]求められたパーティションパラメータで符号化した場合の、サブブロック全体のビット数の概算値
+ * @return                          ビット数の概算値が最小となるパーティションパラメータ
+ * @note                            最も細かいパーティションごとの値の合計を一度だけ求め、隣り合うパーティションの合計を足し合わせることで、
+ *                                  データを再走査せずにすべてのパーティションパラメータのビット数を概算します。
+ *                                  パーティションの開始位置は (番号 * データのサイズ) >> パーティションパラメータ であり、
+ *                                  1段階細かいパーティション2つの境界は常にこの段階のパーティションの境界と一致するため、足し合わせた合計は正確です。
  */
-static uint32_t compute_optimal_partition_parameter(const signal* data, const uint16_t data_size, uint32_t* entropy_parameters, uint32_t* work) {
-    uint32_t partition_size;
+static uint32_t search_partition_parameter(const signal* data, const uint16_t data_size, uint64_t* partition_sums, uint32_t* estimated_bits) {
     uint32_t partition_index;
     uint32_t trial_pp;
+    uint32_t max_pp;
     uint32_t partition_count;
     uint32_t optimal_partition_parameter;
     uint32_t size, min_size;
-    uint16_t start;
-    uint32_t partition_bits;
+    uint32_t start, end;
+    zigzag_stats stats;
+
+    /* 最も細かいパーティションごとに、値を符号なし整数に変換した値の合計を求める */
+    max_pp = compute_max_partition_parameter(data_size);
+    partition_count = RESTORE_PARTITION_COUNT(max_pp);
+    for (partition_index = 0; partition_index < partition_count; ++partition_index) {
+        start = RESTORE_PARTITION_START(data_size, max_pp, partition_index);
+        end = RESTORE_PARTITION_START(data_size, max_pp, partition_index + 1);
+        simd_compute_zigzag_stats(&data[start], end - start, &stats);
+        partition_sums[partition_index] = stats.sum;
+    }
 
     min_size = U32_MAX;
-    optimal_partition_parameter = 0;
+    optimal_partition_parameter = max_pp;
 
-    for (trial_pp = ENTROPY_PARTITION_PARAMETER_MIN; trial_pp <= ENTROPY_PARTITION_PARAMETER_MAX; ++trial_pp) {
+    /* 細かいパーティションから順に、合計値のみからビット数を概算する */
+    for (trial_pp = max_pp + 1; trial_pp-- > ENTROPY_PARTITION_PARAMETER_MIN; ) {
         partition_count = RESTORE_PARTITION_COUNT(trial_pp);
-        partition_size = data_size / partition_count;
-        size = 0;
-
-        /* それぞれのパーティションにとって最適となるエントロピー符号化のパラメータを求め、作業領域に格納する */
-        for (partition_index = 0; partition_index < partition_count; ++partition_index) {
-            start = partition_size * partition_index;
 
-            /* このパーティションのエントロピー符号化のパラメータを作業領域に保存 */
-            work[partition_index] = compute_optimal_entropy_parameter(data, start, partition_size, &partition_bits);
-            
-            /* パーティションのサイズを加算 */
-            size += partition_bits;
+        /* 1段階細かいパーティションの合計値を、隣り合う2つずつ足し合わせる */
+        if (trial_pp < max_pp) {
+            for (partition_index = 0; partition_index < partition_count; ++partition_index) {
+                partition_sums[partition_index] = partition_sums[2 * partition_index] + partition_sums[2 * partition_index + 1];
+            }
         }
 
-        /* パーティションのサイズに、エントロピー符号化のパラメータを保存するために要するビット数を加算 */
-        size += ENTROPY_PARTITION_PARAMETER_NEED_BITS;
+        size = ENTROPY_PARTITION_PARAMETER_NEED_BITS;
+        for (partition_index = 0; partition_index < partition_count; ++partition_index) {
+            start = RESTORE_PARTITION_START(data_size, trial_pp, partition_index);
+            end = RESTORE_PARTITION_START(data_size, trial_pp, partition_index + 1);
+            size += estimate_partition_bits(partition_sums[partition_index], end - start);
+        }
 
-        /* すでに発見されたパーティションの最小サイズより、今回試したパラメータによる
-         * パーティションサイズのほうが小さければ、最小サイズを置き換え、作業領域に格納された、
-         * すべてのパーティションのエントロピー符号化のパラメータを、出力領域にコピーする。*/
         if (min_size > size) {
             min_size = size;
             optimal_partition_parameter = trial_pp;
-            memcpy(entropy_parameters, work, sizeof(uint32_t) * ENTROPY_PARTITION_COUNT_MAX);
         }
     }
 
+    *(estimated_bits) = min_size;
+
+    return optimal_partition_parameter;
+}
+
+/*!
+ * @brief                           指定されたデータに対して最適となるパーティションパラメータ、および、それぞれのパーティションで使用すべきエントロピー符号化のパラメータを計算します。
+ * @param *data                     データのポインタ
+ * @param data_size                 データのサイズ
+ * @param *entropy_parameters       [出力]各パーティションで使用すべきエントロピー符号化のパラメータを出力する領域のポインタ。ENTROPY_PARTITION_COUNT_MAX個の要素を格納できる必要があります。
+ * @param *partition_sums           作業領域のポインタ。ENTROPY_PARTITION_COUNT_MAX個の要素を格納できる必要があります。
+ * @return                          指定されたデータに対して最適となるパーティションパラメータ
+ * @note                            パーティションパラメータは概算値から選び、正確なビット数は選ばれたパーティションパラメータについてのみ計算します。
+ */
+static uint32_t compute_optimal_partition_parameter(const signal* data, const uint16_t data_size, uint32_t* entropy_parameters, uint64_t* partition_sums) {
+    uint32_t partition_index;
+    uint32_t partition_count;
+    uint32_t optimal_partition_parameter;
+    uint32_t start, end;
+    uint32_t partition_bits;
+    uint32_t estimated_bits;
+
+    optimal_partition_parameter = search_partition_parameter(data, data_size, partition_sums, &estimated_bits);
+
+    /* 選ばれたパーティションパラメータについて、各パーティションの正確なパラメータを求める */
+    partition_count = RESTORE_PARTITION_COUNT(optimal_partition_parameter);
+    for (partition_index = 0; partition_index < partition_count; ++partition_index) {
+        start = RESTORE_PARTITION_START(data_size, optimal_partition_parameter, partition_index);
+        end = RESTORE_PARTITION_START(data_size, optimal_partition_parameter, partition_index + 1);
+        entropy_parameters[partition_index] = compute_optimal_entropy_parameter(data, (uint16_t)start, (uint16_t)(end - start), &partition_bits);
+    }
+
     return optimal_partition_parameter;
 }
 
 /*!
  * @brief               指定されたビットストリームに、指定されたサブブロックをライス符号化して書き込みます。
- * @param *stream       ビットストリームのハンドル
+ * @param *coder        ブロック読み書きAPIのハンドル
  * @param *sub_block    サブブロックのハンドル
  * @param block_size    サブブロックのサンプル数
  */
-static void write_sub_block(bit_stream* stream, uint32_t* entropy_parameters, uint32_t* work, const neac_sub_block* sub_block) {
+static void write_sub_block(neac_code* coder, const neac_sub_block* sub_block) {
+    bit_stream* stream = coder->bitstream;
+    uint32_t* entropy_parameters = coder->entropy_parameters;
     uint32_t p, start;
     uint32_t parameter;
-    uint16_t partition_size;
+    uint16_t current_size;
     uint32_t partition_parameter;
     uint32_t partition_count;
 
     /* ライス符号化のパーティションパラメータを計算 */
-    partition_parameter = compute_optimal_partition_parameter(sub_block->samples, sub_block->size, entropy_parameters, work);
+    partition_parameter = compute_optimal_partition_parameter(sub_block->samples, sub_block->size, entropy_parameters, coder->partition_sums);
 
-    /* パーティションパラメータからパーティション数とパーティションのサイズを計算 */
+    /* パーティションパラメータからパーティション数を計算 */
     partition_count = RESTORE_PARTITION_COUNT(partition_parameter);
-    partition_size = sub_block->size / partition_count;
 
     /* パーティションパラメータを保存する */
     bit_stream_write_uint(stream, partition_parameter - ENTROPY_PARTITION_PARAMETER_MIN, ENTROPY_PARTITION_PARAMETER_NEED_BITS);
 
     /* サブブロックをエントロピー符号化して書き込む */
     for (p = 0; p < partition_count; ++p) {
-        start = partition_size * p;
+        start = RESTORE_PARTITION_START(sub_block->size, partition_parameter, p);
+        current_size = (uint16_t)(RESTORE_PARTITION_START(sub_block->size, partition_parameter, p + 1) - start);
         parameter = entropy_parameters[p];
 
         /* エントロピー符号化のパラメータを書き込む */
         bit_stream_write_uint(stream, (uint32_t)(parameter - ENTROPY_PARAMETER_MIN), ENTROPY_PARAMETER_NEED_BITS);
 
-        if (parameter >= ENTROPY_RICE_PARAMETER_MIN && parameter <= ENTROPY_RICE_PARAMETER_MAX) {
-            write_rice_values(stream, sub_block->samples, start, partition_size, parameter);
+        if (parameter >= ENTROPY_RICE_PARAMETER_MIN && parameter <= ENTROPY_PARTITION_RICE_PARAMETER_MAX) {
+            write_rice_values(coder, sub_block->samples, start, current_size, parameter);
+        }
+        else if (parameter == ENTROPY_PARAMETER_ZERO_RUN_PARTITION) {
+            write_zero_run_values(coder, sub_block->samples, start, current_size);
+        }
+        else if (parameter == ENTROPY_PARAMETER_FIXED_WIDTH_PARTITION) {
+            write_fixed_width_values(coder, sub_block->samples, start, current_size);
         }
     }
 }
 
 /*!
  * @brief               指定されたビットストリームから、ライス符号化されて書き込まれたサブブロックのデータを読み込み、指定されたサブブロックに格納します。
- * @param *stream       ビットストリームのハンドル
+ * @param *coder        ブロック読み書きAPIのハンドル
  * @param *sub_block    サブブロックのハンドル
- * @param block_size    サブブロックのサンプル数
  */
-static void read_sub_block(bit_stream* stream, neac_sub_block* sub_block) {
+static void read_sub_block(neac_code* coder, neac_sub_block* sub_block) {
+    bit_stream* stream = coder->bitstream;
+    const bool is_extended = coder->format_version >= NEAC_FORMAT_VERSION_EXTENDED;
+    const uint32_t rice_parameter_max = is_extended ? ENTROPY_PARTITION_RICE_PARAMETER_MAX : ENTROPY_RICE_PARAMETER_MAX;
     uint32_t parameter;
     uint16_t offset;
     uint32_t p, start;
     uint16_t partition_size;
+    uint16_t current_size;
     uint32_t partition_parameter;
     uint32_t partition_count;
 
     /* パーティションパラメータを取得 */
-    partition_parameter = bit_stream_read_uint(stream, ENTROPY_PARTITION_PARAMETER_NEED_BITS) + ENTROPY_PARTITION_PARAMETER_MIN;
+    if (is_extended) {
+        partition_parameter = bit_stream_read_uint(stream, ENTROPY_PARTITION_PARAMETER_NEED_BITS) + ENTROPY_PARTITION_PARAMETER_MIN;
+
+        if (partition_parameter > ENTROPY_PARTITION_PARAMETER_MAX || RSHIFT(sub_block->size, partition_parameter) == 0) {
+            report_error(NEAC_ERROR_RICE_CODING_INVALID_PARTITION_PARAMETER);
+            return;
+        }
+    }
+    else {
+        partition_parameter = bit_stream_read_uint(stream, ENTROPY_LEGACY_PARTITION_PARAMETER_NEED_BITS) + ENTROPY_LEGACY_PARTITION_PARAMETER_MIN;
+    }
 
     /* ライス符号化のパーティション数とパーティションサイズを計算 */
     partition_count = RESTORE_PARTITION_COUNT(partition_parameter);
-    partition_size = sub_block->size / partition_count;
+    partition_size = RSHIFT(sub_block->size, partition_parameter);
 
     /* エントロピー符号化された整数を読み込む */
     for (p = 0; p < partition_count; ++p) {
-        start = p * partition_size;
+        /* 拡張後のフォーマットでは、端数のサンプルは各パーティションに分散される */
+        if (is_extended) {
+            start = RESTORE_PARTITION_START(sub_block->size, partition_parameter, p);
+            current_size = (uint16_t)(RESTORE_PARTITION_START(sub_block->size, partition_parameter, p + 1) - start);
+        }
+        else {
+            start = p * partition_size;
+            current_size = partition_size;
+        }
 
         /* エントロピー符号化のパラメータを取得 */
         parameter = bit_stream_read_uint(stream, ENTROPY_PARAMETER_NEED_BITS) + ENTROPY_PARAMETER_MIN;
 
-        if (parameter >= ENTROPY_RICE_PARAMETER_MIN && parameter <= ENTROPY_RICE_PARAMETER_MAX) {
-            read_rice_values(stream, sub_block->samples, start, partition_size, parameter);
+        if (parameter >= ENTROPY_RICE_PARAMETER_MIN && parameter <= rice_parameter_max) {
+            read_rice_values(coder, sub_block->samples, start, current_size, parameter);
+        }
+        else if (parameter == ENTROPY_PARAMETER_ZERO_RUN_PARTITION && is_extended) {
+            read_zero_run_values(coder, sub_block->samples, start, current_size);
+        }
+        else if (parameter == ENTROPY_PARAMETER_FIXED_WIDTH_PARTITION && is_extended) {
+            read_fixed_width_values(coder, sub_block->samples, start, current_size);
         }
         else if (parameter == ENTROPY_PARAMETER_BLANK_PARTITION) {
-            for (offset = 0; offset < partition_size; ++offset) {
+            for (offset = 0; offset < current_size; ++offset) {
+                sub_block->samples[start + offset] = 0;
+            }
+        }
+        else {
+            /* このフォーマットでは使われないパラメータ。パーティションは0で埋めておく */
+            report_error(NEAC_ERROR_RICE_CODING_INVALID_PARAMETER);
+            for (offset = 0; offset < current_size; ++offset) {
                 sub_block->samples[start + offset] = 0;
             }
         }
     }
 }
 
+#pragma region 適応型ライス符号の実装
+
 /*!
- * @brief           ブロックを読み書きするAPIのハンドルを生成します。
- * @param *stream   ビットストリームのハンドル
- * @return          ブロック読み書きAPIのハンドル
+ * @brief           値の大きさの移動平均から、適応型ライス符号のパラメータを求めます。
+ * @param sum       値を符号なし整数に変換した値の、移動平均の2^ADAPTIVE_RICE_HISTORY_SHIFT倍
+ * @return          ライス符号化のパラメータ
+ */
+static inline uint32_t compute_adaptive_rice_parameter(const uint64_t sum) {
+    register uint64_t mean = RSHIFT(sum, ADAPTIVE_RICE_HISTORY_SHIFT);
+    register uint32_t parameter;
+
+    if (mean == 0) {
+        return ENTROPY_RICE_PARAMETER_MIN;
+    }
+
+    /* 平均の2を底とする対数の整数部をパラメータとする */
+    parameter = 63 - COUNT_LEADING_ZEROS64(mean);
+    return (parameter > ENTROPY_RICE_PARAMETER_MAX) ? ENTROPY_RICE_PARAMETER_MAX : parameter;
+}
+
+/*!
+ * @brief           適応型ライス符号の移動平均を、指定されたパラメータに対応する値で初期化します。
+ * @param parameter ライス符号化のパラメータ
+ * @return          移動平均の2^ADAPTIVE_RICE_HISTORY_SHIFT倍の初期値
+ */
+static inline uint64_t initialize_adaptive_rice_sum(const uint32_t parameter) {
+    return LSHIFT((uint64_t)1, parameter + ADAPTIVE_RICE_HISTORY_SHIFT);
+}
+
+/*!
+ * @brief           適応型ライス符号の移動平均を、符号化した値で更新します。
+ * @param sum       値を符号なし整数に変換した値の、移動平均の2^ADAPTIVE_RICE_HISTORY_SHIFT倍
+ * @param value     符号化した値
+ * @return          更新された移動平均の2^ADAPTIVE_RICE_HISTORY_SHIFT倍
+ */
+static inline uint64_t update_adaptive_rice_sum(const uint64_t sum, const int32_t value) {
+    return sum + CONVERT_INT32_TO_UINT32(value) - RSHIFT(sum, ADAPTIVE_RICE_HISTORY_SHIFT);
+}
+
+/*!
+ * @brief               指定されたビットストリームに、指定されたサブブロックを適応型ライス符号で書き込みます。
+ * @param *coder        ブロック読み書きAPIのハンドル
+ * @param *sub_block    サブブロックのハンドル
+ * @note                パラメータの初期値のみを書き込み、以降はサンプル毎に値の大きさの移動平均からパラメータを求めます。
+ */
+static void write_sub_block_adaptive(neac_code* coder, const neac_sub_block* sub_block) {
+    bit_stream* stream = coder->bitstream;
+    register uint32_t offset;
+    register uint32_t parameter;
+    register uint64_t sum = 0;
+    uint32_t initial_samples;
+    bool is_blank = true;
+
+    /* ブランクなサブブロック（すべての値がゼロであるサブブロック）であるか判定する。*/
+    for (offset = 0; offset < sub_block->size; ++offset) {
+        if (sub_block->samples[offset] != 0) {
+            is_blank = false;
+            break;
+        }
+    }
+
+    if (is_blank) {
+        bit_stream_write_uint(stream, ENTROPY_PARAMETER_BLANK_PARTITION - ENTROPY_PARAMETER_MIN, ENTROPY_PARAMETER_NEED_BITS);
+        return;
+    }
+
+    /* 先頭のサンプルの大きさの平均から、パラメータの初期値を求めて書き込む */
+    initial_samples = (sub_block->size < ADAPTIVE_RICE_INITIAL_SAMPLES) ? sub_block->size : ADAPTIVE_RICE_INITIAL_SAMPLES;
+    for (offset = 0; offset < initial_samples; ++offset) {
+        sum += CONVERT_INT32_TO_UINT32(sub_block->samples[offset]);
+    }
+    parameter = compute_adaptive_rice_parameter(LSHIFT(sum / initial_samples, ADAPTIVE_RICE_HISTORY_SHIFT));
+    bit_stream_write_uint(stream, parameter - ENTROPY_PARAMETER_MIN, ENTROPY_PARAMETER_NEED_BITS);
+
+    /* サンプル毎にパラメータを更新しながら書き込む */
+    sum = initialize_adaptive_rice_sum(parameter);
+    for (offset = 0; offset < sub_block->size; ++offset) {
+        parameter = compute_adaptive_rice_parameter(sum);
+        write_rice_code(stream, parameter, sub_block->samples[offset], true);
+        sum = update_adaptive_rice_sum(sum, sub_block->samples[offset]);
+    }
+}
+
+/*!
+ * @brief               指定されたビットストリームから、適応型ライス符号で書き込まれたサブブロックのデータを読み込み、指定されたサブブロックに格納します。
+ * @param *coder        ブロック読み書きAPIのハンドル
+ * @param *sub_block    サブブロックのハンドル
+ */
+static void read_sub_block_adaptive(neac_code* coder, neac_sub_block* sub_block) {
+    bit_stream* stream = coder->bitstream;
+    register uint32_t offset;
+    register uint32_t parameter;
+    register uint64_t sum;
+    register int32_t value;
+
+    /* パラメータの初期値を取得 */
+    parameter = bit_stream_read_uint(stream, ENTROPY_PARAMETER_NEED_BITS) + ENTROPY_PARAMETER_MIN;
+
+    if (parameter == ENTROPY_PARAMETER_BLANK_PARTITION) {
+        memset(sub_block->samples, 0, sizeof(signal) * sub_block->size);
+        return;
+    }
+
+    /* サンプル毎にパラメータを更新しながら読み込む */
+    sum = initialize_adaptive_rice_sum(parameter);
+    for (offset = 0; offset < sub_block->size; ++offset) {
+        parameter = compute_adaptive_rice_parameter(sum);
+        value = read_rice_code(coder, parameter);
+        sub_block->samples[offset] = value;
+        sum = update_adaptive_rice_sum(sum, value);
+    }
+}
+
+/*!
+ * @brief               サブブロックを適応型ライス符号で書き込んだ場合のビット数を数えます。
+ * @param *sub_block    予測残差が格納されたサブブロックのハンドル
+ * @return              ビット数（サブブロックのヘッダを除く）
+ * @note                write_sub_block_adaptiveと同じ手順でパラメータを更新し、符号語の長さを合計します。
+ */
+static uint32_t count_sub_block_bits_adaptive(const neac_sub_block* sub_block) {
+    register uint32_t offset;
+    register uint32_t parameter;
+    register uint32_t quotient;
+    register uint64_t sum = 0;
+    uint32_t initial_samples;
+    uint32_t bits = ENTROPY_PARAMETER_NEED_BITS;
+    bool is_blank = true;
+
+    for (offset = 0; offset < sub_block->size; ++offset) {
+        if (sub_block->samples[offset] != 0) {
+            is_blank = false;
+            break;
+        }
+    }
+
+    if (is_blank) {
+        return bits;
+    }
+
+    initial_samples = (sub_block->size < ADAPTIVE_RICE_INITIAL_SAMPLES) ? sub_block->size : ADAPTIVE_RICE_INITIAL_SAMPLES;
+    for (offset = 0; offset < initial_samples; ++offset) {
+        sum += CONVERT_INT32_TO_UINT32(sub_block->samples[offset]);
+    }
+    parameter = compute_adaptive_rice_parameter(LSHIFT(sum / initial_samples, ADAPTIVE_RICE_HISTORY_SHIFT));
+
+    sum = initialize_adaptive_rice_sum(parameter);
+    for (offset = 0; offset < sub_block->size; ++offset) {
+        parameter = compute_adaptive_rice_parameter(sum);
+        quotient = RSHIFT(CONVERT_INT32_TO_UINT32(sub_block->samples[offset]), parameter);
+        bits += (quotient >= RICE_ESCAPE_QUOTIENT) ? RICE_ESCAPE_QUOTIENT + RICE_ESCAPE_VALUE_BITS : quotient + 1 + parameter;
+        sum = update_adaptive_rice_sum(sum, sub_block->samples[offset]);
+    }
+
+    return bits;
+}
+
+#pragma endregion
+
+#pragma region レンジコーダによる符号化の実装
+
+/*!
+ * @brief           値の大きさの移動平均から、レンジコーダの文脈を求めます。
+ * @param sum       値を符号なし整数に変換した値の、移動平均の2^RANGE_CODER_HISTORY_SHIFT倍
+ * @return          文脈（移動平均の2^RANGE_CODER_HISTORY_SHIFT倍を、半オクターブ単位で量子化した値）
+ */
+static inline uint32_t compute_range_coder_context(const uint64_t sum) {
+    register uint32_t bits;
+    register uint32_t context;
+
+    if (sum <= 1) {
+        return (uint32_t)sum;
+    }
+
+    /* ビット数と、最上位ビットに続く1ビットで区切る */
+    bits = 64 - COUNT_LEADING_ZEROS64(sum);
+    context = LSHIFT(bits - 1, 1) + (uint32_t)(RSHIFT(sum, bits - 2) & 1);
+    return (context >= RANGE_CODER_CONTEXTS) ? RANGE_CODER_CONTEXTS - 1 : context;
+}
+
+/*!
+ * @brief           値の大きさの移動平均から、符号化する値のビット数を予測します。
+ * @param sum       値を符号なし整数に変換した値の、移動平均の2^RANGE_CODER_HISTORY_SHIFT倍
+ * @return          予測したビット数（移動平均の表現に必要なビット数）
+ */
+static inline uint32_t predict_range_coded_length(const uint64_t sum) {
+    register uint64_t mean = RSHIFT(sum, RANGE_CODER_HISTORY_SHIFT);
+
+    if (mean == 0) {
+        return 0;
+    }
+
+    return 64 - COUNT_LEADING_ZEROS64(mean);
+}
+
+/*!
+ * @brief           値の大きさの移動平均を、符号化した値で更新します。
+ * @param sum       値を符号なし整数に変換した値の、移動平均の2^RANGE_CODER_HISTORY_SHIFT倍
+ * @param value     符号化した値
+ * @return          更新された移動平均の2^RANGE_CODER_HISTORY_SHIFT倍
+ */
+static inline uint64_t update_magnitude_sum(const uint64_t sum, const int32_t value) {
+    return sum + CONVERT_INT32_TO_UINT32(value) - RSHIFT(sum, RANGE_CODER_HISTORY_SHIFT);
+}
+
+/*!
+ * @brief           ビット数と予測したビット数の差から、仮数部の確率の索引を求めます。
+ * @param length    値のビット数
+ * @param predicted 予測したビット数
+ * @return          仮数部の確率の索引
+ */
+static inline uint32_t compute_mantissa_offset(const uint32_t length, const uint32_t predicted) {
+    register int32_t offset = (int32_t)length - (int32_t)predicted;
+
+    if (offset < -RANGE_CODER_LENGTH_OFFSET_MAX) {
+        offset = -RANGE_CODER_LENGTH_OFFSET_MAX;
+    }
+    else if (offset > RANGE_CODER_LENGTH_OFFSET_MAX) {
+        offset = RANGE_CODER_LENGTH_OFFSET_MAX;
+    }
+
+    return (uint32_t)(offset + RANGE_CODER_LENGTH_OFFSET_MAX);
+}
+
+/*!
+ * @brief           1つの値を、レンジコーダで書き込みます。
+ * @param *coder    ブロック読み書きAPIのハンドル
+ * @param sum       値を符号なし整数に変換した値の、移動平均の2^RANGE_CODER_HISTORY_SHIFT倍
+ * @param value     書き込む値
+ * @note            値を符号なし整数に変換して1を加えた値を、最上位ビットを除いたビット数と残りのビット列に分けて符号化します。
+ *                  ビット数は移動平均から予測したビット数以上か否かで分け、以上なら予測したビット数から、未満なら予測より1少ないか否かを書いた後に0から数えたunary符号で書き込みます。
+ *                  残りのビット列は先頭のRANGE_CODER_MODELED_BITSビットのみ確率を用い、以降は等確率で符号化します。
+ */
+static inline void write_range_coded_value(neac_code* coder, const uint64_t sum, const int32_t value) {
+    range_coder* rc = coder->range_coder;
+    range_value_model* model = &coder->value_model;
+    const uint32_t context = compute_range_coder_context(sum);
+    const uint32_t predicted = predict_range_coded_length(sum);
+    range_coder_probability* probabilities;
+    register uint64_t magnitude = (uint64_t)CONVERT_INT32_TO_UINT32(value) + 1;
+    register uint32_t length = 63 - COUNT_LEADING_ZEROS64(magnitude);
+    register uint32_t modeled_bits;
+    register uint32_t node;
+    register uint32_t bit;
+    register uint32_t i;
+
+    if (predicted == 0 || length >= predicted) {
+        if (predicted > 0) {
+            range_coder_encode_bit(rc, &model->split_probabilities[context], 1);
+        }
+        probabilities = model->upper_length_probabilities[context];
+        for (i = predicted; i < length; ++i) {
+            range_coder_encode_bit(rc, &probabilities[i - predicted], 1);
+        }
+        if (length < RANGE_CODER_LENGTH_MAX) {
+            range_coder_encode_bit(rc, &probabilities[length - predicted], 0);
+        }
+    }
+    else {
+        range_coder_encode_bit(rc, &model->split_probabilities[context], 0);
+        /* 予測したビット数が1なら、ビット数は0に決まる */
+        if (predicted >= 2) {
+            range_coder_encode_bit(rc, &model->nearest_probabilities[context], (length == predicted - 1) ? 1 : 0);
+            if (length != predicted - 1) {
+                probabilities = model->lower_length_probabilities[context];
+                for (i = 0; i < length; ++i) {
+                    range_coder_encode_bit(rc, &probabilities[i], 1);
+                }
+                if (length < predicted - 2) {
+                    range_coder_encode_bit(rc, &probabilities[length], 0);
+                }
+            }
+        }
+    }
+
+    /* 最上位ビットに続く上位のビットは、既に符号化したビットを節点とする2分木の確率を用いる */
+    probabilities = model->mantissa_probabilities[context][compute_mantissa_offset(length, predicted)];
+    modeled_bits = (length < RANGE_CODER_MODELED_BITS) ? length : RANGE_CODER_MODELED_BITS;
+    node = 1;
+    for (i = 1; i <= modeled_bits; ++i) {
+        bit = (uint32_t)RSHIFT(magnitude, length - i) & 1;
+        range_coder_encode_bit(rc, &probabilities[node], bit);
+        node = LSHIFT(node, 1) | bit;
+    }
+
+    range_coder_encode_direct_bits(rc, (uint32_t)(magnitude & (LSHIFT((uint64_t)1, length - modeled_bits) - 1)), length - modeled_bits);
+}
+
+/*!
+ * @brief           レンジコーダで書き込まれた1つの値を読み込みます。
+ * @param *coder    ブロック読み書きAPIのハンドル
+ * @param sum       値を符号なし整数に変換した値の、移動平均の2^RANGE_CODER_HISTORY_SHIFT倍
+ * @return          読み込んだ値
+ */
+static inline int32_t read_range_coded_value(neac_code* coder, const uint64_t sum) {
+    range_coder* rc = coder->range_coder;
+    range_value_model* model = &coder->value_model;
+    const uint32_t context = compute_range_coder_context(sum);
+    const uint32_t predicted = predict_range_coded_length(sum);
+    range_coder_probability* probabilities;
+    register uint64_t magnitude;
+    register uint32_t length;
+    register uint32_t modeled_bits;
+    register uint32_t remainder;
+    register uint32_t i;
+
+    if (predicted == 0 || range_coder_decode_bit(rc, &model->split_probabilities[context]) != 0) {
+        probabilities = model->upper_length_probabilities[context];
+        length = predicted;
+        while (length < RANGE_CODER_LENGTH_MAX && range_coder_decode_bit(rc, &probabilities[length - predicted]) != 0) {
+            ++length;
+        }
+    }
+    else if (predicted < 2 || range_coder_decode_bit(rc, &model->nearest_probabilities[context]) != 0) {
+        length = predicted - 1;
+    }
+    else {
+        probabilities = model->lower_length_probabilities[context];
+        length = 0;
+        while (length < predicted - 2 && range_coder_decode_bit(rc, &probabilities[length]) != 0) {
+            ++length;
+        }
+    }
+
+    /* 2分木の節点は、それまでに読み込んだ上位のビット列そのものである */
+    probabilities = model->mantissa_probabilities[context][compute_mantissa_offset(length, predicted)];
+    modeled_bits = (length < RANGE_CODER_MODELED_BITS) ? length : RANGE_CODER_MODELED_BITS;
+    magnitude = 1;
+    for (i = 0; i < modeled_bits; ++i) {
+        magnitude = LSHIFT(magnitude, 1) | range_coder_decode_bit(rc, &probabilities[magnitude]);
+    }
+
+    magnitude = LSHIFT(magnitude, length - modeled_bits) | range_coder_decode_direct_bits(rc, length - modeled_bits);
+
+    remainder = (uint32_t)(magnitude - 1);
+    return CONVERT_UINT32_TO_INT32(remainder);
+}
+
+/*!
+ * @brief           1つの値をレンジコーダで書き込んだ場合の、符号長の見積もりを求めます。
+ * @param *coder    ブロック読み書きAPIのハンドル
+ * @param sum       値を符号なし整数に変換した値の、移動平均の2^RANGE_CODER_HISTORY_SHIFT倍
+ * @param value     書き込む値
+ * @return          符号長（1/2^RANGE_CODER_COST_FRACTION_BITSビット単位）
+ * @note            write_range_coded_valueと同じ2値化をたどり、見積もり用の確率のモデルを更新します。
+ */
+static inline uint32_t estimate_range_coded_value(neac_code* coder, const uint64_t sum, const int32_t value) {
+    const range_coder* rc = coder->range_coder;
+    range_value_model* model = &coder->trial_value_model;
+    const uint32_t context = compute_range_coder_context(sum);
+    const uint32_t predicted = predict_range_coded_length(sum);
+    range_coder_probability* probabilities;
+    register uint64_t magnitude = (uint64_t)CONVERT_INT32_TO_UINT32(value) + 1;
+    register uint32_t length = 63 - COUNT_LEADING_ZEROS64(magnitude);
+    register uint32_t modeled_bits;
+    register uint32_t node;
+    register uint32_t bit;
+    register uint32_t i;
+    uint32_t cost = 0;
+
+    if (predicted == 0 || length >= predicted) {
+        if (predicted > 0) {
+            cost += range_coder_estimate_bit(rc, &model->split_probabilities[context], 1);
+        }
+        probabilities = model->upper_length_probabilities[context];
+        for (i = predicted; i < length; ++i) {
+            cost += range_coder_estimate_bit(rc, &probabilities[i - predicted], 1);
+        }
+        if (length < RANGE_CODER_LENGTH_MAX) {
+            cost += range_coder_estimate_bit(rc, &probabilities[length - predicted], 0);
+        }
+    }
+    else {
+        cost += range_coder_estimate_bit(rc, &model->split_probabilities[context], 0);
+        if (predicted >= 2) {
+            cost += range_coder_estimate_bit(rc, &model->nearest_probabilities[context], (length == predicted - 1) ? 1 : 0);
+            if (length != predicted - 1) {
+                probabilities = model->lower_length_probabilities[context];
+                for (i = 0; i < length; ++i) {
+                    cost += range_coder_estimate_bit(rc, &probabilities[i], 1);
+                }
+                if (length < predicted - 2) {
+                    cost += range_coder_estimate_bit(rc, &probabilities[length], 0);
+                }
+            }
+        }
+    }
+
+    probabilities = model->mantissa_probabilities[context][compute_mantissa_offset(length, predicted)];
+    modeled_bits = (length < RANGE_CODER_MODELED_BITS) ? length : RANGE_CODER_MODELED_BITS;
+    node = 1;
+    for (i = 1; i <= modeled_bits; ++i) {
+        bit = (uint32_t)RSHIFT(magnitude, length - i) & 1;
+        cost += range_coder_estimate_bit(rc, &probabilities[node], bit);
+        node = LSHIFT(node, 1) | bit;
+    }
+
+    return cost + LSHIFT(length - modeled_bits, RANGE_CODER_COST_FRACTION_BITS);
+}
+
+/*!
+ * @brief               サブブロックをレンジコーダで書き込んだ場合のビット数を見積もります。
+ * @param *coder        ブロック読み書きAPIのハンドル
+ * @param *sub_block    予測残差が格納されたサブブロックのハンドル
+ * @return              見積もったビット数
+ * @note                確率はその時点のモデルの複製を更新しながら用い、チャンネル毎の移動平均の代わりに先頭のサンプルの大きさの平均を用います。
+ */
+static uint32_t estimate_sub_block_bits_range_coded(neac_code* coder, const neac_sub_block* sub_block) {
+    register uint32_t offset;
+    register uint64_t sum = 0;
+    uint32_t initial_samples;
+    uint64_t cost = 0;
+
+    initial_samples = (sub_block->size < LSHIFT(1, RANGE_CODER_HISTORY_SHIFT)) ? sub_block->size : LSHIFT(1, RANGE_CODER_HISTORY_SHIFT);
+    for (offset = 0; offset < initial_samples; ++offset) {
+        sum += CONVERT_INT32_TO_UINT32(sub_block->samples[offset]);
+    }
+    sum = LSHIFT(sum / initial_samples, RANGE_CODER_HISTORY_SHIFT);
+
+    memcpy(&coder->trial_value_model, &coder->value_model, sizeof(range_value_model));
+    for (offset = 0; offset < sub_block->size; ++offset) {
+        cost += estimate_range_coded_value(coder, sum, sub_block->samples[offset]);
+        sum = update_magnitude_sum(sum, sub_block->samples[offset]);
+    }
+
+    return (uint32_t)RSHIFT(cost + LSHIFT(1, RANGE_CODER_COST_FRACTION_BITS) - 1, RANGE_CODER_COST_FRACTION_BITS);
+}
+
+/*!
+ * @brief           指定されたブロックに、予測残差のサブブロックが含まれているか判定します。
+ * @param *block    ブロックのハンドル
+ * @return          予測残差のサブブロックが含まれていればtrue
+ */
+static inline bool has_predicted_sub_block(const neac_block* block) {
+    uint8_t ch;
+
+    for (ch = 0; ch < block->num_channels; ++ch) {
+        if (block->sub_blocks[ch]->type == SUB_BLOCK_TYPE_PREDICTED) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*!
+ * @brief           指定されたブロックを、レンジコーダで書き込みます。
+ * @param *coder    ブロック読み書きAPIのハンドル
+ * @param *block    書き込むブロックのハンドル
+ * @note            ブロック内の予測残差のサブブロック全体を1つの符号語とし、確率と値の大きさの移動平均はブロックをまたいで引き継ぎます。
+ */
+static void write_block_range_coded(neac_code* coder, const neac_block* block) {
+    range_coder* rc = coder->range_coder;
+    const neac_sub_block* sub_block;
+    register uint32_t offset;
+    register uint64_t sum;
+    bool is_blank;
+    uint8_t ch;
+
+    if (!has_predicted_sub_block(block)) {
+        return;
+    }
+
+    range_coder_start_encode(rc);
+
+    for (ch = 0; ch < block->num_channels; ++ch) {
+        sub_block = block->sub_blocks[ch];
+
+        if (sub_block->type != SUB_BLOCK_TYPE_PREDICTED) {
+            continue;
+        }
+
+        /* ブランクなサブブロック（すべての値がゼロであるサブブロック）であるか判定する。*/
+        is_blank = true;
+        for (offset = 0; offset < sub_block->size; ++offset) {
+            if (sub_block->samples[offset] != 0) {
+                is_blank = false;
+                break;
+            }
+        }
+
+        range_coder_encode_bit(rc, &coder->blank_probability, is_blank);
+        if (is_blank) {
+            continue;
+        }
+
+        sum = coder->magnitude_sums[ch];
+        for (offset = 0; offset < sub_block->size; ++offset) {
+            write_range_coded_value(coder, sum, sub_block->samples[offset]);
+            sum = update_magnitude_sum(sum, sub_block->samples[offset]);
+        }
+        coder->magnitude_sums[ch] = sum;
+    }
+
+    range_coder_finish_encode(rc);
+}
+
+/*!
+ * @brief           レンジコーダで書き込まれたブロックを読み込みます。
+ * @param *coder    ブロック読み書きAPIのハンドル
+ * @param *block    読み込んだデータを格納するブロックのハンドル
+ */
+static void read_block_range_coded(neac_code* coder, neac_block* block) {
+    range_coder* rc = coder->range_coder;
+    neac_sub_block* sub_block;
+    register uint32_t offset;
+    register uint64_t sum;
+    register int32_t value;
+    uint8_t ch;
+
+    if (!has_predicted_sub_block(block)) {
+        return;
+    }
+
+    range_coder_start_decode(rc);
+
+    for (ch = 0; ch < block->num_channels; ++ch) {
+        sub_block = block->sub_blocks[ch];
+
+        if (sub_block->type != SUB_BLOCK_TYPE_PREDICTED) {
+            continue;
+        }
+
+        if (range_coder_decode_bit(rc, &coder->blank_probability) != 0) {
+            memset(sub_block->samples, 0, sizeof(signal) * sub_block->size);
+            continue;
+        }
+
+        sum = coder->magnitude_sums[ch];
+        for (offset = 0; offset < sub_block->size; ++offset) {
+            value = read_range_coded_value(coder, sum);
+            sub_block->samples[offset] = value;
+            sum = update_magnitude_sum(sum, value);
+        }
+        coder->magnitude_sums[ch] = sum;
+    }
+}
+
+#pragma endregion
+
+#pragma region サブブロックの種類の実装
+
+/*!
+ * @brief               予測残差のサブブロックを、予測前の信号と比べて最もビット数が少なくなる種類のサブブロックに置き換えます。
+ * @param *coder        ブロック読み書きAPIのハンドル
+ * @param *sub_block    予測残差が格納されたサブブロックのハンドル
+ * @param *source       予測前の信号
+ */
+void neac_code_select_sub_block_type(neac_code* coder, neac_sub_block* sub_block, const signal* source) {
+    register uint16_t offset;
+    register uint32_t mask = 0;
+    uint32_t predicted_bits;
+    uint32_t verbatim_bits;
+    bool is_constant = true;
+
+    sub_block->type = SUB_BLOCK_TYPE_PREDICTED;
+
+    /* 種類を書き込まないフォーマットでは、予測残差のみを扱う */
+    if (coder->format_version < NEAC_FORMAT_VERSION_EXTENDED) {
+        return;
+    }
+
+    /* すべてのサンプルが同じ値であれば、その値のみを格納する */
+    for (offset = 1; offset < sub_block->size; ++offset) {
+        if (source[offset] != source[0]) {
+            is_constant = false;
+            break;
+        }
+    }
+
+    if (is_constant) {
+        sub_block->type = SUB_BLOCK_TYPE_CONSTANT;
+        sub_block->wasted_bits = 0;
+        sub_block->samples[0] = source[0];
+        return;
+    }
+
+    /* 予測残差を選択中のエントロピー符号化で書き込んだビット数が、予測前の信号をそのまま格納した場合以上であれば、予測前の信号を格納する。
+     * 下位のゼロのビットは、予測前の信号からも同じく取り除く。*/
+    if (coder->entropy_mode == ENTROPY_MODE_ADAPTIVE_RICE) {
+        predicted_bits = count_sub_block_bits_adaptive(sub_block);
+    }
+    else if (coder->entropy_mode == ENTROPY_MODE_RANGE_CODER) {
+        predicted_bits = estimate_sub_block_bits_range_coded(coder, sub_block);
+    }
+    else {
+        search_partition_parameter(sub_block->samples, sub_block->size, coder->partition_sums, &predicted_bits);
+    }
+    for (offset = 0; offset < sub_block->size; ++offset) {
+        mask |= CONVERT_INT32_TO_UINT32(RSHIFT(source[offset], sub_block->wasted_bits));
+    }
+    verbatim_bits = SUB_BLOCK_VALUE_BITS_NEED_BITS + ((mask == 0) ? 1 : 64 - COUNT_LEADING_ZEROS64(mask)) * sub_block->size;
+
+    if (verbatim_bits < predicted_bits) {
+        sub_block->type = SUB_BLOCK_TYPE_VERBATIM;
+        for (offset = 0; offset < sub_block->size; ++offset) {
+            sub_block->samples[offset] = RSHIFT(source[offset], sub_block->wasted_bits);
+        }
+    }
+}
+
+/*!
+ * @brief           予測残差をパーティション毎のライス符号で符号化した場合のビット数を見積もります。
+ * @param *coder    ブロック読み書きAPIのハンドル
+ * @param *data     予測残差
+ * @param size      予測残差のサンプル数
+ * @return          見積もったビット数
+ */
+uint32_t neac_code_estimate_bits(neac_code* coder, const signal* data, uint16_t size) {
+    uint32_t estimated_bits;
+
+    search_partition_parameter(data, size, coder->partition_sums, &estimated_bits);
+    return estimated_bits;
+}
+
+/*!
+ * @brief               サブブロックの線形予測の次数と、量子化された係数を書き込みます。
+ * @param *coder        ブロック読み書きAPIのハンドル
+ * @param *sub_block    サブブロックのハンドル
+ * @note                次数が0でなければ、シフト量と係数1個あたりのビット数に続けて、すべての係数を符号なし整数に変換して書き込みます。
+ */
+static void write_lpc_coefficients(neac_code* coder, const neac_sub_block* sub_block) {
+    bit_stream* stream = coder->bitstream;
+    register uint8_t i;
+    uint32_t coefficient_bits;
+
+    bit_stream_write_uint(stream, sub_block->lpc_order, coder->lpc_order_bits);
+
+    if (sub_block->lpc_order == 0) {
+        return;
+    }
+
+    coefficient_bits = compute_value_bits(sub_block->lpc_coefficients, sub_block->lpc_order);
+    bit_stream_write_uint(stream, sub_block->lpc_shift, LPC_SHIFT_NEED_BITS);
+    bit_stream_write_uint(stream, coefficient_bits - 1, LPC_COEFFICIENT_BITS_NEED_BITS);
+
+    for (i = 0; i < sub_block->lpc_order; ++i) {
+        bit_stream_write_uint(stream, CONVERT_INT32_TO_UINT32(sub_block->lpc_coefficients[i]), coefficient_bits);
+    }
+}
+
+/*!
+ * @brief               サブブロックの線形予測の次数と、量子化された係数を読み込みます。
+ * @param *coder        ブロック読み書きAPIのハンドル
+ * @param *sub_block    サブブロックのハンドル
+ */
+static void read_lpc_coefficients(neac_code* coder, neac_sub_block* sub_block) {
+    bit_stream* stream = coder->bitstream;
+    register uint8_t i;
+    register uint32_t value;
+    uint32_t coefficient_bits;
+
+    sub_block->lpc_order = (uint8_t)bit_stream_read_uint(stream, coder->lpc_order_bits);
+
+    if (sub_block->lpc_order == 0) {
+        return;
+    }
+
+    if (sub_block->lpc_order > LPC_MAX_ORDER) {
+        report_error(NEAC_ERROR_SUB_BLOCK_INVALID_LPC_ORDER);
+        sub_block->lpc_order = 0;
+        return;
+    }
+
+    sub_block->lpc_shift = (uint8_t)bit_stream_read_uint(stream, LPC_SHIFT_NEED_BITS);
+    coefficient_bits = bit_stream_read_uint(stream, LPC_COEFFICIENT_BITS_NEED_BITS) + 1;
+
+    for (i = 0; i < sub_block->lpc_order; ++i) {
+        value = bit_stream_read_uint(stream, coefficient_bits);
+        sub_block->lpc_coefficients[i] = CONVERT_UINT32_TO_INT32(value);
+    }
+}
+
+/*!
+ * @brief               サブブロックの多項式予測器の次数と、次数が0でなければ減衰の度合いの番号を書き込みます。
+ * @param *coder        ブロック読み書きAPIのハンドル
+ * @param *sub_block    サブブロックのハンドル
  */
-neac_code* neac_code_create(bit_stream* stream) {
+static void write_polynomial_parameters(neac_code* coder, const neac_sub_block* sub_block) {
+    bit_stream* stream = coder->bitstream;
+
+    bit_stream_write_uint(stream, sub_block->polynomial_order, POLYNOMIAL_PREDICTOR_ORDER_NEED_BITS);
+    if (sub_block->polynomial_order > 0) {
+        bit_stream_write_uint(stream, sub_block->polynomial_leak, POLYNOMIAL_PREDICTOR_LEAK_NEED_BITS);
+    }
+}
+
+/*!
+ * @brief               サブブロックの多項式予測器の次数と、減衰の度合いの番号を読み込みます。
+ * @param *coder        ブロック読み書きAPIのハンドル
+ * @param *sub_block    サブブロックのハンドル
+ */
+static void read_polynomial_parameters(neac_code* coder, neac_sub_block* sub_block) {
+    bit_stream* stream = coder->bitstream;
+
+    sub_block->polynomial_order = (uint8_t)bit_stream_read_uint(stream, POLYNOMIAL_PREDICTOR_ORDER_NEED_BITS);
+    sub_block->polynomial_leak = 0;
+
+    if (sub_block->polynomial_order > POLYNOMIAL_PREDICTOR_MAX_ORDER) {
+        report_error(NEAC_ERROR_SUB_BLOCK_INVALID_POLYNOMIAL_ORDER);
+        sub_block->polynomial_order = POLYNOMIAL_PREDICTOR_DEFAULT_ORDER;
+        sub_block->polynomial_leak = POLYNOMIAL_PREDICTOR_DEFAULT_LEAK;
+        return;
+    }
+
+    if (sub_block->polynomial_order > 0) {
+        sub_block->polynomial_leak = (uint8_t)bit_stream_read_uint(stream, POLYNOMIAL_PREDICTOR_LEAK_NEED_BITS);
+    }
+}
+
+/*!
+ * @brief               サブブロックの種類と、予測残差以外のサブブロックのデータを書き込みます。
+ * @param *coder        ブロック読み書きAPIのハンドル
+ * @param *sub_block    サブブロックのハンドル
+ * @note                無圧縮のサブブロックは、すべての値を符号なし整数に変換し、必要なビット数の固定長で書き込みます。
+ */
+static void write_sub_block_header(neac_code* coder, const neac_sub_block* sub_block) {
+    bit_stream* stream = coder->bitstream;
+    register uint16_t offset;
+    uint32_t value_bits;
+
+    if (coder->format_version < NEAC_FORMAT_VERSION_EXTENDED) {
+        return;
+    }
+
+    bit_stream_write_uint(stream, sub_block->type, SUB_BLOCK_TYPE_NEED_BITS);
+
+    /* 定数以外のサブブロックは、取り除いた下位のゼロのビット数を、ゼロでない場合のみ書き込む */
+    if (sub_block->type != SUB_BLOCK_TYPE_CONSTANT) {
+        bit_stream_write_bit(stream, sub_block->wasted_bits > 0);
+        if (sub_block->wasted_bits > 0) {
+            bit_stream_write_uint(stream, sub_block->wasted_bits - 1, SUB_BLOCK_WASTED_BITS_NEED_BITS);
+        }
+    }
+
+    /* 予測器の状態はサブブロックの種類によらず更新されるため、線形予測の係数はすべてのサブブロックで書き込む */
+    if (coder->lpc_order_bits > 0) {
+        write_lpc_coefficients(coder, sub_block);
+    }
+
+    /* 多項式予測器の次数は予測残差を格納するサブブロックのみで書き込み、それ以外は既定の組み合わせで予測器の状態を更新する。
+     * 線形予測を用いるサブブロックでは、多項式予測器は過去サンプルを引き継ぐのみのため、次数を書き込まない */
+    if (sub_block->type == SUB_BLOCK_TYPE_PREDICTED && sub_block->lpc_order == 0) {
+        write_polynomial_parameters(coder, sub_block);
+    }
+
+    if (sub_block->type == SUB_BLOCK_TYPE_PREDICTED) {
+        return;
+    }
+
+    /* 定数のサブブロックは、先頭の1サンプルのみを書き込む */
+    value_bits = compute_value_bits(sub_block->samples, (sub_block->type == SUB_BLOCK_TYPE_CONSTANT) ? 1 : sub_block->size);
+    bit_stream_write_uint(stream, value_bits - 1, SUB_BLOCK_VALUE_BITS_NEED_BITS);
+
+    if (sub_block->type == SUB_BLOCK_TYPE_CONSTANT) {
+        bit_stream_write_uint(stream, CONVERT_INT32_TO_UINT32(sub_block->samples[0]), value_bits);
+        return;
+    }
+
+    for (offset = 0; offset < sub_block->size; ++offset) {
+        bit_stream_write_uint(stream, CONVERT_INT32_TO_UINT32(sub_block->samples[offset]), value_bits);
+    }
+}
+
+/*!
+ * @brief               サブブロックの種類と、予測残差以外のサブブロックのデータを読み込みます。
+ * @param *coder        ブロック読み書きAPIのハンドル
+ * @param *sub_block    サブブロックのハンドル
+ */
+static void read_sub_block_header(neac_code* coder, neac_sub_block* sub_block) {
+    bit_stream* stream = coder->bitstream;
+    register uint16_t offset;
+    register uint32_t value;
+    uint32_t value_bits;
+
+    /* 種類が書き込まれていないフォーマットでは、すべて予測残差 */
+    if (coder->format_version < NEAC_FORMAT_VERSION_EXTENDED) {
+        sub_block->type = SUB_BLOCK_TYPE_PREDICTED;
+        sub_block->wasted_bits = 0;
+        sub_block->polynomial_order = POLYNOMIAL_PREDICTOR_DEFAULT_ORDER;
+        sub_block->polynomial_leak = POLYNOMIAL_PREDICTOR_DEFAULT_LEAK;
+        sub_block->lpc_order = 0;
+        return;
+    }
+
+    sub_block->type = (uint8_t)bit_stream_read_uint(stream, SUB_BLOCK_TYPE_NEED_BITS);
+
+    sub_block->wasted_bits = 0;
+    if (sub_block->type != SUB_BLOCK_TYPE_CONSTANT) {
+        if (bit_stream_read_bit(stream)) {
+            sub_block->wasted_bits = (uint8_t)(bit_stream_read_uint(stream, SUB_BLOCK_WASTED_BITS_NEED_BITS) + 1);
+        }
+    }
+
+    sub_block->lpc_order = 0;
+    if (coder->lpc_order_bits > 0) {
+        read_lpc_coefficients(coder, sub_block);
+    }
+
+    sub_block->polynomial_order = POLYNOMIAL_PREDICTOR_DEFAULT_ORDER;
+    sub_block->polynomial_leak = POLYNOMIAL_PREDICTOR_DEFAULT_LEAK;
+    if (sub_block->type == SUB_BLOCK_TYPE_PREDICTED && sub_block->lpc_order == 0) {
+        read_polynomial_parameters(coder, sub_block);
+    }
+
+    if (sub_block->type == SUB_BLOCK_TYPE_PREDICTED) {
+        return;
+    }
+
+    if (sub_block->type > SUB_BLOCK_TYPE_MAX) {
+        report_error(NEAC_ERROR_SUB_BLOCK_INVALID_TYPE);
+        sub_block->type = SUB_BLOCK_TYPE_CONSTANT;
+        memset(sub_block->samples, 0, sizeof(signal) * sub_block->size);
+        return;
+    }
+
+    value_bits = bit_stream_read_uint(stream, SUB_BLOCK_VALUE_BITS_NEED_BITS) + 1;
+
+    if (sub_block->type == SUB_BLOCK_TYPE_CONSTANT) {
+        value = bit_stream_read_uint(stream, value_bits);
+
+        if (value == 0) {
+            memset(sub_block->samples, 0, sizeof(signal) * sub_block->size);
+            return;
+        }
+
+        for (offset = 0; offset < sub_block->size; ++offset) {
+            sub_block->samples[offset] = CONVERT_UINT32_TO_INT32(value);
+        }
+        return;
+    }
+
+    for (offset = 0; offset < sub_block->size; ++offset) {
+        value = bit_stream_read_uint(stream, value_bits);
+        sub_block->samples[offset] = CONVERT_UINT32_TO_INT32(value);
+    }
+}
+
+#pragma endregion
+
+/*!
+ * @brief                   ブロックを読み書きするAPIのハンドルを生成します。
+ * @param *stream           ビットストリームのハンドル
+ * @param format_version    読み書きするデータのフォーマットのバージョン
+ * @param entropy_mode      エントロピー符号化の方式
+ * @param max_lpc_order     サブブロック毎の線形予測の最大次数（線形予測を使用しない場合は0）
+ * @return                  ブロック読み書きAPIのハンドル
+ */
+neac_code* neac_code_create(bit_stream* stream, uint8_t format_version, uint8_t entropy_mode, uint8_t max_lpc_order) {
     neac_code* result = (neac_code*)malloc(sizeof(neac_code));
 
     if (result == NULL) {
@@ -386,8 +1809,18 @@ neac_code* neac_code_create(bit_stream* stream) {
     }
 
     result->bitstream = stream;
-    result->workA = (uint32_t*)calloc(ENTROPY_PARTITION_COUNT_MAX, sizeof(uint32_t));
-    result->workB = (uint32_t*)calloc(ENTROPY_PARTITION_COUNT_MAX, sizeof(uint32_t));
+    result->format_version = format_version;
+    result->entropy_mode = entropy_mode;
+    result->lpc_order_bits = (max_lpc_order == 0) ? 0 : (uint8_t)count_bits(max_lpc_order);
+    result->entropy_parameters = (uint32_t*)calloc(ENTROPY_PARTITION_COUNT_MAX, sizeof(uint32_t));
+    result->partition_sums = (uint64_t*)calloc(ENTROPY_PARTITION_COUNT_MAX, sizeof(uint64_t));
+    result->range_coder = range_coder_create(stream);
+    result->magnitude_sums = (uint64_t*)calloc(RANGE_CODER_CHANNELS_MAX, sizeof(uint64_t));
+
+    /* ライス符号の復号テーブルは、最初のハンドルの生成時にすべてのパラメータについて生成する */
+    initialize_rice_decode_tables();
+
+    neac_code_clear(result);
 
     return result;
 }
@@ -397,8 +1830,27 @@ neac_code* neac_code_create(bit_stream* stream) {
  * @param *coder    ブロック読み書きAPIのハンドル
  */
 void neac_code_free(neac_code* coder) {
-    free(coder->workA);
-    free(coder->workB);
+    free(coder->entropy_parameters);
+    free(coder->partition_sums);
+    free(coder->magnitude_sums);
+    range_coder_free(coder->range_coder);
+}
+
+/*!
+ * @brief           ブロックを読み書きするAPIの、ブロック間で引き継がれる状態を初期化します。
+ * @param *coder    ブロック読み書きAPIのハンドル
+ */
+void neac_code_clear(neac_code* coder) {
+    if (coder->magnitude_sums != NULL) {
+        memset(coder->magnitude_sums, 0, sizeof(uint64_t) * RANGE_CODER_CHANNELS_MAX);
+    }
+
+    range_coder_init_probabilities(&coder->blank_probability, 1);
+    range_coder_init_probabilities(&coder->value_model.split_probabilities[0], RANGE_CODER_CONTEXTS);
+    range_coder_init_probabilities(&coder->value_model.upper_length_probabilities[0][0], RANGE_CODER_CONTEXTS * RANGE_CODER_LENGTH_MAX);
+    range_coder_init_probabilities(&coder->value_model.nearest_probabilities[0], RANGE_CODER_CONTEXTS);
+    range_coder_init_probabilities(&coder->value_model.lower_length_probabilities[0][0], RANGE_CODER_CONTEXTS * RANGE_CODER_LENGTH_MAX);
+    range_coder_init_probabilities(&coder->value_model.mantissa_probabilities[0][0][0], RANGE_CODER_CONTEXTS * (2 * RANGE_CODER_LENGTH_OFFSET_MAX + 1) * LSHIFT(1, RANGE_CODER_MODELED_BITS));
 }
 
 /*!
@@ -410,7 +1862,23 @@ void neac_code_write_block(neac_code* coder, neac_block* block) {
     uint8_t ch;
 
     for (ch = 0; ch < block->num_channels; ++ch) {
-        write_sub_block(coder->bitstream, coder->workA, coder->workB, block->sub_blocks[ch]);
+        write_sub_block_header(coder, block->sub_blocks[ch]);
+
+        /* レンジコーダでは、予測残差のサブブロックをブロックの最後にまとめて符号化する */
+        if (block->sub_blocks[ch]->type != SUB_BLOCK_TYPE_PREDICTED || coder->entropy_mode == ENTROPY_MODE_RANGE_CODER) {
+            continue;
+        }
+
+        if (coder->entropy_mode == ENTROPY_MODE_ADAPTIVE_RICE) {
+            write_sub_block_adaptive(coder, block->sub_blocks[ch]);
+        }
+        else {
+            write_sub_block(coder, block->sub_blocks[ch]);
+        }
+    }
+
+    if (coder->entropy_mode == ENTROPY_MODE_RANGE_CODER) {
+        write_block_range_coded(coder, block);
     }
 }
 
@@ -423,6 +1891,22 @@ void neac_code_read_block(neac_code* coder, neac_block* block) {
     uint8_t ch;
 
     for (ch = 0; ch < block->num_channels; ++ch) {
-        read_sub_block(coder->bitstream, block->sub_blocks[ch]);
+        read_sub_block_header(coder, block->sub_blocks[ch]);
+
+        /* レンジコーダでは、予測残差のサブブロックをブロックの最後にまとめて符号化する */
+        if (block->sub_blocks[ch]->type != SUB_BLOCK_TYPE_PREDICTED || coder->entropy_mode == ENTROPY_MODE_RANGE_CODER) {
+            continue;
+        }
+
+        if (coder->entropy_mode == ENTROPY_MODE_ADAPTIVE_RICE) {
+            read_sub_block_adaptive(coder, block->sub_blocks[ch]);
+        }
+        else {
+            read_sub_block(coder, block->sub_blocks[ch]);
+        }
+    }
+
+    if (coder->entropy_mode == ENTROPY_MODE_RANGE_CODER) {
+        read_block_range_coded(coder, block);
     }
 }
\ No newline at end of file
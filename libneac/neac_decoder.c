@@ -1,10 +1,12 @@
 #include "./include/file_access.h"
 #include "./include/macro.h"
+#include "./include/neac.h"
 #include "./include/neac_decoder.h"
 #include "./include/neac_error.h"
 #include "./include/neac_sub_block.h"
+#include <string.h>
 
-const static uint8_t supported_format_versions[1] = { 0x01 };
+const static uint8_t supported_format_versions[3] = { 0x01, 0x02, 0x03 };
 
 #pragma region データ読み込み
 
@@ -31,12 +33,14 @@ static bool is_supported_version(uint8_t version) {
  * @param *decoder  デコーダのハンドル
  */
 static void read_header(neac_decoder* decoder) {
-    if (read_uint8(decoder->file) == 0x94 && 
-        read_uint8(decoder->file) == 0x4C &&
-        read_uint8(decoder->file) == 0x89 &&
-        read_uint8(decoder->file) == 0xB9){
+    uint8_t stage;
+
+    if (read_uint8(decoder->bit_stream) == 0x94 && 
+        read_uint8(decoder->bit_stream) == 0x4C &&
+        read_uint8(decoder->bit_stream) == 0x89 &&
+        read_uint8(decoder->bit_stream) == 0xB9){
         /* フォーマットバージョンを読み込む */
-        decoder->format_version = read_uint8(decoder->file);
+        decoder->format_version = read_uint8(decoder->bit_stream);
 
         if (!is_supported_version(decoder->format_version)) {
             report_error(NEAC_ERROR_DECODER_UNSUPPORTED_FORMAT_VERSION);
@@ -44,19 +48,64 @@ static void read_header(neac_decoder* decoder) {
         }
 
         /* PCMフォーマット情報を読み込む */
-        decoder->sample_rate = read_uint32(decoder->file);
-        decoder->bits_per_sample = read_uint8(decoder->file);
-        decoder->num_channels = read_uint8(decoder->file);
-        decoder->num_total_samples = read_uint32(decoder->file);
+        decoder->sample_rate = read_uint32(decoder->bit_stream);
+        decoder->bits_per_sample = read_uint8(decoder->bit_stream);
+        decoder->num_channels = read_uint8(decoder->bit_stream);
+        decoder->num_total_samples = read_uint32(decoder->bit_stream);
 
         /* NEACエンコード情報を読み込む */
-        decoder->filter_taps = read_uint8(decoder->file);
-        decoder->block_size = read_uint16(decoder->file);
-        decoder->use_mid_side_stereo = read_bool(decoder->file);
-        decoder->num_blocks = read_uint32(decoder->file);
+        decoder->filter_taps = read_uint8(decoder->bit_stream);
+        decoder->block_size = read_uint16(decoder->bit_stream);
+        decoder->use_mid_side_stereo = read_bool(decoder->bit_stream);
+        decoder->num_blocks = read_uint32(decoder->bit_stream);
+
+        /* 拡張後のフォーマットの設定を読み込む（拡張前のフォーマットでは、パーティション毎のライス符号・多段のLMSフィルタなし・SSLMS・線形予測なし） */
+        decoder->entropy_mode = ENTROPY_MODE_PARTITIONED_RICE;
+        decoder->num_cascade_stages = 0;
+        decoder->lms_mode = LMS_MODE_SIGN_SIGN;
+        decoder->lpc_order = 0;
+        if (decoder->format_version >= NEAC_FORMAT_VERSION_EXTENDED) {
+            /* エントロピー符号化の方式 */
+            decoder->entropy_mode = read_uint8(decoder->bit_stream);
+            if (decoder->entropy_mode > ENTROPY_MODE_MAX) {
+                report_error(NEAC_ERROR_DECODER_UNSUPPORTED_ENTROPY_MODE);
+                return;
+            }
+
+            /* 多段のLMSフィルタの各段のタップ数とシフト係数 */
+            decoder->num_cascade_stages = read_uint8(decoder->bit_stream);
+            if (decoder->num_cascade_stages > LMS_CASCADE_MAX_STAGES) {
+                report_error(NEAC_ERROR_DECODER_INVALID_LMS_CASCADE);
+                return;
+            }
+
+            for (stage = 0; stage < decoder->num_cascade_stages; ++stage) {
+                decoder->cascade_taps[stage] = read_uint16(decoder->bit_stream);
+                decoder->cascade_shifts[stage] = read_uint8(decoder->bit_stream);
+
+                if (decoder->cascade_taps[stage] == 0 || decoder->cascade_taps[stage] > LMS_CASCADE_MAX_TAPS || decoder->cascade_shifts[stage] > LMS_MAX_SHIFT) {
+                    report_error(NEAC_ERROR_DECODER_INVALID_LMS_CASCADE);
+                    return;
+                }
+            }
+
+            /* LMSフィルタの更新方式 */
+            decoder->lms_mode = read_uint8(decoder->bit_stream);
+            if (decoder->lms_mode > LMS_MODE_MAX) {
+                report_error(NEAC_ERROR_DECODER_UNSUPPORTED_LMS_MODE);
+                return;
+            }
+
+            /* サブブロック毎の線形予測の最大次数 */
+            decoder->lpc_order = read_uint8(decoder->bit_stream);
+            if (decoder->lpc_order > LPC_MAX_ORDER) {
+                report_error(NEAC_ERROR_DECODER_INVALID_LPC_ORDER);
+                return;
+            }
+        }
 
         /* タグ情報を読み込む */
-        neac_tag_read(decoder->file, &decoder->tag);
+        neac_tag_read(decoder->bit_stream, &decoder->tag);
     }
     else {
         /* マジックナンバーが不正な値である旨のエラーをレポートする */
@@ -96,37 +145,145 @@ static inline void ms_to_lr_conversion(neac_block* block) {
     }
 }
 
+/*!
+ * @brief           指定されたチャンネルの多段のLMSフィルタのうち、指定された段のハンドルを返します。
+ * @param *decoder  デコーダのハンドル
+ * @param ch        チャンネル
+ * @param stage     段
+ * @return          LMSフィルタのハンドル
+ */
+static inline lms* get_cascade_filter(neac_decoder* decoder, uint8_t ch, uint8_t stage) {
+    return decoder->cascade_filters[ch * decoder->num_cascade_stages + stage];
+}
+
+/*!
+ * @brief           エンコーダと同じく、サブブロックの予測器で信号を予測し、予測残差に置き換えます。予測器の状態は更新されます。
+ * @param *decoder  デコーダのハンドル
+ * @param *sb       サブブロックのハンドル
+ * @param *data     [入出力]サブブロックの信号。予測残差で上書きされます。
+ */
+static void predict_sub_block(neac_decoder* decoder, const neac_sub_block* sb, signal* data) {
+    uint8_t ch = sb->channel;
+    uint8_t stage;
+    signal history[POLYNOMIAL_PREDICATOR_MAX_HISTORY];
+
+    if (sb->lpc_order > 0) {
+        lpc_encode_block(decoder->lpc_predictors[ch], sb->lpc_coefficients, sb->lpc_order, sb->lpc_shift, data, sb->size);
+        lpc_get_history(decoder->lpc_predictors[ch], history, POLYNOMIAL_PREDICATOR_MAX_HISTORY);
+        polynomial_predictor_set_history(decoder->polynomial_predictors[ch], history);
+    }
+    else {
+        lpc_update_block(decoder->lpc_predictors[ch], data, sb->size);
+
+        if (decoder->num_cascade_stages == 0) {
+            lms_encode_block(decoder->lms_filters[ch], decoder->polynomial_predictors[ch], data, sb->size);
+            return;
+        }
+
+        polynomial_predictor_encode_block(decoder->polynomial_predictors[ch], data, sb->size);
+    }
+
+    for (stage = 0; stage < decoder->num_cascade_stages; ++stage) {
+        lms_encode_stage(get_cascade_filter(decoder, ch, stage), data, sb->size);
+    }
+    lms_encode_stage(decoder->lms_filters[ch], data, sb->size);
+}
+
 /*!
  * @brief           指定されたデコーダで読み込み済みのブロックのデコードを行います。
  * @param *decoder  デコーダのハンドル
  */
 static void decode_current_block(neac_decoder* decoder) {
-    uint8_t ch;
+    uint8_t ch, stage;
     neac_sub_block* sb = NULL;
     lms* lms = NULL;
     polynomial_predictor* poly = NULL;
+    lpc* lpc = NULL;
     register uint16_t offset;
     register signal residual;
     register signal sample;
+    signal poly_prediction, lms_prediction, total_prediction;
+    signal cascade_predictions[LMS_CASCADE_MAX_STAGES];
+    signal history[POLYNOMIAL_PREDICATOR_MAX_HISTORY];
 
     for (ch = 0; ch < decoder->num_channels; ++ch) {
         sb = decoder->current_block->sub_blocks[ch];
         lms = decoder->lms_filters[ch];
         poly = decoder->polynomial_predictors[ch];
+        lpc = decoder->lpc_predictors[ch];
+
+        /* 多項式予測器の次数と減衰の度合いは、サブブロックの種類によらず予測の前に切り替える */
+        polynomial_predictor_set_parameters(poly, sb->polynomial_order, sb->polynomial_leak);
+
+        /* 予測残差以外のサブブロックは信号そのものなので、エンコーダと同じく予測器の更新のみを行う */
+        if (sb->type != SUB_BLOCK_TYPE_PREDICTED) {
+            for (offset = 0; offset < sb->size; ++offset) {
+                sb->samples[offset] = LSHIFT(sb->samples[offset], sb->wasted_bits);
+            }
+
+            memcpy(decoder->work_samples, sb->samples, sizeof(signal) * sb->size);
+            predict_sub_block(decoder, sb, decoder->work_samples);
+            continue;
+        }
 
-        for (offset = 0; offset < sb->size; ++offset) {
-            /* STEP 1. SSLMSフィルタを適用し、多項式予測器の予測残差を復元 */
-            residual = sb->samples[offset];
-            sample = residual + lms_predict(lms);
-            lms_update(lms, sample, residual);
+        /* 下位のビットが削られている場合、予測値の合計も同じだけ右シフトして加算し、左シフトで元の信号を復元する。
+         * 線形予測を用いるサブブロックでは、多項式予測器の予測値の代わりに線形予測器の予測値を用いる */
+        if (sb->wasted_bits > 0) {
+            for (offset = 0; offset < sb->size; ++offset) {
+                poly_prediction = (sb->lpc_order > 0) ? lpc_predict(lpc, sb->lpc_coefficients, sb->lpc_order, sb->lpc_shift) : polynomial_predictor_predict(poly);
+                lms_prediction = lms_predict(lms);
+                total_prediction = poly_prediction + lms_prediction;
+                for (stage = 0; stage < decoder->num_cascade_stages; ++stage) {
+                    cascade_predictions[stage] = lms_predict(get_cascade_filter(decoder, ch, stage));
+                    total_prediction += cascade_predictions[stage];
+                }
+                sample = LSHIFT(sb->samples[offset] + RSHIFT(total_prediction, sb->wasted_bits), sb->wasted_bits);
+
+                /* 各段の入力は、前段の入力から前段の予測値を引いた値となる */
+                residual = sample - poly_prediction;
+                for (stage = 0; stage < decoder->num_cascade_stages; ++stage) {
+                    lms_update(get_cascade_filter(decoder, ch, stage), residual, residual - cascade_predictions[stage]);
+                    residual -= cascade_predictions[stage];
+                }
+                lms_update(lms, residual, residual - lms_prediction);
+                polynomial_predictor_update(poly, sample);
+                lpc_update(lpc, sample);
+
+                sb->samples[offset] = sample;
+            }
+            continue;
+        }
 
-            /* STEP 2. 多項式予測器で予測された信号に予測残差を加算し、元の信号を復元*/
-            sample += polynomial_predictor_predict(poly);
-            polynomial_predictor_update(poly, sample);
+        /* 線形予測を用いるサブブロックは、各段のLMSフィルタを適用した後、線形予測器で元の信号を復元する */
+        if (sb->lpc_order > 0) {
+            lms_decode_stage(lms, sb->samples, sb->size);
+            for (stage = decoder->num_cascade_stages; stage > 0; --stage) {
+                lms_decode_stage(get_cascade_filter(decoder, ch, stage - 1), sb->samples, sb->size);
+            }
+            lpc_decode_block(lpc, sb->lpc_coefficients, sb->lpc_order, sb->lpc_shift, sb->samples, sb->size);
+            lpc_get_history(lpc, history, POLYNOMIAL_PREDICATOR_MAX_HISTORY);
+            polynomial_predictor_set_history(poly, history);
+            continue;
+        }
 
-            /* STEP 3. 復元された信号をサブブロックに格納 */
-            sb->samples[offset] = sample;
+        /* 多段のLMSフィルタがない場合は、
+         * STEP 1. LMSフィルタを適用し、多項式予測器の予測残差を復元
+         * STEP 2. 多項式予測器で予測された信号に予測残差を加算し、元の信号を復元
+         * STEP 3. 復元された信号をサブブロックに格納
+         * 以上をサブブロック単位でまとめて処理し、予測器の状態はその間ローカル変数に保持する */
+        if (decoder->num_cascade_stages == 0) {
+            lms_decode_block(lms, poly, sb->samples, sb->size);
+            lpc_update_block(lpc, sb->samples, sb->size);
+            continue;
         }
+
+        /* 多段のLMSフィルタがある場合は、エンコーダと逆の順に各段を適用する */
+        lms_decode_stage(lms, sb->samples, sb->size);
+        for (stage = decoder->num_cascade_stages; stage > 0; --stage) {
+            lms_decode_stage(get_cascade_filter(decoder, ch, stage - 1), sb->samples, sb->size);
+        }
+        polynomial_predictor_decode_block(poly, sb->samples, sb->size);
+        lpc_update_block(lpc, sb->samples, sb->size);
     }
 
     /* STEP 4. ミッドサイドステレオに変換されていれば、シンプルステレオに戻す */
@@ -138,32 +295,27 @@ static void decode_current_block(neac_decoder* decoder) {
 #pragma endregion
 
 /*!
- * @brief           指定されたデコーダを、指定されたパスのファイルをデコードできるように初期化します。
+ * @brief           指定されたデコーダを、指定されたビットストリームのデータをデコードできるように初期化します。
  * @param *decoder  デコーダのハンドル
- * @param *path     ファイルのパス
+ * @param *file     デコードするファイルのハンドル。メモリ上のデータをデコードする場合はNULL
+ * @param *stream   デコードするデータを読み込むビットストリームのハンドル
  */
-static void neac_decoder_init(neac_decoder* decoder, const char* path) {
-    uint8_t ch;
-    errno_t err;
-
-    /* ファイルを開く */
-    err = fopen_s(&decoder->file, path, "rb");
-
-    /* ファイルを開けなかった場合、エラーを報告して何もしない */
-    if (err != 0) {
-        report_error(NEAC_ERROR_DECODER_FAILED_TO_OPEN_FILE);
-        return;
-    }
+static void neac_decoder_init(neac_decoder* decoder, FILE* file, bit_stream* stream) {
+    uint8_t ch, stage;
 
     /* ビットストリームの初期化 */
-    decoder->bit_stream = bit_stream_create(decoder->file, BIT_STREAM_MODE_READ);
+    decoder->file = file;
+    decoder->bit_stream = stream;
 
     /* ヘッダ部を読み込む */
     read_header(decoder);
 
     decoder->lms_filters = (lms**)malloc(sizeof(lms*) * decoder->num_channels);
     decoder->polynomial_predictors = (polynomial_predictor**)malloc(sizeof(polynomial_predictor*) * decoder->num_channels);
-    decoder->coder = neac_code_create(decoder->bit_stream);
+    decoder->cascade_filters = (lms**)malloc(sizeof(lms*) * decoder->num_channels * LMS_CASCADE_MAX_STAGES);
+    decoder->lpc_predictors = (lpc**)malloc(sizeof(lpc*) * decoder->num_channels);
+    decoder->work_samples = (signal*)calloc(decoder->block_size, sizeof(signal));
+    decoder->coder = neac_code_create(decoder->bit_stream, decoder->format_version, decoder->entropy_mode, decoder->lpc_order);
     decoder->current_block = (neac_block*)malloc(sizeof(neac_block));
     decoder->current_read_sub_block_channel = 0;
     decoder->current_read_sub_block_offset = 0;
@@ -174,10 +326,14 @@ static void neac_decoder_init(neac_decoder* decoder, const char* path) {
     neac_block_init(decoder->current_block, decoder->block_size, decoder->num_channels);
 
     /* 領域の確保に成功していれば、初期化を行う */
-    if (decoder->lms_filters != NULL && decoder->polynomial_predictors != NULL && decoder->current_block != NULL) {
+    if (decoder->lms_filters != NULL && decoder->polynomial_predictors != NULL && decoder->cascade_filters != NULL && decoder->lpc_predictors != NULL && decoder->work_samples != NULL && decoder->current_block != NULL) {
         for (ch = 0; ch < decoder->num_channels; ++ch) {
-            decoder->lms_filters[ch] = lms_create(decoder->filter_taps, decoder->bits_per_sample);
+            decoder->lms_filters[ch] = lms_create(decoder->filter_taps, decoder->lms_mode, decoder->bits_per_sample);
             decoder->polynomial_predictors[ch] = polynomial_predictor_create();
+            decoder->lpc_predictors[ch] = lpc_create();
+            for (stage = 0; stage < decoder->num_cascade_stages; ++stage) {
+                decoder->cascade_filters[ch * decoder->num_cascade_stages + stage] = lms_create_with_shift(decoder->cascade_taps[stage], decoder->lms_mode, decoder->cascade_shifts[stage]);
+            }
         }
     }
     else {
@@ -191,6 +347,38 @@ static void neac_decoder_init(neac_decoder* decoder, const char* path) {
  * @return      デコーダのハンドル
  */
 neac_decoder* neac_decoder_create(const char* path) {
+    neac_decoder* result;
+    FILE* file;
+    errno_t err;
+
+    /* ファイルを開く */
+    err = fopen_s(&file, path, "rb");
+
+    /* ファイルを開けなかった場合、エラーを報告して何もしない */
+    if (err != 0) {
+        report_error(NEAC_ERROR_DECODER_FAILED_TO_OPEN_FILE);
+        return NULL;
+    }
+
+    result = (neac_decoder*)malloc(sizeof(neac_decoder));
+
+    if (result == NULL) {
+        report_error(NEAC_ERROR_DECODER_CANNOT_ALLOCATE_MEMORY);
+        fclose(file);
+        return NULL;
+    }
+
+    neac_decoder_init(result, file, bit_stream_create(file, BIT_STREAM_MODE_READ));
+    return result;
+}
+
+/*!
+ * @brief       メモリ上のデータをデコードするデコーダのハンドルを生成します。データはコピーされません。
+ * @param *data デコードするデータのポインタ。デコーダを解放するまで有効である必要があります。
+ * @param size  デコードするデータのバイト数
+ * @return      デコーダのハンドル
+ */
+neac_decoder* neac_decoder_create_from_memory(const uint8_t* data, size_t size) {
     neac_decoder* result = (neac_decoder*)malloc(sizeof(neac_decoder));
 
     if (result == NULL) {
@@ -198,7 +386,7 @@ neac_decoder* neac_decoder_create(const char* path) {
         return NULL;
     }
 
-    neac_decoder_init(result, path);
+    neac_decoder_init(result, NULL, bit_stream_create_memory_reader(data, size));
     return result;
 }
 
@@ -208,17 +396,29 @@ neac_decoder* neac_decoder_create(const char* path) {
  */
 void neac_decoder_free(neac_decoder* decoder) {
     uint8_t ch;
+    uint16_t stage;
 
+    bit_stream_free(decoder->bit_stream);
     free(decoder->bit_stream);
 
     /* 各チャンネル用のフィルタを解放 */
     for (ch = 0; ch < decoder->num_channels; ++ch) {
         lms_free(decoder->lms_filters[ch]);
         polynomial_predictor_free(decoder->polynomial_predictors[ch]);
+        lpc_free(decoder->lpc_predictors[ch]);
+        free(decoder->lpc_predictors[ch]);
+    }
+    for (stage = 0; stage < decoder->num_cascade_stages * decoder->num_channels; ++stage) {
+        lms_free(decoder->cascade_filters[stage]);
+        free(decoder->cascade_filters[stage]);
     }
     free(decoder->lms_filters);
     free(decoder->polynomial_predictors);
+    free(decoder->cascade_filters);
+    free(decoder->lpc_predictors);
+    free(decoder->work_samples);
 
+    neac_code_free(decoder->coder);
     free(decoder->coder);
     free(decoder->current_block);
 }
@@ -229,7 +429,10 @@ void neac_decoder_free(neac_decoder* decoder) {
  */
 void neac_decoder_close(neac_decoder* decoder) {
     neac_tag_free(decoder->tag);
-    fclose(decoder->file);
+
+    if (decoder->file != NULL) {
+        fclose(decoder->file);
+    }
 }
 
 /*!
@@ -284,6 +487,7 @@ int32_t neac_decoder_read_sample(neac_decoder* decoder) {
  */
 void neac_decoder_seek_sample_to(neac_decoder* decoder, uint32_t sample_offset) {
     uint8_t ch;
+    uint16_t stage;
     uint32_t offset;
 
     /* シーク中フラグを立てる */
@@ -291,8 +495,7 @@ void neac_decoder_seek_sample_to(neac_decoder* decoder, uint32_t sample_offset)
 
     /* 後方シーク（再生位置を過去に戻す）の場合、ファイルの最初からデコードをやり直す。*/
     if (sample_offset < decoder->num_samples_read) {
-        rewind(decoder->file);
-        bit_stream_init(decoder->bit_stream);
+        bit_stream_rewind(decoder->bit_stream);
 
         /* ヘッダ部を読み込む */
         read_header(decoder);
@@ -303,11 +506,18 @@ void neac_decoder_seek_sample_to(neac_decoder* decoder, uint32_t sample_offset)
         decoder->num_samples_read = 0;
 
         /* 領域の確保に成功していれば、初期化を行う */
-        if (decoder->lms_filters != NULL && decoder->polynomial_predictors != NULL) {
+        if (decoder->lms_filters != NULL && decoder->polynomial_predictors != NULL && decoder->lpc_predictors != NULL) {
             for (ch = 0; ch < decoder->num_channels; ++ch) {
                 lms_clear(decoder->lms_filters[ch]);
                 polynomial_predictor_clear(decoder->polynomial_predictors[ch]);
+                lpc_clear(decoder->lpc_predictors[ch]);
             }
+            for (stage = 0; stage < decoder->num_cascade_stages * decoder->num_channels; ++stage) {
+                lms_clear(decoder->cascade_filters[stage]);
+            }
+        }
+        if (decoder->coder != NULL) {
+            neac_code_clear(decoder->coder);
         }
         offset = 0;
     }
@@ -5,7 +5,18 @@
 #include "./include/neac_error.h"
 #include "./include/neac_sub_block.h"
 #include "./include/signal.h"
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
+
+#define LMS_CASCADE_EXTRA_SHIFT     3   /* 多段のLMSフィルタの段に、SSLMSのシフト係数から加えるシフト量 */
+#define NLMS_CASCADE_EXTRA_SHIFT    2   /* 多段のLMSフィルタの段に、NLMSフィルタのステップのシフト量から加えるシフト量 */
+#define LPC_MIN_COEFFICIENT_PRECISION   12  /* 線形予測の係数を量子化する際の、符号を含むビット数の最小値 */
+#define LPC_PRECISION_BLOCK_SIZE        256 /* 係数のビット数を最小値から1ビット増やす、サブブロックのサンプル数の単位 */
+
+/* 追加の設定の size に、指定されたメンバが含まれるかどうか */
+#define HAS_OPTION(options, member) \
+    ((options) != NULL && (options)->size >= offsetof(neac_encoder_options, member) + sizeof((options)->member))
 
 #pragma region データの書き込み
 
@@ -14,29 +25,45 @@
  * @param *encoder  エンコーダのハンドル
  */
 static void write_header(neac_encoder* encoder) {
+    uint8_t stage;
+
     /* マジックナンバーを書き込む。 */
-    write_uint8(encoder->output_file, 0x94);
-    write_uint8(encoder->output_file, 0x4C);
-    write_uint8(encoder->output_file, 0x89);
-    write_uint8(encoder->output_file, 0xB9);
+    write_uint8(encoder->output_bit_stream, 0x94);
+    write_uint8(encoder->output_bit_stream, 0x4C);
+    write_uint8(encoder->output_bit_stream, 0x89);
+    write_uint8(encoder->output_bit_stream, 0xB9);
 
     /* フォーマットのバージョンを書き込む。 */
-    write_uint8(encoder->output_file, NEAC_ENCODER_FORMAT_VERSION);
+    write_uint8(encoder->output_bit_stream, NEAC_ENCODER_FORMAT_VERSION);
 
     /* PCMフォーマット情報を書き込む。 */
-    write_uint32(encoder->output_file, encoder->sample_rate);
-    write_uint8(encoder->output_file, encoder->bits_per_sample);
-    write_uint8(encoder->output_file, encoder->num_channels);
-    write_uint32(encoder->output_file, encoder->num_samples);
+    write_uint32(encoder->output_bit_stream, encoder->sample_rate);
+    write_uint8(encoder->output_bit_stream, encoder->bits_per_sample);
+    write_uint8(encoder->output_bit_stream, encoder->num_channels);
+    write_uint32(encoder->output_bit_stream, encoder->num_samples);
 
     /* NEACエンコード情報 */
-    write_uint8(encoder->output_file, encoder->filter_taps);
-    write_uint16(encoder->output_file, encoder->block_size);
-    write_bool(encoder->output_file, encoder->use_mid_side_stereo);
-    write_uint32(encoder->output_file, encoder->num_blocks);
+    write_uint8(encoder->output_bit_stream, encoder->filter_taps);
+    write_uint16(encoder->output_bit_stream, encoder->block_size);
+    write_bool(encoder->output_bit_stream, encoder->use_mid_side_stereo);
+    write_uint32(encoder->output_bit_stream, encoder->num_blocks);
+    write_uint8(encoder->output_bit_stream, encoder->entropy_mode);
+
+    /* 多段のLMSフィルタの各段のタップ数とシフト係数を書き込む */
+    write_uint8(encoder->output_bit_stream, encoder->num_cascade_stages);
+    for (stage = 0; stage < encoder->num_cascade_stages; ++stage) {
+        write_uint16(encoder->output_bit_stream, encoder->cascade_taps[stage]);
+        write_uint8(encoder->output_bit_stream, encoder->cascade_shifts[stage]);
+    }
+
+    /* LMSフィルタの更新方式を書き込む */
+    write_uint8(encoder->output_bit_stream, encoder->lms_mode);
+
+    /* サブブロック毎の線形予測の最大次数を書き込む */
+    write_uint8(encoder->output_bit_stream, encoder->lpc_order);
 
     /* タグ情報を書き込む */
-    neac_tag_write(encoder->output_file, encoder->tag);
+    neac_tag_write(encoder->output_bit_stream, encoder->tag);
 }
 
 #pragma endregion
@@ -71,6 +98,222 @@ static inline void lr_to_ms_conversion(neac_block* block) {
     }
 }
 
+/*!
+ * @brief               指定された信号のすべてのサンプルに共通する、下位のゼロのビット数を求めます。
+ * @param *samples      信号
+ * @param size          信号のサンプル数
+ * @return              下位のゼロのビット数（すべてのサンプルがゼロの場合はゼロ）
+ */
+static uint8_t compute_wasted_bits(const signal* samples, uint16_t size) {
+    register uint32_t mask = 0;
+    register uint16_t offset;
+    uint8_t wasted_bits = 0;
+
+    for (offset = 0; offset < size; ++offset) {
+        mask |= (uint32_t)samples[offset];
+    }
+
+    if (mask == 0) {
+        return 0;
+    }
+
+    while ((mask & 1) == 0 && wasted_bits < SUB_BLOCK_WASTED_BITS_MAX) {
+        mask = RSHIFT(mask, 1);
+        ++wasted_bits;
+    }
+
+    return wasted_bits;
+}
+
+/*!
+ * @brief           サブブロックの信号に適した多項式予測器の次数と減衰の度合いを選びます。
+ * @param *encoder  エンコーダのハンドル
+ * @param *sb       予測前の信号が格納されたサブブロックのハンドル
+ * @return          選ばれた次数と減衰の度合いでの予測残差の絶対値の合計
+ */
+static uint64_t select_polynomial_predictor(neac_encoder* encoder, neac_sub_block* sb) {
+    return polynomial_predictor_select_parameters(encoder->polynomial_predictors[sb->channel], sb->samples, sb->size, &sb->polynomial_order, &sb->polynomial_leak);
+}
+
+/*!
+ * @brief                   サブブロックの信号から線形予測の係数を求め、多項式予測器より予測残差が小さくなる場合に限り使用します。
+ * @param *encoder          エンコーダのハンドル
+ * @param *sb               予測前の信号が格納されたサブブロックのハンドル
+ * @param polynomial_sum    選ばれた多項式予測器の予測残差の絶対値の合計
+ * @note                    予測残差の絶対値の合計が係数の符号量を上回って減る場合のみ、線形予測を選びます。
+ */
+static void select_lpc(neac_encoder* encoder, neac_sub_block* sb, uint64_t polynomial_sum) {
+    uint8_t order, shift;
+    uint8_t precision = LPC_MIN_COEFFICIENT_PRECISION;
+    uint32_t size;
+    uint64_t lpc_sum;
+    uint32_t coefficient_bits;
+
+    sb->lpc_order = 0;
+
+    if (encoder->lpc_order == 0) {
+        return;
+    }
+
+    /* サンプル数が多いほど係数の符号量の割合は小さくなるため、サンプル数が2倍になる毎に係数を1ビット細かく量子化する */
+    for (size = LPC_PRECISION_BLOCK_SIZE; size <= sb->size && precision < LPC_MAX_COEFFICIENT_PRECISION; size = LSHIFT(size, 1)) {
+        ++precision;
+    }
+
+    order = lpc_compute_coefficients(sb->samples, sb->size, encoder->lpc_order, precision, encoder->lpc_work, sb->lpc_coefficients, &shift);
+    if (order == 0) {
+        return;
+    }
+
+    lpc_sum = lpc_compute_residual_sum(encoder->lpc_predictors[sb->channel], sb->lpc_coefficients, order, shift, sb->samples, sb->size);
+
+    /* ラプラス分布に従う予測残差の符号量は、サンプル数と平均絶対値の対数の積に近い。
+     * 係数の符号量の分だけ、線形予測の予測残差の合計をサンプル1個あたりの割合として割り増して比べる */
+    coefficient_bits = LPC_SHIFT_NEED_BITS + LPC_COEFFICIENT_BITS_NEED_BITS + (uint32_t)order * precision;
+    if (lpc_sum * (sb->size + coefficient_bits) < polynomial_sum * sb->size) {
+        sb->lpc_order = order;
+        sb->lpc_shift = shift;
+    }
+}
+
+/*!
+ * @brief                   多段のLMSフィルタ（長いものから順）、最後のLMSフィルタの順に適用し、予測残差に置き換えます。
+ * @param *encoder          エンコーダのハンドル
+ * @param **cascade_filters 段毎の多段のLMSフィルタのハンドル
+ * @param *filter           最後のLMSフィルタのハンドル
+ * @param *data             [入出力]信号。予測残差で上書きされます。
+ * @param size              信号のサンプル数
+ */
+static void encode_lms_stages(neac_encoder* encoder, lms** cascade_filters, lms* filter, signal* data, uint16_t size) {
+    uint8_t stage;
+
+    for (stage = 0; stage < encoder->num_cascade_stages; ++stage) {
+        lms_encode_stage(cascade_filters[stage], data, size);
+    }
+    lms_encode_stage(filter, data, size);
+}
+
+/*!
+ * @brief                   指定された次数と減衰の度合いの多項式予測器と、LMSフィルタで信号を予測し、予測残差に置き換えます。
+ * @param *encoder          エンコーダのハンドル
+ * @param *poly             多項式予測器のハンドル
+ * @param **cascade_filters 段毎の多段のLMSフィルタのハンドル
+ * @param *filter           最後のLMSフィルタのハンドル
+ * @param order             多項式予測器の次数
+ * @param leak              多項式予測器の減衰の度合いの番号
+ * @param *data             [入出力]信号。予測残差で上書きされます。
+ * @param size              信号のサンプル数
+ */
+static void encode_polynomial(neac_encoder* encoder, polynomial_predictor* poly, lms** cascade_filters, lms* filter, uint8_t order, uint8_t leak, signal* data, uint16_t size) {
+    polynomial_predictor_set_parameters(poly, order, leak);
+
+    /* 多段のLMSフィルタがなければ、多項式予測器と最後のLMSフィルタをまとめて処理する */
+    if (encoder->num_cascade_stages == 0) {
+        lms_encode_block(filter, poly, data, size);
+        return;
+    }
+
+    polynomial_predictor_encode_block(poly, data, size);
+    encode_lms_stages(encoder, cascade_filters, filter, data, size);
+}
+
+/*!
+ * @brief           チャンネルの多項式予測器とLMSフィルタを、既定の次数と減衰の度合いを試すための複製と入れ替えます。
+ * @param *encoder  エンコーダのハンドル
+ * @param ch        チャンネル
+ */
+static void swap_trial_predictors(neac_encoder* encoder, uint8_t ch) {
+    polynomial_predictor* poly = encoder->polynomial_predictors[ch];
+    lms* filter = encoder->lms_filters[ch];
+    lms* cascade_filter;
+    uint8_t stage;
+
+    encoder->polynomial_predictors[ch] = encoder->trial_polynomial_predictor;
+    encoder->trial_polynomial_predictor = poly;
+    encoder->lms_filters[ch] = encoder->trial_lms_filter;
+    encoder->trial_lms_filter = filter;
+
+    for (stage = 0; stage < encoder->num_cascade_stages; ++stage) {
+        cascade_filter = encoder->cascade_filters[ch * encoder->num_cascade_stages + stage];
+        encoder->cascade_filters[ch * encoder->num_cascade_stages + stage] = encoder->trial_cascade_filters[stage];
+        encoder->trial_cascade_filters[stage] = cascade_filter;
+    }
+}
+
+/*!
+ * @brief           複製した予測器で、複製した信号を既定の次数と減衰の度合いで予測し、予測残差に置き換えます。
+ * @param *encoder  エンコーダのハンドル
+ * @param *sb       サブブロックのハンドル
+ */
+static void encode_default_trial(neac_encoder* encoder, const neac_sub_block* sb) {
+    encode_polynomial(encoder, encoder->trial_polynomial_predictor, encoder->trial_cascade_filters, encoder->trial_lms_filter,
+        POLYNOMIAL_PREDICTOR_DEFAULT_ORDER, POLYNOMIAL_PREDICTOR_DEFAULT_LEAK, encoder->trial_samples, sb->size);
+}
+
+/*!
+ * @brief           サブブロックの予測器で信号を予測し、予測残差に置き換えます。予測器の状態は更新されます。
+ * @param *encoder  エンコーダのハンドル
+ * @param *sb       線形予測の係数と多項式予測器の次数が設定されたサブブロックのハンドル
+ * @param *data     [入出力]サブブロックの信号。予測残差で上書きされます。
+ * @return          複製した予測器で、既定の次数と減衰の度合いを試したかどうか
+ * @note            多項式予測器の次数と減衰の度合いが既定の組み合わせでなければ、予測器と信号を複製しておきます。
+ *                  前のサブブロックと異なる組み合わせに切り替える場合は、複製で既定の組み合わせも試し、
+ *                  見積もったビット数が小さくならなければ既定の組み合わせに戻します。
+ */
+static bool predict_sub_block(neac_encoder* encoder, neac_sub_block* sb, signal* data) {
+    uint8_t ch = sb->channel;
+    uint8_t stage;
+    uint8_t previous_order, previous_leak;
+    lms** cascade_filters = &encoder->cascade_filters[ch * encoder->num_cascade_stages];
+    signal history[POLYNOMIAL_PREDICATOR_MAX_HISTORY];
+
+    if (sb->lpc_order > 0) {
+        /* 線形予測器を多項式予測器の代わりに用い、多項式予測器には過去サンプルのみを引き継ぐ */
+        lpc_encode_block(encoder->lpc_predictors[ch], sb->lpc_coefficients, sb->lpc_order, sb->lpc_shift, data, sb->size);
+        lpc_get_history(encoder->lpc_predictors[ch], history, POLYNOMIAL_PREDICATOR_MAX_HISTORY);
+        polynomial_predictor_set_history(encoder->polynomial_predictors[ch], history);
+        encode_lms_stages(encoder, cascade_filters, encoder->lms_filters[ch], data, sb->size);
+        return false;
+    }
+
+    lpc_update_block(encoder->lpc_predictors[ch], data, sb->size);
+
+    if (sb->polynomial_order == POLYNOMIAL_PREDICTOR_DEFAULT_ORDER && sb->polynomial_leak == POLYNOMIAL_PREDICTOR_DEFAULT_LEAK) {
+        encode_polynomial(encoder, encoder->polynomial_predictors[ch], cascade_filters, encoder->lms_filters[ch],
+            sb->polynomial_order, sb->polynomial_leak, data, sb->size);
+        return false;
+    }
+
+    previous_order = encoder->polynomial_predictors[ch]->order;
+    previous_leak = encoder->polynomial_predictors[ch]->leak;
+
+    /* 多項式予測器だけで見た予測残差の減少は、後段のLMSフィルタを通した後も残るとは限らないため、既定の組み合わせと比べる */
+    polynomial_predictor_copy(encoder->trial_polynomial_predictor, encoder->polynomial_predictors[ch]);
+    lms_copy(encoder->trial_lms_filter, encoder->lms_filters[ch]);
+    for (stage = 0; stage < encoder->num_cascade_stages; ++stage) {
+        lms_copy(encoder->trial_cascade_filters[stage], cascade_filters[stage]);
+    }
+    memcpy(encoder->trial_samples, data, sizeof(signal) * sb->size);
+
+    encode_polynomial(encoder, encoder->polynomial_predictors[ch], cascade_filters, encoder->lms_filters[ch],
+        sb->polynomial_order, sb->polynomial_leak, data, sb->size);
+
+    /* 前のサブブロックから続く組み合わせには予測器が適応済みのため、切り替えた時点でのみ比べる */
+    if (sb->polynomial_order == previous_order && sb->polynomial_leak == previous_leak) {
+        return false;
+    }
+
+    encode_default_trial(encoder, sb);
+
+    if (neac_code_estimate_bits(encoder->coder, encoder->trial_samples, sb->size) <= neac_code_estimate_bits(encoder->coder, data, sb->size)) {
+        swap_trial_predictors(encoder, ch);
+        memcpy(data, encoder->trial_samples, sizeof(signal) * sb->size);
+        sb->polynomial_order = POLYNOMIAL_PREDICTOR_DEFAULT_ORDER;
+        sb->polynomial_leak = POLYNOMIAL_PREDICTOR_DEFAULT_LEAK;
+    }
+    return true;
+}
+
 /*!
  * @brief           指定されたハンドルのエンコーダで読み込まれたブロックのエンコードを行います。
  * @param *encoder  エンコーダのハンドル
@@ -78,10 +321,8 @@ static inline void lr_to_ms_conversion(neac_block* block) {
 static void encode_current_block(neac_encoder* encoder) {
     register uint8_t ch;
     register uint16_t offset;
-    register signal sample, residual;
+    bool is_trial_encoded;
     neac_sub_block* sb = NULL;
-    polynomial_predictor* poly = NULL;
-    lms* lms = NULL;
 
     /* STEP 1. ミッドサイドステレオ変換が有効なら変換処理を行う */
     if (encoder->use_mid_side_stereo) {
@@ -90,27 +331,72 @@ static void encode_current_block(neac_encoder* encoder) {
 
     for (ch = 0; ch < encoder->num_channels; ++ch) {
         sb = encoder->current_block->sub_blocks[ch];
-        poly = encoder->polynomial_predictors[ch];
-        lms = encoder->lms_filters[ch];
-
-        for (offset = 0; offset < sb->size; ++offset) {
-            /* STEP 2. 多項式予測器を使用して信号を予測し、予測残差を求める。*/
-            residual = sb->samples[offset] - polynomial_predictor_predict(poly);
-            polynomial_predictor_update(poly, sb->samples[offset]);
 
-            /* STEP 3. 多項式予測器での予測残差をSSLMSフィルタで予測し、予測残差の予測残差を求める。*/
-            sample = residual;
-            residual -= lms_predict(lms);
-            lms_update(lms, sample, residual);
+        /* 予測前の信号を保持する */
+        memcpy(encoder->source_samples, sb->samples, sizeof(signal) * sb->size);
+
+        /* STEP 2. 多項式予測器（または線形予測器）とLMSフィルタで信号を予測し、予測残差を求める。*/
+        select_lpc(encoder, sb, select_polynomial_predictor(encoder, sb));
+        is_trial_encoded = predict_sub_block(encoder, sb, sb->samples);
+
+        /* すべてのサンプルに共通する下位のゼロのビットは、予測残差から取り除く。
+         * 予測器は元の信号の大きさのまま動作させ、ビット数が異なるサブブロックの間でも状態を引き継げるようにする。
+         * 予測値の合計は、元の信号から予測残差を引いた値となる。*/
+        sb->wasted_bits = compute_wasted_bits(encoder->source_samples, sb->size);
+        if (sb->wasted_bits > 0) {
+            for (offset = 0; offset < sb->size; ++offset) {
+                sb->samples[offset] = RSHIFT(encoder->source_samples[offset], sb->wasted_bits)
+                    - RSHIFT(encoder->source_samples[offset] - sb->samples[offset], sb->wasted_bits);
+            }
+        }
 
-            /* STEP 4. 予測残差の予測残差を出力とする。*/
-            sb->samples[offset] = residual;
+        /* STEP 3. 予測前の信号をそのまま格納した方が小さくなる場合は、サブブロックの種類を切り替える。
+         * 予測器の状態は種類によらず更新済みであり、デコーダも同じ信号で予測器を更新する。*/
+        neac_code_select_sub_block_type(encoder->coder, sb, encoder->source_samples);
+
+        /* 予測残差を格納しないサブブロックでは多項式予測器の次数を書き込まず、デコーダは既定の組み合わせで予測器を更新する。
+         * エンコーダも、複製しておいた予測器を既定の組み合わせで更新したものに切り替える。*/
+        if (sb->type != SUB_BLOCK_TYPE_PREDICTED && sb->lpc_order == 0
+            && (sb->polynomial_order != POLYNOMIAL_PREDICTOR_DEFAULT_ORDER || sb->polynomial_leak != POLYNOMIAL_PREDICTOR_DEFAULT_LEAK)) {
+            if (!is_trial_encoded) {
+                encode_default_trial(encoder, sb);
+            }
+            swap_trial_predictors(encoder, ch);
+            sb->polynomial_order = POLYNOMIAL_PREDICTOR_DEFAULT_ORDER;
+            sb->polynomial_leak = POLYNOMIAL_PREDICTOR_DEFAULT_LEAK;
         }
     }
 }
 
 #pragma endregion
 
+/*!
+ * @brief                   多段のLMSフィルタの段のシフト係数を求めます。
+ * @param taps              段のタップ数
+ * @param lms_mode          LMSフィルタの更新方式（LMS_MODE_*）
+ * @param bits_per_sample   量子化ビット数
+ * @return                  シフト係数
+ * @note                    前段のLMSフィルタは重み係数をより細かく調整できるよう、最後のLMSフィルタより大きなシフト係数から始めます。
+ *                          SSLMSでは、タップ数が多いほど予測値への重み係数の寄与が大きくなるため、タップ数の対数に応じて大きくします。
+ */
+static uint8_t compute_cascade_shift(uint16_t taps, uint8_t lms_mode, uint8_t bits_per_sample) {
+    uint8_t shift = lms_get_default_shift(lms_mode, bits_per_sample);
+
+    /* NLMSのステップは過去サンプルの2乗和で正規化されており、タップ数に応じて小さくする必要はない */
+    if (lms_mode == LMS_MODE_NORMALIZED) {
+        return shift + NLMS_CASCADE_EXTRA_SHIFT;
+    }
+
+    shift += LMS_CASCADE_EXTRA_SHIFT;
+
+    while (taps > LMS_MAX_TAPS && shift < LMS_MAX_SHIFT) {
+        taps = (uint16_t)RSHIFT(taps, 1);
+        ++shift;
+    }
+
+    return shift;
+}
+
 /*!
  * @brief               ブロック数を計算します
  * @param num_samples   サンプル数
@@ -132,7 +418,8 @@ static uint32_t compute_block_count(uint32_t num_samples, uint8_t num_channels,
 /*!
  * @brief                           エンコーダを初期化します
  * @param *encoder                  エンコーダのハンドル
- * @param *file                     出力先のファイルハンドル
+ * @param *file                     出力先のファイルハンドル。メモリ上に出力する場合はNULL
+ * @param *stream                   出力先ビットストリームのハンドル
  * @param sample_rate               サンプリング周波数
  * @param bits_per_sample           量子化ビット数
  * @param num_channels              チャンネル数
@@ -140,11 +427,13 @@ static uint32_t compute_block_count(uint32_t num_samples, uint8_t num_channels,
  * @param block_size                ブロックサイズ
  * @param use_mid_side_stereo       ミッドサイドステレオを使用するかどうかを示すフラグ
  * @param filter_taps               LMSフィルタのタップ数
+ * @param *options                  追加の設定（NULLの場合はすべて既定値）
  * @param *tag                      タグ情報
  */
 static void init(
     neac_encoder* encoder, 
     FILE* file, 
+    bit_stream* stream,
     uint32_t sample_rate, 
     uint8_t bits_per_sample, 
     uint8_t num_channels, 
@@ -152,16 +441,47 @@ static void init(
     uint16_t block_size, 
     bool use_mid_side_stereo, 
     uint8_t filter_taps,
+    const neac_encoder_options* options,
     neac_tag* tag) {
-    uint8_t ch;
+    const uint16_t* cascade_taps = NULL;
+    uint8_t num_cascade_stages = 0;
+    uint8_t lpc_order = 0;
+    uint8_t entropy_mode = ENTROPY_MODE_DEFAULT;
+    uint8_t ch, stage;
+
+    /* 追加の設定のうち、指定された項目のみを読み取る */
+    if (HAS_OPTION(options, num_cascade_stages) && HAS_OPTION(options, cascade_taps)) {
+        cascade_taps = options->cascade_taps;
+        num_cascade_stages = options->num_cascade_stages;
+    }
+
+    if (HAS_OPTION(options, lpc_order)) {
+        lpc_order = options->lpc_order;
+    }
+
+    if (HAS_OPTION(options, entropy_mode)) {
+        entropy_mode = options->entropy_mode;
+    }
 
     if (filter_taps > LMS_MAX_TAPS) {
         filter_taps = LMS_MAX_TAPS;
     }
 
-    /* ファイルを開いてビットストリームを初期化する */
+    if (entropy_mode > ENTROPY_MODE_MAX) {
+        entropy_mode = ENTROPY_MODE_DEFAULT;
+    }
+
+    if (num_cascade_stages > LMS_CASCADE_MAX_STAGES) {
+        num_cascade_stages = LMS_CASCADE_MAX_STAGES;
+    }
+
+    if (lpc_order > LPC_MAX_ORDER) {
+        lpc_order = LPC_MAX_ORDER;
+    }
+
+    /* 出力先を設定する */
     encoder->output_file = file;
-    encoder->output_bit_stream = bit_stream_create(encoder->output_file, BIT_STREAM_MODE_WRITE);
+    encoder->output_bit_stream = stream;
 
     encoder->sample_rate = sample_rate;
     encoder->bits_per_sample = bits_per_sample;
@@ -169,12 +489,34 @@ static void init(
     encoder->num_samples = num_samples;
     encoder->filter_taps = filter_taps;
     encoder->block_size = block_size;
-    encoder->use_mid_side_stereo = use_mid_side_stereo;
+    /* 32ビットのPCMでは、サイド信号が32ビットに収まらず復元できなくなるため、ミッドサイドステレオを使用しない */
+    encoder->use_mid_side_stereo = use_mid_side_stereo && bits_per_sample < 32;
+    encoder->entropy_mode = entropy_mode;
+    encoder->num_cascade_stages = num_cascade_stages;
+    /* 32ビットのPCMでは、SSLMSの32ビットの積があふれるためNLMSを使用する。それ以外では、
+       多項式予測器と一体化したブロック単位の実装で高速に復号できるSSLMSを使用する */
+    encoder->lms_mode = (bits_per_sample < 32) ? LMS_MODE_SIGN_SIGN : LMS_MODE_NORMALIZED;
+    for (stage = 0; stage < num_cascade_stages; ++stage) {
+        encoder->cascade_taps[stage] = cascade_taps[stage];
+        if (encoder->cascade_taps[stage] == 0) {
+            encoder->cascade_taps[stage] = 1;
+        }
+        if (encoder->cascade_taps[stage] > LMS_CASCADE_MAX_TAPS) {
+            encoder->cascade_taps[stage] = LMS_CASCADE_MAX_TAPS;
+        }
+        encoder->cascade_shifts[stage] = compute_cascade_shift(encoder->cascade_taps[stage], encoder->lms_mode, bits_per_sample);
+    }
+    encoder->lpc_order = lpc_order;
     encoder->num_blocks = compute_block_count(num_samples, num_channels, block_size);
     encoder->lms_filters = (lms**)malloc(sizeof(lms*) * num_channels);
     encoder->polynomial_predictors = (polynomial_predictor**)malloc(sizeof(polynomial_predictor*) * num_channels);
-    encoder->coder = neac_code_create(encoder->output_bit_stream);
+    encoder->cascade_filters = (lms**)malloc(sizeof(lms*) * num_channels * LMS_CASCADE_MAX_STAGES);
+    encoder->lpc_predictors = (lpc**)malloc(sizeof(lpc*) * num_channels);
+    encoder->lpc_work = (double*)calloc(block_size, sizeof(double));
+    encoder->coder = neac_code_create(encoder->output_bit_stream, NEAC_ENCODER_FORMAT_VERSION, entropy_mode, lpc_order);
     encoder->current_block = (neac_block*)malloc(sizeof(neac_block));
+    encoder->source_samples = (signal*)calloc(block_size, sizeof(signal));
+    encoder->trial_samples = (signal*)calloc(block_size, sizeof(signal));
     encoder->current_sub_block_channel = 0;
     encoder->current_sub_block_offset = 0;
     encoder->tag = tag;
@@ -183,10 +525,21 @@ static void init(
     neac_block_init(encoder->current_block, block_size, num_channels);
 
     /* 各チャンネル用のフィルタを初期化 */
-    if (encoder->lms_filters != NULL && encoder->polynomial_predictors != NULL) {
+    if (encoder->lms_filters != NULL && encoder->polynomial_predictors != NULL && encoder->cascade_filters != NULL && encoder->lpc_predictors != NULL && encoder->lpc_work != NULL && encoder->source_samples != NULL && encoder->trial_samples != NULL) {
         for (ch = 0; ch < num_channels; ++ch) {
-            encoder->lms_filters[ch] = lms_create(filter_taps, bits_per_sample);
+            encoder->lms_filters[ch] = lms_create(filter_taps, encoder->lms_mode, bits_per_sample);
             encoder->polynomial_predictors[ch] = polynomial_predictor_create();
+            encoder->lpc_predictors[ch] = lpc_create();
+            for (stage = 0; stage < num_cascade_stages; ++stage) {
+                encoder->cascade_filters[ch * num_cascade_stages + stage] = lms_create_with_shift(encoder->cascade_taps[stage], encoder->lms_mode, encoder->cascade_shifts[stage]);
+            }
+        }
+
+        /* 既定の次数と減衰の度合いを試すための予測器は、チャンネルによらず共通の設定で1組だけ用意する */
+        encoder->trial_lms_filter = lms_create(filter_taps, encoder->lms_mode, bits_per_sample);
+        encoder->trial_polynomial_predictor = polynomial_predictor_create();
+        for (stage = 0; stage < num_cascade_stages; ++stage) {
+            encoder->trial_cascade_filters[stage] = lms_create_with_shift(encoder->cascade_taps[stage], encoder->lms_mode, encoder->cascade_shifts[stage]);
         }
     }
     else {
@@ -208,6 +561,7 @@ static void init(
  * @param block_size                ブロックサイズ
  * @param use_mid_side_stereo       ミッドサイドステレオを使用するかどうかを示すフラグ
  * @param filter_taps               LMSフィルタのタップ数
+ * @param *options                  追加の設定（NULLの場合はすべて既定値）
  * @param *tag                      タグ情報
  */
 static void init_from_path(
@@ -220,6 +574,7 @@ static void init_from_path(
     uint16_t block_size, 
     bool use_mid_side_stereo,
     uint8_t filter_taps,
+    const neac_encoder_options* options,
     neac_tag* tag) {
     FILE* fp;
     errno_t err;
@@ -235,6 +590,7 @@ static void init_from_path(
     init(
         encoder, 
         fp,
+        bit_stream_create(fp, BIT_STREAM_MODE_WRITE),
         sample_rate, 
         bits_per_sample, 
         num_channels, 
@@ -242,6 +598,7 @@ static void init_from_path(
         block_size, 
         use_mid_side_stereo,
         filter_taps,
+        options,
         tag);
 }
 
@@ -267,6 +624,110 @@ neac_encoder* neac_encoder_create(
     bool use_mid_side_stereo,
     uint8_t filter_taps,
     neac_tag* tag) {
+    return neac_encoder_create_ex(
+        file,
+        sample_rate,
+        bits_per_sample,
+        num_channels,
+        num_samples,
+        block_size,
+        use_mid_side_stereo,
+        filter_taps,
+        NULL,
+        tag);
+}
+
+/*!
+ * @brief                           指定された設定で、エンコーダのハンドルを生成します。
+ * @param *path                     出力先のパス
+ * @param sample_rate               サンプリング周波数
+ * @param bits_per_sample           量子化ビット数
+ * @param num_channels              チャンネル数
+ * @param num_samples               合計サンプル数
+ * @param block_size                ブロックサイズ
+ * @param use_mid_side_stereo       ミッドサイドステレオを使用するかどうかを示すフラグ
+ * @param filter_taps               LMSフィルタのタップ数
+ * @param *tag                      タグ情報
+ */
+neac_encoder* neac_encoder_create_from_path(
+    const char* path,
+    uint32_t sample_rate,
+    uint8_t bits_per_sample,
+    uint8_t num_channels,
+    uint32_t num_samples,
+    uint16_t block_size,
+    bool use_mid_side_stereo,
+    uint8_t filter_taps,
+    neac_tag* tag) {
+    return neac_encoder_create_from_path_ex(
+        path,
+        sample_rate,
+        bits_per_sample,
+        num_channels,
+        num_samples,
+        block_size,
+        use_mid_side_stereo,
+        filter_taps,
+        NULL,
+        tag);
+}
+
+/*!
+ * @brief                           指定された設定で、メモリ上に出力するエンコーダのハンドルを生成します。出力先の領域は必要に応じて自動的に拡張されます。
+ * @param sample_rate               サンプリング周波数
+ * @param bits_per_sample           量子化ビット数
+ * @param num_channels              チャンネル数
+ * @param num_samples               合計サンプル数
+ * @param block_size                ブロックサイズ
+ * @param use_mid_side_stereo       ミッドサイドステレオを使用するかどうかを示すフラグ
+ * @param filter_taps               LMSフィルタの最大タップ数
+ * @param *tag                      タグ情報
+ */
+neac_encoder* neac_encoder_create_from_memory(
+    uint32_t sample_rate,
+    uint8_t bits_per_sample,
+    uint8_t num_channels,
+    uint32_t num_samples,
+    uint16_t block_size,
+    bool use_mid_side_stereo,
+    uint8_t filter_taps,
+    neac_tag* tag) {
+    return neac_encoder_create_from_memory_ex(
+        sample_rate,
+        bits_per_sample,
+        num_channels,
+        num_samples,
+        block_size,
+        use_mid_side_stereo,
+        filter_taps,
+        NULL,
+        tag);
+}
+
+/*!
+ * @brief                           指定された設定と追加の設定で、エンコーダのハンドルを生成します。
+ * @param *file                     出力先のファイルハンドル
+ * @param sample_rate               サンプリング周波数
+ * @param bits_per_sample           量子化ビット数
+ * @param num_channels              チャンネル数
+ * @param num_samples               合計サンプル数
+ * @param block_size                ブロックサイズ
+ * @param use_mid_side_stereo       ミッドサイドステレオを使用するかどうかを示すフラグ
+ * @param filter_taps               LMSフィルタのタップ数
+ * @param *options                  追加の設定（NULLの場合はすべて既定値）
+ * @param *tag                      タグ情報
+ */
+neac_encoder* neac_encoder_create_ex(
+    FILE* file,
+    uint32_t sample_rate,
+    uint8_t bits_per_sample,
+    uint8_t num_channels,
+    uint32_t num_samples,
+    uint16_t block_size,
+    bool use_mid_side_stereo,
+    uint8_t filter_taps,
+    const neac_encoder_options* options,
+    neac_tag* tag) {
     neac_encoder* result = (neac_encoder*)malloc(sizeof(neac_encoder));
 
     if (result == NULL) {
@@ -277,6 +738,7 @@ neac_encoder* neac_encoder_create(
     init(
         result,
         file,
+        bit_stream_create(file, BIT_STREAM_MODE_WRITE),
         sample_rate,
         bits_per_sample,
         num_channels,
@@ -284,13 +746,14 @@ neac_encoder* neac_encoder_create(
         block_size,
         use_mid_side_stereo,
         filter_taps,
+        options,
         tag);
 
     return result;
 }
 
 /*!
- * @brief                           指定された設定で、エンコーダのハンドルを生成します。
+ * @brief                           指定された設定と追加の設定で、エンコーダのハンドルを生成します。
  * @param *path                     出力先のパス
  * @param sample_rate               サンプリング周波数
  * @param bits_per_sample           量子化ビット数
@@ -299,9 +762,10 @@ neac_encoder* neac_encoder_create(
  * @param block_size                ブロックサイズ
  * @param use_mid_side_stereo       ミッドサイドステレオを使用するかどうかを示すフラグ
  * @param filter_taps               LMSフィルタのタップ数
+ * @param *options                  追加の設定（NULLの場合はすべて既定値）
  * @param *tag                      タグ情報
  */
-neac_encoder* neac_encoder_create_from_path(
+neac_encoder* neac_encoder_create_from_path_ex(
     const char* path,
     uint32_t sample_rate,
     uint8_t bits_per_sample,
@@ -310,6 +774,7 @@ neac_encoder* neac_encoder_create_from_path(
     uint16_t block_size,
     bool use_mid_side_stereo,
     uint8_t filter_taps,
+    const neac_encoder_options* options,
     neac_tag* tag) {
     neac_encoder* result = (neac_encoder*)malloc(sizeof(neac_encoder));
 
@@ -328,6 +793,53 @@ neac_encoder* neac_encoder_create_from_path(
         block_size,
         use_mid_side_stereo,
         filter_taps,
+        options,
+        tag);
+
+    return result;
+}
+
+/*!
+ * @brief                           指定された設定と追加の設定で、メモリ上に出力するエンコーダのハンドルを生成します。出力先の領域は必要に応じて自動的に拡張されます。
+ * @param sample_rate               サンプリング周波数
+ * @param bits_per_sample           量子化ビット数
+ * @param num_channels              チャンネル数
+ * @param num_samples               合計サンプル数
+ * @param block_size                ブロックサイズ
+ * @param use_mid_side_stereo       ミッドサイドステレオを使用するかどうかを示すフラグ
+ * @param filter_taps               LMSフィルタの最大タップ数
+ * @param *options                  追加の設定（NULLの場合はすべて既定値）
+ * @param *tag                      タグ情報
+ */
+neac_encoder* neac_encoder_create_from_memory_ex(
+    uint32_t sample_rate,
+    uint8_t bits_per_sample,
+    uint8_t num_channels,
+    uint32_t num_samples,
+    uint16_t block_size,
+    bool use_mid_side_stereo,
+    uint8_t filter_taps,
+    const neac_encoder_options* options,
+    neac_tag* tag) {
+    neac_encoder* result = (neac_encoder*)malloc(sizeof(neac_encoder));
+
+    if (result == NULL) {
+        report_error(NEAC_ERROR_ENCODER_CANNOT_ALLOCATE_MEMORY);
+        return NULL;
+    }
+
+    init(
+        result,
+        NULL,
+        bit_stream_create_memory_writer(),
+        sample_rate,
+        bits_per_sample,
+        num_channels,
+        num_samples,
+        block_size,
+        use_mid_side_stereo,
+        filter_taps,
+        options,
         tag);
 
     return result;
@@ -339,19 +851,41 @@ neac_encoder* neac_encoder_create_from_path(
  */
 void neac_encoder_free(neac_encoder* encoder) {
     uint8_t ch;
+    uint16_t stage;
 
+    bit_stream_free(encoder->output_bit_stream);
     free(encoder->output_bit_stream);
 
     /* 各チャンネル用のフィルタを解放 */
     for (ch = 0; ch < encoder->num_channels; ++ch) {
         lms_free(encoder->lms_filters[ch]);
         polynomial_predictor_free(encoder->polynomial_predictors[ch]);
+        lpc_free(encoder->lpc_predictors[ch]);
+        free(encoder->lpc_predictors[ch]);
+    }
+    for (stage = 0; stage < encoder->num_cascade_stages * encoder->num_channels; ++stage) {
+        lms_free(encoder->cascade_filters[stage]);
+        free(encoder->cascade_filters[stage]);
     }
     free(encoder->lms_filters);
     free(encoder->polynomial_predictors);
+    free(encoder->cascade_filters);
+    free(encoder->lpc_predictors);
+    free(encoder->lpc_work);
+    lms_free(encoder->trial_lms_filter);
+    free(encoder->trial_lms_filter);
+    polynomial_predictor_free(encoder->trial_polynomial_predictor);
+    free(encoder->trial_polynomial_predictor);
+    for (stage = 0; stage < encoder->num_cascade_stages; ++stage) {
+        lms_free(encoder->trial_cascade_filters[stage]);
+        free(encoder->trial_cascade_filters[stage]);
+    }
 
+    neac_code_free(encoder->coder);
     free(encoder->coder);
     free(encoder->current_block);
+    free(encoder->source_samples);
+    free(encoder->trial_samples);
 
     neac_tag_free(encoder->tag);
 }
@@ -396,6 +930,19 @@ void neac_encoder_end_write(neac_encoder* encoder) {
     }
 
     bit_stream_close(encoder->output_bit_stream);
-    fflush(encoder->output_file);
-    fclose(encoder->output_file);
+
+    if (encoder->output_file != NULL) {
+        fflush(encoder->output_file);
+        fclose(encoder->output_file);
+    }
+}
+
+/*!
+ * @brief           メモリ上に出力するエンコーダで、エンコードされたデータを取得します。neac_encoder_end_write の呼び出し後に使用してください。
+ * @param *encoder  エンコーダのハンドル
+ * @param *size     [出力]エンコードされたデータのバイト数
+ * @return          エンコードされたデータのポインタ。エンコーダを解放するまで有効です。ファイルに出力するエンコーダの場合はNULLを返します。
+ */
+const uint8_t* neac_encoder_get_output_memory(neac_encoder* encoder, size_t* size) {
+    return bit_stream_get_memory(encoder->output_bit_stream, size);
 }
\ No newline at end of file
@@ -12,6 +12,12 @@
 void neac_sub_block_init(neac_sub_block* sub_block, uint16_t size, uint8_t channel) {
     sub_block->size = size;
     sub_block->channel = channel;
+    sub_block->type = SUB_BLOCK_TYPE_PREDICTED;
+    sub_block->wasted_bits = 0;
+    sub_block->polynomial_order = POLYNOMIAL_PREDICTOR_DEFAULT_ORDER;
+    sub_block->polynomial_leak = POLYNOMIAL_PREDICTOR_DEFAULT_LEAK;
+    sub_block->lpc_order = 0;
+    sub_block->lpc_shift = 0;
     sub_block->samples = (signal*)calloc(size, sizeof(signal));
 
     if (sub_block->samples == NULL) {
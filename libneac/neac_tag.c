@@ -1,37 +1,34 @@
 #include "./include/file_access.h"
+#include "./include/neac_error.h"
 #include "./include/neac_tag.h"
 #include <stdlib.h>
 
 /*!
  * @brief           タグ構造体のメンバ変数pictureに格納された画像のバイナリデータを、タグとしてファイルに出力します。
- * @param *file     ファイルハンドル
+ * @param *stream   ビットストリームのハンドル
  * @param *tag      タグ構造体のハンドル
  */
-static void neac_tag_write_picture(FILE* file, neac_tag* tag) {
-    uint32_t offset;
-
+static void neac_tag_write_picture(bit_stream* stream, neac_tag* tag) {
     if (tag == NULL || tag->picture_size == 0 || tag->picture == NULL) {
         return;
     }
 
     /* 画像データを書き込む */
-    write_uint8(file, NEAC_TAG_ID_PICTURE);
-    write_uint32(file, tag->picture_size);
-    write_uint8(file, tag->picture_format);
-    for (offset = 0; offset < tag->picture_size; ++offset) {
-        write_uint8(file, tag->picture[offset]);
+    write_uint8(stream, NEAC_TAG_ID_PICTURE);
+    write_uint32(stream, tag->picture_size);
+    write_uint8(stream, tag->picture_format);
+    if (bit_stream_write_bytes(stream, tag->picture, tag->picture_size) < tag->picture_size) {
+        report_error(NEAC_ERROR_FILE_ACCESS_FAILED_TO_WRITE_UINT8);
     }
 }
 
 /*!
  * @brief           ファイルから画像データを読み込みます。
- * @param *file     ファイルハンドル
+ * @param *stream   ビットストリームのハンドル
  * @param **tag     タグ構造体のポインタのポインタ
  * @param size      画像データのサイズ
  */
-static void neac_tag_read_picture(FILE* file, neac_tag** tag, uint32_t size) {
-    uint32_t offset;
-
+static void neac_tag_read_picture(bit_stream* stream, neac_tag** tag, uint32_t size) {
     /* 画像データを格納する領域を確保 */
     (*tag)->picture_size = (uint32_t)size;
     (*tag)->picture = (uint8_t*)malloc(sizeof(uint8_t) * size);
@@ -40,9 +37,9 @@ static void neac_tag_read_picture(FILE* file, neac_tag** tag, uint32_t size) {
     }
 
     /* 画像データを読み込む */
-    (*tag)->picture_format = read_uint8(file);
-    for (offset = 0; offset < size; ++offset) {
-        (*tag)->picture[offset] = read_uint8(file);
+    (*tag)->picture_format = read_uint8(stream);
+    if (bit_stream_read_bytes(stream, (*tag)->picture, size) < size) {
+        report_error(NEAC_ERROR_FILE_ACCESS_FAILED_TO_READ_UINT8);
     }
 }
 
@@ -111,7 +108,7 @@ void neac_tag_free(neac_tag* tag) {
  * @param *picture_file     画像ファイルのハンドル
  */
 void neac_tag_set_picture(neac_tag* tag, FILE* picture_file) {
-    fpos_t size, offset;
+    fpos_t size;
     if (picture_file == NULL) {
         return;
     }
@@ -131,8 +128,8 @@ void neac_tag_set_picture(neac_tag* tag, FILE* picture_file) {
     }
 
     /* 画像ファイルのデータを読み込む */
-    for (offset = 0; offset < size; ++offset) {
-        tag->picture[offset] = read_uint8(picture_file);
+    if (fread(tag->picture, sizeof(uint8_t), tag->picture_size, picture_file) < tag->picture_size) {
+        report_error(NEAC_ERROR_FILE_ACCESS_FAILED_TO_READ_UINT8);
     }
 
     fclose(picture_file);
@@ -167,14 +164,14 @@ void neac_tag_set_picture_from_path(neac_tag* tag, const char* path) {
 
 /*!
  * @brief                   タグを読み込み、タグ構造体に格納します。
- * @param *file             ファイルのハンドル
+ * @param *stream           ビットストリームのハンドル
  * @param **tag             タグ構造体のポインタのポインタ
  */
-void neac_tag_read(FILE* file, neac_tag** tag) {
+void neac_tag_read(bit_stream* stream, neac_tag** tag) {
     uint8_t num_tag_info, i, id;
     uint32_t size;
 
-    if (read_bool(file)) {
+    if (read_bool(stream)) {
         *tag = (neac_tag*)malloc(sizeof(neac_tag));
 
         if (*tag == NULL) {
@@ -185,67 +182,67 @@ void neac_tag_read(FILE* file, neac_tag** tag) {
         neac_tag_init(*tag);
 
         /* タグ数を取得 */
-        num_tag_info = read_uint8(file);
+        num_tag_info = read_uint8(stream);
 
         /* すべてのタグを読み込む */
         for (i = 0; i < num_tag_info; ++i) {
-            id = read_uint8(file);              /* タグIDを読み込む */
-            size = read_uint32(file);           /* タグのデータのバイト数を読み込む */
+            id = read_uint8(stream);            /* タグIDを読み込む */
+            size = read_uint32(stream);         /* タグのデータのバイト数を読み込む */
 
             switch (id) {
             case NEAC_TAG_ID_TITLE:
-                (*tag)->title = read_string(file, size);
+                (*tag)->title = read_string(stream, size);
                 break;
             case NEAC_TAG_ID_ALBUM:
-                (*tag)->album = read_string(file, size);
+                (*tag)->album = read_string(stream, size);
                 break;
             case NEAC_TAG_ID_ARTIST:
-                (*tag)->artist = read_string(file, size);
+                (*tag)->artist = read_string(stream, size);
                 break;
             case NEAC_TAG_ID_ALBUM_ARTIST:
-                (*tag)->album_artist = read_string(file, size);
+                (*tag)->album_artist = read_string(stream, size);
                 break;
             case NEAC_TAG_ID_SUBTITLE:
-                (*tag)->subtitle = read_string(file, size);
+                (*tag)->subtitle = read_string(stream, size);
                 break;
             case NEAC_TAG_ID_PUBLISHER:
-                (*tag)->publisher = read_string(file, size);
+                (*tag)->publisher = read_string(stream, size);
                 break;
             case NEAC_TAG_ID_COMPOSER:
-                (*tag)->composer = read_string(file, size);
+                (*tag)->composer = read_string(stream, size);
                 break;
             case NEAC_TAG_ID_SONGWRITER:
-                (*tag)->songwriter = read_string(file, size);
+                (*tag)->songwriter = read_string(stream, size);
                 break;
             case NEAC_TAG_ID_CONDUCTOR:
-                (*tag)->conductor = read_string(file, size);
+                (*tag)->conductor = read_string(stream, size);
                 break;
             case NEAC_TAG_ID_COPYRIGHT:
-                (*tag)->copyright = read_string(file, size);
+                (*tag)->copyright = read_string(stream, size);
                 break;
             case NEAC_TAG_ID_GENRE:
-                (*tag)->genre = read_string(file, size);
+                (*tag)->genre = read_string(stream, size);
                 break;
             case NEAC_TAG_ID_YEAR:
-                (*tag)->year = read_uint16(file);
+                (*tag)->year = read_uint16(stream);
                 break;
             case NEAC_TAG_ID_TRACK_NUM:
-                (*tag)->track_number = read_uint16(file);
+                (*tag)->track_number = read_uint16(stream);
                 break;
             case NEAC_TAG_ID_TRACK_CNT:
-                (*tag)->track_count = read_uint16(file);
+                (*tag)->track_count = read_uint16(stream);
                 break;
             case NEAC_TAG_ID_DISC:
-                (*tag)->disc = read_uint16(file);
+                (*tag)->disc = read_uint16(stream);
                 break;
             case NEAC_TAG_ID_COMMENT:
-                (*tag)->comment = read_string(file, size);
+                (*tag)->comment = read_string(stream, size);
                 break;
             case NEAC_TAG_ID_RATE:
-                (*tag)->rate = read_uint16(file);
+                (*tag)->rate = read_uint16(stream);
                 break;
             case NEAC_TAG_ID_PICTURE:
-                neac_tag_read_picture(file, tag, size);
+                neac_tag_read_picture(stream, tag, size);
                 break;
             }
         }
@@ -257,18 +254,18 @@ void neac_tag_read(FILE* file, neac_tag** tag) {
 
 /*!
  * @brief                   タグを書き込みます。
- * @param *file             ファイルのハンドル
+ * @param *stream           ビットストリームのハンドル
  * @param *tag             タグ構造体のハンドル
  */
-void neac_tag_write(FILE* file, neac_tag* tag) {
+void neac_tag_write(bit_stream* stream, neac_tag* tag) {
     uint32_t size;
 
     /* タグの存在判定用フラグを書き込む */
-    write_bool(file, tag != NULL);
+    write_bool(stream, tag != NULL);
 
     if (tag != NULL) {
         /* タグ情報の総数を書き込む */
-        write_uint8(file, NEAC_TAG_INFO_COUNT);
+        write_uint8(stream, NEAC_TAG_INFO_COUNT);
 
         /*  タグ情報のデータ構造 
          *  -------------------------------------
@@ -284,107 +281,107 @@ void neac_tag_write(FILE* file, neac_tag* tag) {
 
         /* タイトル */
         size = (uint32_t)(strlen(tag->title) + 1);
-        write_uint8(file, NEAC_TAG_ID_TITLE);
-        write_uint32(file, size);
-        write_string(file, tag->title, size);
+        write_uint8(stream, NEAC_TAG_ID_TITLE);
+        write_uint32(stream, size);
+        write_string(stream, tag->title, size);
 
         /* アルバム名 */
         size = (uint32_t)(strlen(tag->album) + 1);
-        write_uint8(file, NEAC_TAG_ID_ALBUM);
-        write_uint32(file, size);
-        write_string(file, tag->album, size);
+        write_uint8(stream, NEAC_TAG_ID_ALBUM);
+        write_uint32(stream, size);
+        write_string(stream, tag->album, size);
 
         /* アーティスト名 */
         size = (uint32_t)(strlen(tag->artist) + 1);
-        write_uint8(file, NEAC_TAG_ID_ARTIST);
-        write_uint32(file, size);
-        write_string(file, tag->artist, size);
+        write_uint8(stream, NEAC_TAG_ID_ARTIST);
+        write_uint32(stream, size);
+        write_string(stream, tag->artist, size);
 
         /* アルバムアーティスト名 */
         size = (uint32_t)(strlen(tag->album_artist) + 1);
-        write_uint8(file, NEAC_TAG_ID_ALBUM_ARTIST);
-        write_uint32(file, size);
-        write_string(file, tag->album_artist, size);
+        write_uint8(stream, NEAC_TAG_ID_ALBUM_ARTIST);
+        write_uint32(stream, size);
+        write_string(stream, tag->album_artist, size);
 
         /* サブタイトル */
         size = (uint32_t)(strlen(tag->subtitle) + 1);
-        write_uint8(file, NEAC_TAG_ID_SUBTITLE);
-        write_uint32(file, size);
-        write_string(file, tag->subtitle, size);
+        write_uint8(stream, NEAC_TAG_ID_SUBTITLE);
+        write_uint32(stream, size);
+        write_string(stream, tag->subtitle, size);
 
         /* 発行者 */
         size = (uint32_t)(strlen(tag->publisher) + 1);
-        write_uint8(file, NEAC_TAG_ID_PUBLISHER);
-        write_uint32(file, size);
-        write_string(file, tag->publisher, size);
+        write_uint8(stream, NEAC_TAG_ID_PUBLISHER);
+        write_uint32(stream, size);
+        write_string(stream, tag->publisher, size);
 
         /* 作曲者 */
         size = (uint32_t)(strlen(tag->composer) + 1);
-        write_uint8(file, NEAC_TAG_ID_COMPOSER);
-        write_uint32(file, size);
-        write_string(file, tag->composer, size);
+        write_uint8(stream, NEAC_TAG_ID_COMPOSER);
+        write_uint32(stream, size);
+        write_string(stream, tag->composer, size);
 
         /* 作詞者 */
         size = (uint32_t)(strlen(tag->songwriter) + 1);
-        write_uint8(file, NEAC_TAG_ID_SONGWRITER);
-        write_uint32(file, size);
-        write_string(file, tag->songwriter, size);
+        write_uint8(stream, NEAC_TAG_ID_SONGWRITER);
+        write_uint32(stream, size);
+        write_string(stream, tag->songwriter, size);
 
         /* 指揮者 */
         size = (uint32_t)(strlen(tag->conductor) + 1);
-        write_uint8(file, NEAC_TAG_ID_CONDUCTOR);
-        write_uint32(file, size);
-        write_string(file, tag->conductor, size);
+        write_uint8(stream, NEAC_TAG_ID_CONDUCTOR);
+        write_uint32(stream, size);
+        write_string(stream, tag->conductor, size);
 
         /* 著作権表示 */
         size = (uint32_t)(strlen(tag->copyright) + 1);
-        write_uint8(file, NEAC_TAG_ID_COPYRIGHT);
-        write_uint32(file, size);
-        write_string(file, tag->copyright, size);
+        write_uint8(stream, NEAC_TAG_ID_COPYRIGHT);
+        write_uint32(stream, size);
+        write_string(stream, tag->copyright, size);
 
         /* ジャンル */
         size = (uint32_t)(strlen(tag->genre) + 1);
-        write_uint8(file, NEAC_TAG_ID_GENRE);
-        write_uint32(file, size);
-        write_string(file, tag->genre, size);
+        write_uint8(stream, NEAC_TAG_ID_GENRE);
+        write_uint32(stream, size);
+        write_string(stream, tag->genre, size);
 
         /* コメント */
         size = (uint32_t)(strlen(tag->comment) + 1);
-        write_uint8(file, NEAC_TAG_ID_COMMENT);
-        write_uint32(file, size);
-        write_string(file, tag->comment, size);
+        write_uint8(stream, NEAC_TAG_ID_COMMENT);
+        write_uint32(stream, size);
+        write_string(stream, tag->comment, size);
 
         /* 発行年 */
         size = 2;
-        write_uint8(file, NEAC_TAG_ID_YEAR);
-        write_uint32(file, size);
-        write_uint16(file, tag->year);
+        write_uint8(stream, NEAC_TAG_ID_YEAR);
+        write_uint32(stream, size);
+        write_uint16(stream, tag->year);
 
         /* トラック番号 */
         size = 2;
-        write_uint8(file, NEAC_TAG_ID_TRACK_NUM);
-        write_uint32(file, size);
-        write_uint16(file, tag->track_number);
+        write_uint8(stream, NEAC_TAG_ID_TRACK_NUM);
+        write_uint32(stream, size);
+        write_uint16(stream, tag->track_number);
 
         /* トラック数 */
         size = 2;
-        write_uint8(file, NEAC_TAG_ID_TRACK_CNT);
-        write_uint32(file, size);
-        write_uint16(file, tag->track_count);
+        write_uint8(stream, NEAC_TAG_ID_TRACK_CNT);
+        write_uint32(stream, size);
+        write_uint16(stream, tag->track_count);
 
         /* ディスク番号 */
         size = 2;
-        write_uint8(file, NEAC_TAG_ID_DISC);
-        write_uint32(file, size);
-        write_uint16(file, tag->disc);
+        write_uint8(stream, NEAC_TAG_ID_DISC);
+        write_uint32(stream, size);
+        write_uint16(stream, tag->disc);
 
         /* 評価 */
         size = 2;
-        write_uint8(file, NEAC_TAG_ID_RATE);
-        write_uint32(file, size);
-        write_uint16(file, tag->rate);
+        write_uint8(stream, NEAC_TAG_ID_RATE);
+        write_uint32(stream, size);
+        write_uint16(stream, tag->rate);
 
         /* 画像の書き込み */
-        neac_tag_write_picture(file, tag);
+        neac_tag_write_picture(stream, tag);
     }
 }
\ No newline at end of file
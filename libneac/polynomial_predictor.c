@@ -6,9 +6,117 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define PREDICT(p, k) (RSHIFT(p * (LSHIFT(1, k) - 1), k))
-#define PREDICT2(p1, p2, k) (LSHIFT(PREDICT((p1), (k)), 1) - (PREDICT((p2), (k - 1))))
-#define K 4
+/* 減衰の度合いの番号毎の、直前のサンプルの項のシフト量（0なら減衰させない） */
+static const uint8_t leak_shifts[POLYNOMIAL_PREDICTOR_NUM_LEAKS] = { 0, 3, POLYNOMIAL_PREDICTOR_K, 6 };
+
+/*!
+ * @brief               過去サンプルを p * (2^k - 1) / 2^k に減衰させます。
+ * @param p             過去サンプル
+ * @param k             減衰の度合い（0以下なら減衰させない）
+ * @return              減衰させた過去サンプル
+ */
+static inline int64_t leak_sample(signal p, int32_t k) {
+    return (k > 0) ? POLYNOMIAL_PREDICTOR_PREDICT_1(p, k) : p;
+}
+
+/*!
+ * @brief               過去サンプルを多項式で外挿し、次に続くPCMサンプルを予測します。
+ * @param *history      新しい順の過去サンプル（次数以上の個数）
+ * @param order         次数
+ * @param k             直前のサンプルの項の減衰の度合い（0なら減衰させない）
+ * @return              予測されたPCMサンプル
+ * @note                i番目の過去サンプルに二項係数を掛け、減衰の度合いをfloor(log2(i))だけ強めます。
+ *                      次数2・減衰の度合いPOLYNOMIAL_PREDICTOR_Kでは、POLYNOMIAL_PREDICTOR_PREDICTと一致します。
+ */
+static inline signal predict(const signal* history, uint8_t order, int32_t k) {
+    register int64_t prediction;
+
+    switch (order) {
+    case 0:
+        return 0;
+    case 1:
+        prediction = leak_sample(history[0], k);
+        break;
+    case 2:
+        prediction = 2 * leak_sample(history[0], k) - leak_sample(history[1], k - 1);
+        break;
+    case 3:
+        prediction = 3 * (leak_sample(history[0], k) - leak_sample(history[1], k - 1)) + leak_sample(history[2], k - 1);
+        break;
+    default:
+        prediction = 4 * (leak_sample(history[0], k) + leak_sample(history[2], k - 1)) - 6 * leak_sample(history[1], k - 1) - leak_sample(history[3], k - 2);
+        break;
+    }
+
+    return (signal)(uint32_t)prediction;
+}
+
+/*!
+ * @brief               新しい順の過去サンプルの配列に、最新のサンプルを加えます。
+ * @param *history      [入出力]新しい順の過去サンプル（POLYNOMIAL_PREDICATOR_MAX_HISTORY個）
+ * @param sample        PCMサンプル
+ */
+static inline void push_history(signal* history, signal sample) {
+    history[3] = history[2];
+    history[2] = history[1];
+    history[1] = history[0];
+    history[0] = sample;
+}
+
+/*!
+ * @brief               予測残差の絶対値を求めます。
+ * @param sample        PCMサンプル
+ * @param prediction    予測されたPCMサンプル
+ * @return              予測残差の絶対値
+ * @note                符号化されるのと同じ、32ビットで桁あふれさせた予測残差の絶対値を返します。
+ */
+static inline uint64_t absolute_residual(signal sample, signal prediction) {
+    register int64_t residual = (signal)((uint32_t)sample - (uint32_t)prediction);
+    return (uint64_t)(residual < 0 ? -residual : residual);
+}
+
+/*!
+ * @brief               過去サンプルを p * (2^k - 1) / 2^k に減衰させた値を、32ビットの符号なし整数として求めます。
+ * @param p             過去サンプル
+ * @param k             減衰の度合い（0以下なら減衰させない）
+ * @return              減衰させた過去サンプル
+ * @note                leak_sampleと同じ値を、符号付き整数の桁あふれを起こさずに求めます。
+ */
+static inline uint32_t leak_sample32(signal p, int32_t k) {
+    return (k > 0) ? (uint32_t)p + (uint32_t)RSHIFT((signal)(0U - (uint32_t)p), k) : (uint32_t)p;
+}
+
+/*!
+ * @brief               指定された減衰の度合いと1以上のすべての次数について、予測残差の絶対値を合計に加えます。
+ * @param *sums         [入出力]次数毎の予測残差の絶対値の合計
+ * @param *data         時間順の信号（start番目のサンプルより前に、POLYNOMIAL_PREDICATOR_MAX_HISTORY個の過去サンプルが必要）
+ * @param start         最初に予測するサンプルの位置
+ * @param end           最後に予測するサンプルの次の位置
+ * @param k             直前のサンプルの項の減衰の度合い（0なら減衰させない）
+ * @note                predictと同じ予測値を、32ビットで桁あふれさせながら求めます。
+ *                      サンプル毎に独立した計算のため、コンパイラによるベクトル化が効きます。
+ */
+static void accumulate_absolute_residuals(uint64_t* sums, const signal* data, uint32_t start, uint32_t end, int32_t k) {
+    register uint32_t i;
+    register uint32_t a0, a1, a2, a3;
+    uint64_t sum1 = 0, sum2 = 0, sum3 = 0, sum4 = 0;
+
+    for (i = start; i < end; ++i) {
+        a0 = leak_sample32(data[i - 1], k);
+        a1 = leak_sample32(data[i - 2], k - 1);
+        a2 = leak_sample32(data[i - 3], k - 1);
+        a3 = leak_sample32(data[i - 4], k - 2);
+        sum1 += absolute_residual(data[i], (signal)a0);
+        sum2 += absolute_residual(data[i], (signal)(2 * a0 - a1));
+        sum3 += absolute_residual(data[i], (signal)(3 * (a0 - a1) + a2));
+        sum4 += absolute_residual(data[i], (signal)(4 * (a0 + a2) - 6 * a1 - a3));
+    }
+
+    sums[1] += sum1;
+    sums[2] += sum2;
+    sums[3] += sum3;
+    sums[4] += sum4;
+}
 
 /*!
  * @brief               多項式予測器のハンドルを生成します。
@@ -22,7 +130,11 @@ polynomial_predictor* polynomial_predictor_create(signal* history) {
         return NULL;
     }
 
-    result->history = (signal*)calloc(POLYNOMIAL_PREDICATOR_MAX_HISTORY, sizeof(signal));
+    /* 過去サンプルは2回ずつ書き込み、連続した領域として読み出せるようにする */
+    result->history = (signal*)calloc(LSHIFT(POLYNOMIAL_PREDICATOR_MAX_HISTORY, 1), sizeof(signal));
+    result->position = 0;
+    result->order = POLYNOMIAL_PREDICTOR_DEFAULT_ORDER;
+    result->leak = POLYNOMIAL_PREDICTOR_DEFAULT_LEAK;
     return result;
 }
 
@@ -39,7 +151,33 @@ void polynomial_predictor_free(polynomial_predictor* predictor) {
  * @param *predictor    多項式予測器のハンドル
  */
 void polynomial_predictor_clear(polynomial_predictor* predictor) {
-    memset(predictor->history, 0, sizeof(signal) * POLYNOMIAL_PREDICATOR_MAX_HISTORY);
+    memset(predictor->history, 0, sizeof(signal) * LSHIFT(POLYNOMIAL_PREDICATOR_MAX_HISTORY, 1));
+    predictor->position = 0;
+    predictor->order = POLYNOMIAL_PREDICTOR_DEFAULT_ORDER;
+    predictor->leak = POLYNOMIAL_PREDICTOR_DEFAULT_LEAK;
+}
+
+/*!
+ * @brief               多項式予測器の状態を、別の多項式予測器に複製します。
+ * @param *dest         複製先の多項式予測器のハンドル
+ * @param *source       複製元の多項式予測器のハンドル
+ */
+void polynomial_predictor_copy(polynomial_predictor* dest, const polynomial_predictor* source) {
+    memcpy(dest->history, source->history, sizeof(signal) * LSHIFT(POLYNOMIAL_PREDICATOR_MAX_HISTORY, 1));
+    dest->position = source->position;
+    dest->order = source->order;
+    dest->leak = source->leak;
+}
+
+/*!
+ * @brief               多項式予測器の次数と減衰の度合いを設定します。過去サンプルは引き継がれます。
+ * @param *predictor    多項式予測器のハンドル
+ * @param order         次数（POLYNOMIAL_PREDICTOR_MAX_ORDER以下）
+ * @param leak          減衰の度合いの番号（POLYNOMIAL_PREDICTOR_NUM_LEAKS未満）
+ */
+void polynomial_predictor_set_parameters(polynomial_predictor* predictor, uint8_t order, uint8_t leak) {
+    predictor->order = order;
+    predictor->leak = leak;
 }
 
 /*!
@@ -48,7 +186,7 @@ void polynomial_predictor_clear(polynomial_predictor* predictor) {
  * @return              予測されたPCMサンプル
  */
 signal polynomial_predictor_predict(polynomial_predictor* predictor) {
-    return PREDICT2(predictor->history[0], predictor->history[1], K);
+    return predict(&predictor->history[predictor->position], predictor->order, leak_shifts[predictor->leak]);
 }
 
 /*!
@@ -57,6 +195,154 @@ signal polynomial_predictor_predict(polynomial_predictor* predictor) {
  * @param sample        PCMサンプル
  */
 void polynomial_predictor_update(polynomial_predictor* predictor, signal sample) {
-    memmove(&predictor->history[1], &predictor->history[0], (POLYNOMIAL_PREDICATOR_MAX_HISTORY - 1) * sizeof(signal));
-    predictor->history[0] = sample;
+    register uint32_t position = (predictor->position == 0 ? POLYNOMIAL_PREDICATOR_MAX_HISTORY : predictor->position) - 1;
+
+    predictor->history[position] = sample;
+    predictor->history[position + POLYNOMIAL_PREDICATOR_MAX_HISTORY] = sample;
+    predictor->position = position;
+}
+
+/*!
+ * @brief               多項式予測器の過去サンプルを取得します。
+ * @param *predictor    多項式予測器のハンドル
+ * @param *history      [出力]新しい順の過去サンプル（POLYNOMIAL_PREDICATOR_MAX_HISTORY個）
+ */
+void polynomial_predictor_get_history(const polynomial_predictor* predictor, signal* history) {
+    memcpy(history, &predictor->history[predictor->position], sizeof(signal) * POLYNOMIAL_PREDICATOR_MAX_HISTORY);
+}
+
+/*!
+ * @brief               多項式予測器の過去サンプルを設定します。
+ * @param *predictor    多項式予測器のハンドル
+ * @param *history      新しい順の過去サンプル（POLYNOMIAL_PREDICATOR_MAX_HISTORY個）
+ */
+void polynomial_predictor_set_history(polynomial_predictor* predictor, const signal* history) {
+    memcpy(&predictor->history[0], history, sizeof(signal) * POLYNOMIAL_PREDICATOR_MAX_HISTORY);
+    memcpy(&predictor->history[POLYNOMIAL_PREDICATOR_MAX_HISTORY], history, sizeof(signal) * POLYNOMIAL_PREDICATOR_MAX_HISTORY);
+    predictor->position = 0;
+}
+
+/*!
+ * @brief               サブブロックの信号を多項式予測器で予測し、予測残差に置き換えます。
+ * @param *predictor    多項式予測器のハンドル
+ * @param *data         [入出力]信号。予測残差で上書きされます。
+ * @param size          信号のサンプル数
+ */
+void polynomial_predictor_encode_block(polynomial_predictor* predictor, signal* data, uint32_t size) {
+    register uint32_t i;
+    register signal sample;
+    const uint8_t order = predictor->order;
+    const int32_t k = leak_shifts[predictor->leak];
+    signal history[POLYNOMIAL_PREDICATOR_MAX_HISTORY];
+
+    polynomial_predictor_get_history(predictor, history);
+
+    for (i = 0; i < size; ++i) {
+        sample = data[i];
+        data[i] = sample - predict(history, order, k);
+        push_history(history, sample);
+    }
+
+    polynomial_predictor_set_history(predictor, history);
+}
+
+/*!
+ * @brief               多項式予測器の予測残差から、サブブロックの信号を復元します。
+ * @param *predictor    多項式予測器のハンドル
+ * @param *data         [入出力]予測残差。復元された信号で上書きされます。
+ * @param size          信号のサンプル数
+ */
+void polynomial_predictor_decode_block(polynomial_predictor* predictor, signal* data, uint32_t size) {
+    register uint32_t i;
+    const uint8_t order = predictor->order;
+    const int32_t k = leak_shifts[predictor->leak];
+    signal history[POLYNOMIAL_PREDICATOR_MAX_HISTORY];
+
+    polynomial_predictor_get_history(predictor, history);
+
+    for (i = 0; i < size; ++i) {
+        data[i] += predict(history, order, k);
+        push_history(history, data[i]);
+    }
+
+    polynomial_predictor_set_history(predictor, history);
+}
+
+/*!
+ * @brief               サブブロックの信号を指定された次数と減衰の度合いで予測した場合の予測残差の絶対値の合計を、過去サンプルを更新せずに求めます。
+ * @param *predictor    多項式予測器のハンドル
+ * @param order         次数（POLYNOMIAL_PREDICTOR_MAX_ORDER以下）
+ * @param leak          減衰の度合いの番号（POLYNOMIAL_PREDICTOR_NUM_LEAKS未満）
+ * @param *data         信号
+ * @param size          信号のサンプル数
+ * @return              予測残差の絶対値の合計
+ */
+uint64_t polynomial_predictor_compute_residual_sum(const polynomial_predictor* predictor, uint8_t order, uint8_t leak, const signal* data, uint32_t size) {
+    register uint32_t i;
+    const int32_t k = leak_shifts[leak];
+    uint64_t sum = 0;
+    signal history[POLYNOMIAL_PREDICATOR_MAX_HISTORY];
+
+    polynomial_predictor_get_history(predictor, history);
+
+    for (i = 0; i < size; ++i) {
+        sum += absolute_residual(data[i], predict(history, order, k));
+        push_history(history, data[i]);
+    }
+
+    return sum;
+}
+
+/*!
+ * @brief               サブブロックの信号に適した多項式予測器の次数と減衰の度合いを、予測残差の絶対値の合計から選びます。
+ * @param *predictor    多項式予測器のハンドル
+ * @param *data         信号
+ * @param size          信号のサンプル数
+ * @param *order        [出力]選ばれた次数
+ * @param *leak         [出力]選ばれた減衰の度合いの番号
+ * @return              選ばれた次数と減衰の度合いでの予測残差の絶対値の合計
+ * @note                予測残差の絶対値の合計が最も小さい組み合わせを選びます。合計が等しければ既定の組み合わせ、次数の低いものの順に優先します。
+ *                      すべての組み合わせの合計は、信号を1度走査するだけで求めます。
+ */
+uint64_t polynomial_predictor_select_parameters(const polynomial_predictor* predictor, const signal* data, uint32_t size, uint8_t* order, uint8_t* leak) {
+    register uint32_t i;
+    register uint8_t candidate_order, candidate_leak;
+    uint32_t head_size = (size < POLYNOMIAL_PREDICATOR_MAX_HISTORY) ? size : POLYNOMIAL_PREDICATOR_MAX_HISTORY;
+    uint64_t sums[POLYNOMIAL_PREDICTOR_NUM_LEAKS][POLYNOMIAL_PREDICTOR_MAX_ORDER + 1];
+    uint64_t best_sum;
+    signal head[LSHIFT(POLYNOMIAL_PREDICATOR_MAX_HISTORY, 1)];
+
+    memset(sums, 0, sizeof(sums));
+
+    /* 先頭のサンプルは、保持している過去サンプルに続けた時間順の信号として予測する */
+    for (i = 0; i < POLYNOMIAL_PREDICATOR_MAX_HISTORY; ++i) {
+        head[i] = predictor->history[predictor->position + POLYNOMIAL_PREDICATOR_MAX_HISTORY - 1 - i];
+    }
+    memcpy(&head[POLYNOMIAL_PREDICATOR_MAX_HISTORY], data, sizeof(signal) * head_size);
+
+    /* 次数0は過去サンプルを用いないため、減衰の度合いを選ばない */
+    for (i = 0; i < size; ++i) {
+        sums[0][0] += absolute_residual(data[i], 0);
+    }
+
+    for (candidate_leak = 0; candidate_leak < POLYNOMIAL_PREDICTOR_NUM_LEAKS; ++candidate_leak) {
+        accumulate_absolute_residuals(sums[candidate_leak], head, POLYNOMIAL_PREDICATOR_MAX_HISTORY, POLYNOMIAL_PREDICATOR_MAX_HISTORY + head_size, leak_shifts[candidate_leak]);
+        accumulate_absolute_residuals(sums[candidate_leak], data, head_size, size, leak_shifts[candidate_leak]);
+    }
+
+    *order = POLYNOMIAL_PREDICTOR_DEFAULT_ORDER;
+    *leak = POLYNOMIAL_PREDICTOR_DEFAULT_LEAK;
+    best_sum = sums[POLYNOMIAL_PREDICTOR_DEFAULT_LEAK][POLYNOMIAL_PREDICTOR_DEFAULT_ORDER];
+
+    for (candidate_order = 0; candidate_order <= POLYNOMIAL_PREDICTOR_MAX_ORDER; ++candidate_order) {
+        for (candidate_leak = 0; candidate_leak < ((candidate_order == 0) ? 1 : POLYNOMIAL_PREDICTOR_NUM_LEAKS); ++candidate_leak) {
+            if (sums[candidate_leak][candidate_order] < best_sum) {
+                best_sum = sums[candidate_leak][candidate_order];
+                *order = candidate_order;
+                *leak = candidate_leak;
+            }
+        }
+    }
+
+    return best_sum;
 }
\ No newline at end of file
@@ -0,0 +1,250 @@
+#include "./include/bit_stream.h"
+#include "./include/macro.h"
+#include "./include/range_coder.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/*!
+ * @brief           保留しているバイトを確定させ、区間の下端の最上位バイトを送り出します。
+ * @param *coder    レンジコーダのハンドル
+ * @note            区間の下端が桁上がりする可能性がある間は、0xFFが続くバイト列をまとめて保留します。
+ */
+static inline void shift_low(range_coder* coder) {
+    register uint8_t carry;
+    register uint8_t byte;
+
+    if ((uint32_t)coder->low < 0xFF000000 || RSHIFT(coder->low, 32) != 0) {
+        carry = (uint8_t)RSHIFT(coder->low, 32);
+        byte = coder->cache;
+
+        do {
+            bit_stream_write_uint(coder->bitstream, (uint8_t)(byte + carry), 8);
+            byte = 0xFF;
+        } while (--coder->cache_size != 0);
+
+        coder->cache = (uint8_t)RSHIFT(coder->low, 24);
+    }
+
+    coder->cache_size++;
+    coder->low = LSHIFT(coder->low & 0x00FFFFFF, 8);
+}
+
+/*!
+ * @brief           レンジコーダのハンドルを生成します。
+ * @param *stream   ビットストリームのハンドル
+ * @return          レンジコーダのハンドル
+ */
+range_coder* range_coder_create(bit_stream* stream) {
+    range_coder* result = (range_coder*)calloc(1, sizeof(range_coder));
+    uint32_t i;
+
+    if (result == NULL) {
+        return NULL;
+    }
+
+    result->bitstream = stream;
+    result->costs = (uint16_t*)malloc(sizeof(uint16_t) * LSHIFT(1, RANGE_CODER_COST_TABLE_BITS));
+
+    /* 符号長の見積もりは、量子化した確率の区間の中央の値から求める */
+    if (result->costs != NULL) {
+        for (i = 0; i < LSHIFT(1, RANGE_CODER_COST_TABLE_BITS); ++i) {
+            result->costs[i] = (uint16_t)(-log2((i + 0.5) / LSHIFT(1, RANGE_CODER_COST_TABLE_BITS)) * LSHIFT(1, RANGE_CODER_COST_FRACTION_BITS) + 0.5);
+        }
+    }
+
+    return result;
+}
+
+/*!
+ * @brief           レンジコーダを解放します。
+ * @param *coder    レンジコーダのハンドル
+ */
+void range_coder_free(range_coder* coder) {
+    free(coder->costs);
+    free(coder);
+}
+
+/*!
+ * @brief                   確率を初期値で初期化します。
+ * @param *probabilities    確率を格納する領域
+ * @param count             確率の個数
+ */
+void range_coder_init_probabilities(range_coder_probability* probabilities, uint32_t count) {
+    uint32_t i;
+
+    for (i = 0; i < count; ++i) {
+        probabilities[i] = RANGE_CODER_PROBABILITY_INITIAL;
+    }
+}
+
+/*!
+ * @brief           符号化を開始します。
+ * @param *coder    レンジコーダのハンドル
+ */
+void range_coder_start_encode(range_coder* coder) {
+    coder->low = 0;
+    coder->range = 0xFFFFFFFF;
+    coder->cache = 0;
+    coder->cache_size = 1;
+}
+
+/*!
+ * @brief                   1ビットを、適応的に更新される確率を用いて符号化します。
+ * @param *coder            レンジコーダのハンドル
+ * @param *probability      このビットの文脈に対応する確率（符号化後に更新されます）
+ * @param bit               符号化するビット（0または1）
+ */
+void range_coder_encode_bit(range_coder* coder, range_coder_probability* probability, uint32_t bit) {
+    register uint32_t bound = RSHIFT(coder->range, RANGE_CODER_PROBABILITY_BITS) * (*probability);
+
+    if (bit == 0) {
+        coder->range = bound;
+        *probability += RSHIFT(LSHIFT(1, RANGE_CODER_PROBABILITY_BITS) - *probability, RANGE_CODER_ADAPTATION_SHIFT);
+    }
+    else {
+        coder->low += bound;
+        coder->range -= bound;
+        *probability -= RSHIFT(*probability, RANGE_CODER_ADAPTATION_SHIFT);
+    }
+
+    while (coder->range < RANGE_CODER_TOP_VALUE) {
+        coder->range = LSHIFT(coder->range, 8);
+        shift_low(coder);
+    }
+}
+
+/*!
+ * @brief           任意ビット数の値を、各ビットが等確率であるものとして符号化します。
+ * @param *coder    レンジコーダのハンドル
+ * @param value     符号化する値
+ * @param num_bits  ビット数（32以下）
+ */
+void range_coder_encode_direct_bits(range_coder* coder, uint32_t value, uint32_t num_bits) {
+    register uint32_t chunk_bits;
+
+    /* 区間幅は正規化後に2^24以上あるため、RANGE_CODER_DIRECT_CHUNK_BITSビットずつまとめて区間を分割できる */
+    while (num_bits > 0) {
+        chunk_bits = (num_bits < RANGE_CODER_DIRECT_CHUNK_BITS) ? num_bits : RANGE_CODER_DIRECT_CHUNK_BITS;
+        num_bits -= chunk_bits;
+        coder->range = RSHIFT(coder->range, chunk_bits);
+        coder->low += (uint64_t)coder->range * (RSHIFT(value, num_bits) & (LSHIFT(1U, chunk_bits) - 1));
+
+        while (coder->range < RANGE_CODER_TOP_VALUE) {
+            coder->range = LSHIFT(coder->range, 8);
+            shift_low(coder);
+        }
+    }
+}
+
+/*!
+ * @brief                   1ビットを符号化した場合の符号長を見積もり、符号化した場合と同じく確率を更新します。
+ * @param *coder            レンジコーダのハンドル
+ * @param *probability      このビットの文脈に対応する確率（見積もり後に更新されます）
+ * @param bit               符号化するビット（0または1）
+ * @return                  符号長（1/2^RANGE_CODER_COST_FRACTION_BITSビット単位）
+ */
+uint32_t range_coder_estimate_bit(const range_coder* coder, range_coder_probability* probability, uint32_t bit) {
+    register uint32_t cost;
+
+    if (bit == 0) {
+        cost = coder->costs[RSHIFT(*probability, RANGE_CODER_PROBABILITY_BITS - RANGE_CODER_COST_TABLE_BITS)];
+        *probability += RSHIFT(LSHIFT(1, RANGE_CODER_PROBABILITY_BITS) - *probability, RANGE_CODER_ADAPTATION_SHIFT);
+    }
+    else {
+        cost = coder->costs[RSHIFT(LSHIFT(1, RANGE_CODER_PROBABILITY_BITS) - *probability, RANGE_CODER_PROBABILITY_BITS - RANGE_CODER_COST_TABLE_BITS)];
+        *probability -= RSHIFT(*probability, RANGE_CODER_ADAPTATION_SHIFT);
+    }
+
+    return cost;
+}
+
+/*!
+ * @brief           符号化を終了し、保留しているデータをすべてビットストリームに書き込みます。
+ * @param *coder    レンジコーダのハンドル
+ */
+void range_coder_finish_encode(range_coder* coder) {
+    uint32_t i;
+
+    for (i = 0; i < RANGE_CODER_HEAD_BYTES; ++i) {
+        shift_low(coder);
+    }
+}
+
+/*!
+ * @brief           復号を開始します。
+ * @param *coder    レンジコーダのハンドル
+ */
+void range_coder_start_decode(range_coder* coder) {
+    uint32_t i;
+
+    coder->range = 0xFFFFFFFF;
+    coder->code = 0;
+
+    /* 先頭のバイトは符号化開始時に保留されていたゼロであり、32ビットからあふれて捨てられる */
+    for (i = 0; i < RANGE_CODER_HEAD_BYTES; ++i) {
+        coder->code = LSHIFT(coder->code, 8) | bit_stream_read_uint(coder->bitstream, 8);
+    }
+}
+
+/*!
+ * @brief                   1ビットを、適応的に更新される確率を用いて復号します。
+ * @param *coder            レンジコーダのハンドル
+ * @param *probability      このビットの文脈に対応する確率（復号後に更新されます）
+ * @return                  復号されたビット（0または1）
+ */
+uint32_t range_coder_decode_bit(range_coder* coder, range_coder_probability* probability) {
+    register uint32_t bound = RSHIFT(coder->range, RANGE_CODER_PROBABILITY_BITS) * (*probability);
+    register uint32_t bit;
+
+    if (coder->code < bound) {
+        coder->range = bound;
+        *probability += RSHIFT(LSHIFT(1, RANGE_CODER_PROBABILITY_BITS) - *probability, RANGE_CODER_ADAPTATION_SHIFT);
+        bit = 0;
+    }
+    else {
+        coder->code -= bound;
+        coder->range -= bound;
+        *probability -= RSHIFT(*probability, RANGE_CODER_ADAPTATION_SHIFT);
+        bit = 1;
+    }
+
+    while (coder->range < RANGE_CODER_TOP_VALUE) {
+        coder->range = LSHIFT(coder->range, 8);
+        coder->code = LSHIFT(coder->code, 8) | bit_stream_read_uint(coder->bitstream, 8);
+    }
+
+    return bit;
+}
+
+/*!
+ * @brief           各ビットが等確率であるものとして符号化された、任意ビット数の値を復号します。
+ * @param *coder    レンジコーダのハンドル
+ * @param num_bits  ビット数（32以下）
+ * @return          復号された値
+ */
+uint32_t range_coder_decode_direct_bits(range_coder* coder, uint32_t num_bits) {
+    register uint32_t value = 0;
+    register uint32_t chunk_bits;
+    register uint32_t chunk;
+
+    while (num_bits > 0) {
+        chunk_bits = (num_bits < RANGE_CODER_DIRECT_CHUNK_BITS) ? num_bits : RANGE_CODER_DIRECT_CHUNK_BITS;
+        num_bits -= chunk_bits;
+        coder->range = RSHIFT(coder->range, chunk_bits);
+        chunk = coder->code / coder->range;
+        /* 壊れたデータで区間の端数に入った場合も、値の範囲に収める */
+        if (chunk >= LSHIFT(1U, chunk_bits)) {
+            chunk = LSHIFT(1U, chunk_bits) - 1;
+        }
+        coder->code -= chunk * coder->range;
+        value = LSHIFT(value, chunk_bits) | chunk;
+
+        while (coder->range < RANGE_CODER_TOP_VALUE) {
+            coder->range = LSHIFT(coder->range, 8);
+            coder->code = LSHIFT(coder->code, 8) | bit_stream_read_uint(coder->bitstream, 8);
+        }
+    }
+
+    return value;
+}
\ No newline at end of file
@@ -0,0 +1,221 @@
+#include "./include/macro.h"
+#include "./include/simd.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(SIMD_X86)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#pragma region CPUの機能の判定
+
+/*!
+ * @brief           実行中のCPUで使用可能なSIMD命令を判定します。
+ * @return          使用可能なSIMD命令を表すフラグ（SIMD_CPU_FEATURE_*の論理和）
+ */
+static uint32_t detect_cpu_features() {
+    uint32_t features = 0;
+
+#if defined(SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.1")) {
+        features |= SIMD_CPU_FEATURE_SSE41;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        features |= SIMD_CPU_FEATURE_AVX2;
+    }
+#elif defined(SIMD_X86) && defined(_MSC_VER)
+    int info[4];
+    int max_leaf;
+
+    __cpuid(info, 0);
+    max_leaf = info[0];
+
+    __cpuid(info, 1);
+    if (info[2] & (1 << 19)) {
+        features |= SIMD_CPU_FEATURE_SSE41;
+    }
+
+    /* AVX2は、OSがYMMレジスタの退避に対応している場合に限り使用可能 */
+    if (max_leaf >= 7 && (info[2] & (1 << 27)) && (_xgetbv(0) & 0x06) == 0x06) {
+        __cpuidex(info, 7, 0);
+        if (info[1] & (1 << 5)) {
+            features |= SIMD_CPU_FEATURE_AVX2;
+        }
+    }
+#endif
+
+    return features;
+}
+
+/*!
+ * @brief           実行中のCPUで使用可能なSIMD命令を取得します。判定結果は初回の呼び出し時に保持されます。
+ * @return          使用可能なSIMD命令を表すフラグ（SIMD_CPU_FEATURE_*の論理和）
+ */
+uint32_t simd_get_cpu_features() {
+    static uint32_t features = 0;
+    static bool is_detected = false;
+
+    if (!is_detected) {
+        features = detect_cpu_features();
+        is_detected = true;
+    }
+
+    return features;
+}
+
+#pragma endregion
+
+#pragma region 符号なし整数に変換した値の統計量
+
+/*!
+ * @brief           値を符号なし整数に変換した値の統計量を、1要素ずつ求めます。
+ * @param *data     データのポインタ
+ * @param size      データのサイズ
+ * @param *stats    [入出力]統計量。求めた値が加算されます。
+ */
+static void compute_zigzag_stats_scalar(const signal* data, uint32_t size, zigzag_stats* stats) {
+    register uint32_t i;
+    register uint32_t value;
+    register uint64_t sum = stats->sum;
+    register uint32_t mask = stats->mask;
+    register uint32_t num_zeros = stats->num_zeros;
+
+    for (i = 0; i < size; ++i) {
+        value = CONVERT_INT32_TO_UINT32(data[i]);
+        sum += value;
+        mask |= value;
+        num_zeros += (value == 0);
+    }
+
+    stats->sum = sum;
+    stats->mask = mask;
+    stats->num_zeros = num_zeros;
+}
+
+#if defined(SIMD_X86)
+
+/*!
+ * @brief           値を符号なし整数に変換した値の統計量を、SSE4.1命令で4要素ずつ求めます。
+ * @param *data     データのポインタ
+ * @param size      データのサイズ
+ * @param *stats    [入出力]統計量。求めた値が加算されます。
+ */
+SIMD_TARGET_SSE41 static void compute_zigzag_stats_sse41(const signal* data, uint32_t size, zigzag_stats* stats) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = zero, mask = zero, zeros = zero;
+    __m128i x, z;
+    uint64_t sums[2];
+    uint32_t masks[4], counts[4];
+    uint32_t i;
+
+    for (i = 0; i + 4 <= size; i += 4) {
+        x = _mm_loadu_si128((const __m128i*)&data[i]);
+        z = _mm_xor_si128(_mm_slli_epi32(x, 1), _mm_srai_epi32(x, 31));
+
+        mask = _mm_or_si128(mask, z);
+        zeros = _mm_sub_epi32(zeros, _mm_cmpeq_epi32(x, zero));     /* 一致した要素は-1になる */
+        sum = _mm_add_epi64(sum, _mm_cvtepu32_epi64(z));
+        sum = _mm_add_epi64(sum, _mm_cvtepu32_epi64(_mm_srli_si128(z, 8)));
+    }
+
+    _mm_storeu_si128((__m128i*)sums, sum);
+    _mm_storeu_si128((__m128i*)masks, mask);
+    _mm_storeu_si128((__m128i*)counts, zeros);
+    stats->sum += sums[0] + sums[1];
+    stats->mask |= masks[0] | masks[1] | masks[2] | masks[3];
+    stats->num_zeros += counts[0] + counts[1] + counts[2] + counts[3];
+
+    compute_zigzag_stats_scalar(&data[i], size - i, stats);
+}
+
+/*!
+ * @brief           値を符号なし整数に変換した値の統計量を、AVX2命令で8要素ずつ求めます。
+ * @param *data     データのポインタ
+ * @param size      データのサイズ
+ * @param *stats    [入出力]統計量。求めた値が加算されます。
+ */
+SIMD_TARGET_AVX2 static void compute_zigzag_stats_avx2(const signal* data, uint32_t size, zigzag_stats* stats) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i sum = zero, mask = zero, zeros = zero;
+    __m256i x, z;
+    uint64_t sums[4];
+    uint32_t masks[8], counts[8];
+    uint32_t i, j;
+
+    for (i = 0; i + 8 <= size; i += 8) {
+        x = _mm256_loadu_si256((const __m256i*)&data[i]);
+        z = _mm256_xor_si256(_mm256_slli_epi32(x, 1), _mm256_srai_epi32(x, 31));
+
+        mask = _mm256_or_si256(mask, z);
+        zeros = _mm256_sub_epi32(zeros, _mm256_cmpeq_epi32(x, zero));  /* 一致した要素は-1になる */
+        sum = _mm256_add_epi64(sum, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(z)));
+        sum = _mm256_add_epi64(sum, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(z, 1)));
+    }
+
+    _mm256_storeu_si256((__m256i*)sums, sum);
+    _mm256_storeu_si256((__m256i*)masks, mask);
+    _mm256_storeu_si256((__m256i*)counts, zeros);
+    for (j = 0; j < 4; ++j) {
+        stats->sum += sums[j];
+    }
+    for (j = 0; j < 8; ++j) {
+        stats->mask |= masks[j];
+        stats->num_zeros += counts[j];
+    }
+
+    /* 8要素に満たない残りはスカラーで処理する。SSE4.1命令の実装を呼ぶと、YMMレジスタの上位が使用中のまま
+       VEXでないSSE命令に切り替わり、その遅延が残りの処理より大きくなる */
+    compute_zigzag_stats_scalar(&data[i], size - i, stats);
+}
+
+#endif
+
+static void resolve_zigzag_stats(const signal* data, uint32_t size, zigzag_stats* stats);
+
+/* 使用する実装。初回の呼び出し時に、CPUの機能に応じた実装に置き換えられる */
+static void (*zigzag_stats_function)(const signal* data, uint32_t size, zigzag_stats* stats) = resolve_zigzag_stats;
+
+/*!
+ * @brief           実行中のCPUに応じた実装を選び、以降はその実装を直接呼び出すようにします。
+ * @param *data     データのポインタ
+ * @param size      データのサイズ
+ * @param *stats    [入出力]統計量。求めた値が加算されます。
+ */
+static void resolve_zigzag_stats(const signal* data, uint32_t size, zigzag_stats* stats) {
+    uint32_t features = simd_get_cpu_features();
+
+    zigzag_stats_function = compute_zigzag_stats_scalar;
+#if defined(SIMD_X86)
+    if (features & SIMD_CPU_FEATURE_AVX2) {
+        zigzag_stats_function = compute_zigzag_stats_avx2;
+    }
+    else if (features & SIMD_CPU_FEATURE_SSE41) {
+        zigzag_stats_function = compute_zigzag_stats_sse41;
+    }
+#else
+    (void)features;
+#endif
+
+    zigzag_stats_function(data, size, stats);
+}
+
+/*!
+ * @brief           値を符号なし整数に変換した値の合計・論理和と、ゼロである値の個数を、データを1回走査して求めます。
+ * @param *data     データのポインタ
+ * @param size      データのサイズ
+ * @param *stats    [出力]求めた統計量
+ * @note            実行中のCPUで使用可能な最も高速な実装が、初回の呼び出し時に選ばれます。
+ */
+void simd_compute_zigzag_stats(const signal* data, uint32_t size, zigzag_stats* stats) {
+    stats->sum = 0;
+    stats->mask = 0;
+    stats->num_zeros = 0;
+
+    zigzag_stats_function(data, size, stats);
+}
+
+#pragma endregion
\ No newline at end of file
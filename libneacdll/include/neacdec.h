@@ -14,6 +14,14 @@ typedef uint8_t* BYTEPTR;
 */
 HDECODER __declspec(dllexport) CreateDecoder(LPCSTR path);
 
+/*!
+* @brief            メモリ上のデータをデコードするデコーダのハンドルを返します。データはコピーされません。
+* @param data       デコードするデータのポインタ。デコーダを解放するまで有効である必要があります。
+* @param size       デコードするデータのバイト数
+* @return           デコーダのハンドル
+*/
+HDECODER __declspec(dllexport) CreateDecoderFromMemory(const BYTEPTR data, size_t size);
+
 /*!
 * @brief            指定されたハンドルのデコーダを解放します。
 * @param decoder    デコーダのハンドル
@@ -6,6 +6,12 @@
 
 typedef neac_encoder* HENCODER;
 
+/*!
+ * @brief 拡張版のエンコーダ生成関数に渡す、追加の設定です。
+ * @note  size には sizeof(NEAC_ENCODER_OPTIONS) を設定してください。size に含まれないメンバは既定値として扱われます。
+ */
+typedef neac_encoder_options NEAC_ENCODER_OPTIONS;
+
 /*!
  * @brief                           指定された設定で、エンコーダのハンドルを生成します。
  * @param output                    出力先のファイルのパス
@@ -52,6 +58,79 @@ HENCODER __declspec(dllexport) CreateEncoderFromFile(
     uint8_t filter_taps,
     neac_tag* tag);
 
+/*!
+ * @brief                           指定された設定と追加の設定で、エンコーダのハンドルを生成します。
+ * @param output                    出力先のファイルのパス
+ * @param sample_rate               サンプリング周波数
+ * @param bits_per_sample           量子化ビット数
+ * @param num_channels              チャンネル数
+ * @param num_samples               合計サンプル数
+ * @param block_size                ブロックサイズ
+ * @param use_mid_side_stereo       ミッドサイドステレオを使用するかどうかを示すフラグ
+ * @param filter_taps               LMSフィルタのタップ数
+ * @param *options                  追加の設定（NULLの場合はすべて既定値）
+ * @param *tag                      タグ情報
+ */
+HENCODER __declspec(dllexport) CreateEncoderFromPathEx(
+    LPCSTR output,
+    uint32_t sample_rate,
+    uint8_t bits_per_sample,
+    uint8_t num_channels,
+    uint32_t num_samples,
+    uint16_t block_size,
+    bool use_mid_side_stereo,
+    uint8_t filter_taps,
+    const NEAC_ENCODER_OPTIONS* options,
+    neac_tag* tag);
+
+/*!
+ * @brief                           指定された設定と追加の設定で、エンコーダのハンドルを生成します。
+ * @param *file                     出力先のファイルハンドル
+ * @param sample_rate               サンプリング周波数
+ * @param bits_per_sample           量子化ビット数
+ * @param num_channels              チャンネル数
+ * @param num_samples               合計サンプル数
+ * @param block_size                ブロックサイズ
+ * @param use_mid_side_stereo       ミッドサイドステレオを使用するかどうかを示すフラグ
+ * @param filter_taps               LMSフィルタのタップ数
+ * @param *options                  追加の設定（NULLの場合はすべて既定値）
+ * @param *tag                      タグ情報
+ */
+HENCODER __declspec(dllexport) CreateEncoderFromFileEx(
+    FILE* file,
+    uint32_t sample_rate,
+    uint8_t bits_per_sample,
+    uint8_t num_channels,
+    uint32_t num_samples,
+    uint16_t block_size,
+    bool use_mid_side_stereo,
+    uint8_t filter_taps,
+    const NEAC_ENCODER_OPTIONS* options,
+    neac_tag* tag);
+
+/*!
+ * @brief                           指定された設定と追加の設定で、メモリ上に出力するエンコーダのハンドルを生成します。
+ * @param sample_rate               サンプリング周波数
+ * @param bits_per_sample           量子化ビット数
+ * @param num_channels              チャンネル数
+ * @param num_samples               合計サンプル数
+ * @param block_size                ブロックサイズ
+ * @param use_mid_side_stereo       ミッドサイドステレオを使用するかどうかを示すフラグ
+ * @param filter_taps               LMSフィルタのタップ数
+ * @param *options                  追加の設定（NULLの場合はすべて既定値）
+ * @param *tag                      タグ情報
+ */
+HENCODER __declspec(dllexport) CreateEncoderFromMemoryEx(
+    uint32_t sample_rate,
+    uint8_t bits_per_sample,
+    uint8_t num_channels,
+    uint32_t num_samples,
+    uint16_t block_size,
+    bool use_mid_side_stereo,
+    uint8_t filter_taps,
+    const NEAC_ENCODER_OPTIONS* options,
+    neac_tag* tag);
+
 /*!
  * @brief           エンコーダを解放します。
  * @param encoder   エンコーダのハンドル
@@ -71,4 +150,12 @@ void __declspec(dllexport) EncoderWriteSample(HENCODER encoder, int32_t sample);
  */
 void __declspec(dllexport) EncoderEndWrite(HENCODER encoder);
 
+/*!
+ * @brief           メモリ上に出力するエンコーダで、エンコードされたデータを取得します。EncoderEndWrite の呼び出し後に使用してください。
+ * @param encoder   エンコーダのハンドル
+ * @param *size     [出力]エンコードされたデータのバイト数
+ * @return          エンコードされたデータのポインタ。エンコーダを解放するまで有効です。
+ */
+const uint8_t* __declspec(dllexport) EncoderGetOutputMemory(HENCODER encoder, size_t* size);
+
 #endif
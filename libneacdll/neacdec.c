@@ -6,6 +6,11 @@ HDECODER CreateDecoder(LPCSTR path) {
     return neac_decoder_create(path);
 }
 
+HDECODER CreateDecoderFromMemory(const BYTEPTR data, size_t size) {
+    set_on_error_exit(false);
+    return neac_decoder_create_from_memory(data, size);
+}
+
 void DecoderCloseFile(HDECODER decoder) {
     if (decoder != NULL) {
         neac_decoder_close(decoder);
@@ -11,8 +11,7 @@ HENCODER CreateEncoderFromPath(
     bool use_mid_side_stereo,
     uint8_t filter_taps,
     neac_tag* tag) {
-    set_on_error_exit(false);
-    return neac_encoder_create_from_path(
+    return CreateEncoderFromPathEx(
         output,
         sample_rate,
         bits_per_sample,
@@ -21,6 +20,7 @@ HENCODER CreateEncoderFromPath(
         block_size,
         use_mid_side_stereo,
         filter_taps,
+        NULL,
         tag);
 }
 
@@ -34,8 +34,57 @@ HENCODER CreateEncoderFromFile(
     bool use_mid_side_stereo,
     uint8_t filter_taps,
     neac_tag* tag) {
+    return CreateEncoderFromFileEx(
+        file,
+        sample_rate,
+        bits_per_sample,
+        num_channels,
+        num_samples,
+        block_size,
+        use_mid_side_stereo,
+        filter_taps,
+        NULL,
+        tag);
+}
+
+HENCODER CreateEncoderFromPathEx(
+    LPCSTR output,
+    uint32_t sample_rate,
+    uint8_t bits_per_sample,
+    uint8_t num_channels,
+    uint32_t num_samples,
+    uint16_t block_size,
+    bool use_mid_side_stereo,
+    uint8_t filter_taps,
+    const NEAC_ENCODER_OPTIONS* options,
+    neac_tag* tag) {
     set_on_error_exit(false);
-    return neac_encoder_create(
+    return neac_encoder_create_from_path_ex(
+        output,
+        sample_rate,
+        bits_per_sample,
+        num_channels,
+        num_samples,
+        block_size,
+        use_mid_side_stereo,
+        filter_taps,
+        options,
+        tag);
+}
+
+HENCODER CreateEncoderFromFileEx(
+    FILE* file,
+    uint32_t sample_rate,
+    uint8_t bits_per_sample,
+    uint8_t num_channels,
+    uint32_t num_samples,
+    uint16_t block_size,
+    bool use_mid_side_stereo,
+    uint8_t filter_taps,
+    const NEAC_ENCODER_OPTIONS* options,
+    neac_tag* tag) {
+    set_on_error_exit(false);
+    return neac_encoder_create_ex(
         file,
         sample_rate,
         bits_per_sample,
@@ -44,6 +93,30 @@ HENCODER CreateEncoderFromFile(
         block_size,
         use_mid_side_stereo,
         filter_taps,
+        options,
+        tag);
+}
+
+HENCODER CreateEncoderFromMemoryEx(
+    uint32_t sample_rate,
+    uint8_t bits_per_sample,
+    uint8_t num_channels,
+    uint32_t num_samples,
+    uint16_t block_size,
+    bool use_mid_side_stereo,
+    uint8_t filter_taps,
+    const NEAC_ENCODER_OPTIONS* options,
+    neac_tag* tag) {
+    set_on_error_exit(false);
+    return neac_encoder_create_from_memory_ex(
+        sample_rate,
+        bits_per_sample,
+        num_channels,
+        num_samples,
+        block_size,
+        use_mid_side_stereo,
+        filter_taps,
+        options,
         tag);
 }
 
@@ -58,4 +131,8 @@ void EncoderWriteSample(HENCODER encoder, int32_t sample) {
 
 void EncoderEndWrite(HENCODER encoder) {
     neac_encoder_end_write(encoder);
+}
+
+const uint8_t* EncoderGetOutputMemory(HENCODER encoder, size_t* size) {
+    return neac_encoder_get_output_memory(encoder, size);
 }
\ No newline at end of file
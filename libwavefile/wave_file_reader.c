@@ -240,6 +240,9 @@ int32_t wave_file_reader_read_sample(wave_file_reader* reader) {
         sb3 = read_uint8(reader->wave_file);
         result = (sb3 << 16) | (sb2 << 8) | sb1;
         break;
+    case 32:
+        result = (int32_t)read_uint32(reader->wave_file);
+        break;
     default:
         break;
     }
@@ -217,6 +217,9 @@ void wave_file_writer_begin_write(const wave_file_writer* writer) {
 void wave_file_writer_write_sample(const wave_file_writer* writer, int32_t sample) {
     switch (writer->bits_per_sample)
     {
+    case 8:
+        write_char(writer->wave_file, (char)((sample + 128) & 0xFF));
+        break;
     case 16:
         write_int16(writer->wave_file, (int16_t)sample);
         break;
@@ -225,6 +228,9 @@ void wave_file_writer_write_sample(const wave_file_writer* writer, int32_t sampl
         write_char(writer->wave_file, (char)(sample >> 8) & 0xFF);
         write_char(writer->wave_file, (char)(sample >> 16) & 0xFF);
         break;
+    case 32:
+        write_uint32(writer->wave_file, (uint32_t)sample);
+        break;
     }
 }
 
@@ -14,6 +14,10 @@ static bool is_silent_mode = false;
 static bool is_help_mode = false;
 static uint16_t block_size = 1024;
 static uint8_t filter_taps = 4;
+static uint8_t entropy_mode = ENTROPY_MODE_DEFAULT;
+static uint16_t cascade_taps[LMS_CASCADE_MAX_STAGES];
+static uint8_t num_cascade_stages = 0;
+static uint8_t lpc_order = 0;
 
 static const char* tag_title;
 static const char* tag_album;
@@ -36,6 +40,31 @@ static const char* tag_picture_path;
 
 static bool has_tag = false;
 
+/*!
+ * @brief               カンマ区切りで指定された、多段のLMSフィルタの各段のタップ数を解析します。
+ * @param *arg          引数（例: "256,32"）
+ */
+static void parse_cascade_taps(const char* arg) {
+    char* end;
+    long taps;
+
+    num_cascade_stages = 0;
+
+    while (*arg != '\0' && num_cascade_stages < LMS_CASCADE_MAX_STAGES) {
+        taps = strtol(arg, &end, 10);
+
+        if (end == arg) {
+            break;
+        }
+
+        if (taps > 0) {
+            cascade_taps[num_cascade_stages++] = (uint16_t)(taps > LMS_CASCADE_MAX_TAPS ? LMS_CASCADE_MAX_TAPS : taps);
+        }
+
+        arg = (*end == ',') ? end + 1 : end;
+    }
+}
+
 /*!
  * @brief               コマンドライン引数を解析します。
  * @param argc          引数の数
@@ -55,6 +84,24 @@ static void parse_commandline_args(int argc, char* argv[]) {
             filter_taps = atoi(argv[i + 1]);
             ++i;
         }
+        else if (strcmp(argv[i], "--entropy") == 0 || strcmp(argv[i], "--entropy-mode") == 0) {
+            ++i;
+            if (strcmp(argv[i], "adaptive") == 0) {
+                entropy_mode = ENTROPY_MODE_ADAPTIVE_RICE;
+            }
+            else if (strcmp(argv[i], "range") == 0) {
+                entropy_mode = ENTROPY_MODE_RANGE_CODER;
+            }
+            else {
+                entropy_mode = ENTROPY_MODE_PARTITIONED_RICE;
+            }
+        }
+        else if (strcmp(argv[i], "--cascade") == 0 || strcmp(argv[i], "--lms-cascade") == 0) {
+            parse_cascade_taps(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--lpc") == 0 || strcmp(argv[i], "--lpc-order") == 0) {
+            lpc_order = atoi(argv[++i]);
+        }
         else if (strcmp(argv[i], "--in") == 0 || strcmp(argv[i], "--input") == 0) {
             input_file_path = argv[++i];
         }
@@ -206,6 +253,9 @@ static void print_usage() {
     printf("Options:\n");
     printf("    --bs|--blocksize            Specify the number of samples per block. (default = 1024)\n");
     printf("    --taps|--filter-taps        Specify the LMS adaptive filter taps between 1 and 32.\n");
+    printf("    --entropy|--entropy-mode    Specify the entropy coder: rice (partitioned Rice, default), adaptive (per-sample Rice parameter) or range (context-modeled, smallest output, decodes 2-4x slower than rice).\n");
+    printf("    --cascade|--lms-cascade     Specify up to 3 comma-separated LMS stage taps (up to 1024) run before the main filter, e.g. 256,32.\n");
+    printf("    --lpc|--lpc-order           Specify the maximum per-block LPC order between 0 (disabled, default) and 32.\n");
     printf("    --in|--input                Specify the input file path.\n");
     printf("    --out|--output              Specify the output file path.\n");
     printf("    -ms|-midside                Uses mid-side stereo. Compression rates are often improved.\n");
@@ -440,6 +490,7 @@ static void encode(
     bool is_silent_mode) {
     wave_file_reader* reader = NULL;
     neac_encoder* encoder = NULL;
+    neac_encoder_options options;
     register uint32_t n, i;
     clock_t start, end;
     neac_tag* tag;
@@ -482,8 +533,15 @@ static void encode(
         tag = NULL;
     }
 
+    /* コマンドラインで指定された追加の設定 */
+    options.size = sizeof(neac_encoder_options);
+    options.num_cascade_stages = num_cascade_stages;
+    memcpy(options.cascade_taps, cascade_taps, sizeof(options.cascade_taps));
+    options.lpc_order = lpc_order;
+    options.entropy_mode = entropy_mode;
+
     /* NEACエンコーダを作成 */
-    encoder = neac_encoder_create_from_path(
+    encoder = neac_encoder_create_from_path_ex(
         output,
         wave_file_reader_get_sample_rate(reader),
         (uint8_t)wave_file_reader_get_bits_per_sample(reader),
@@ -492,6 +550,7 @@ static void encode(
         block_size,
         use_mid_side_stereo,
         filter_taps,
+        &options,
         tag);
 
     /* エンコード開始時間を記録 */